@@ -0,0 +1,70 @@
+#include "bench.h"
+#include <cstring>
+#include <vector>
+
+// The old lookup: a linear scan, though now comparing names exactly as it should have.
+static SdlangAttribute* scanAttributes(const SdlangTag* tag, SdlangCharSlice name)
+{
+	for (ptrdiff_t i = 0; i < arrlen(tag->attributes); i++)
+	{
+		const SdlangCharSlice other = tag->attributes[i].name;
+		if (other.length == name.length && memcmp(other.ptr, name.ptr, name.length) == 0)
+			return &tag->attributes[i];
+	}
+	return NULL;
+}
+
+BENCH(AttributeLookup)
+{
+	for (size_t count : { 4, 16, 50, 200 })
+	{
+		std::string code = "config";
+		std::vector<std::string> names;
+		for (size_t i = 0; i < count; i++)
+		{
+			// Identifiers can't contain digits, so spell the numbers out in letters.
+			std::string name = "setting_";
+			for (size_t n = i * 7919 % 1000 + 1000; n; n /= 10)
+				name += (char)('a' + n % 10);
+			names.push_back(name);
+			code += " " + names.back() + "=" + std::to_string(i);
+		}
+		code += "\n";
+
+		SdlangParseOptions options = {};
+		options.indexAttributes = true;
+		SdlangDocument doc;
+		SdlangCharStream stream = { code.c_str(), code.size() };
+		SdlangError error;
+		SdlangCharSlice errorLine, errorSlice;
+		if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options))
+		{
+			fprintf(stderr, "parse failed: %s\n", error);
+			exit(1);
+		}
+		const SdlangTag* tag = &doc.root.children[0];
+
+		// Look every attribute up in turn (so half the scan on average), plus one that isn't there.
+		std::vector<SdlangCharSlice> queries;
+		for (const std::string& name : names)
+			queries.push_back({ name.c_str(), name.size() });
+		queries.push_back(SDLANG_CHAR_SLICE("missing"));
+		const size_t rounds = 100000 / queries.size() + 1;
+		printf("  %zu lookups per run:\n", rounds * queries.size());
+		const SdlangCharSlice none = {};
+
+		volatile size_t found = 0;
+		benchReport(std::to_string(count) + " attributes, linear scan", 0, [&] {
+			for (size_t r = 0; r < rounds; r++)
+				for (const SdlangCharSlice& query : queries)
+					found = found + (scanAttributes(tag, query) != NULL);
+		});
+		benchReport(std::to_string(count) + " attributes, " + (tag->_attributeIndex ? "hash index" : "unindexed"), 0,
+			[&] {
+				for (size_t r = 0; r < rounds; r++)
+					for (const SdlangCharSlice& query : queries)
+						found = found + (sdlangTagFindAttribute(tag, none, query) != NULL);
+			});
+		sdlangDocumentFree(&doc);
+	}
+}
@@ -0,0 +1,79 @@
+#include "bench.h"
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// A directory's worth of config files, mostly small with the occasional big one, as in a real project.
+static std::vector<std::string> writeFiles(size_t count)
+{
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < count; i++)
+	{
+		const size_t servers = i % 25 == 0 ? 5000 : 20 + i % 200;
+		std::string code;
+		for (size_t s = 0; s < servers; s++)
+		{
+			code += "server \"srv" + std::to_string(s) + "\" port=" + std::to_string(8000 + s % 1000) + " {\n";
+			code += "    listen 80 443\n";
+			code += "    route \"/\" handler=`index` cache=true\n";
+			code += "}\n";
+		}
+
+		paths.push_back("sdlang_bench_batch_" + std::to_string(i) + ".sdl");
+		FILE* file = fopen(paths.back().c_str(), "wb");
+		if (!file)
+		{
+			fprintf(stderr, "couldn't write %s\n", paths.back().c_str());
+			exit(1);
+		}
+		fwrite(code.data(), 1, code.size(), file);
+		fclose(file);
+	}
+	return paths;
+}
+
+BENCH(ParseBatch)
+{
+	const std::vector<std::string> paths = writeFiles(200);
+	std::vector<SdlangBatchItem> items(paths.size());
+	size_t bytes = 0;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		items[i].path = paths[i].c_str();
+		FILE* file = fopen(items[i].path, "rb");
+		fseek(file, 0, SEEK_END);
+		bytes += ftell(file);
+		fclose(file);
+	}
+
+	auto check = [](SdlangBatchItem& item) {
+		if (!item.parsed)
+		{
+			fprintf(stderr, "parse failed: %s\n", item.error);
+			exit(1);
+		}
+		sdlangDocumentFree(&item.document);
+	};
+
+	// What you'd write without the batch API: one file after another, in the order given, keeping every document
+	// around just like a batch does.
+	benchReport("serial sdlangParseFile loop", bytes, [&] {
+		for (SdlangBatchItem& item : items)
+			item.parsed = sdlangParseFile(item.path, &item.document, &item.error, &item.errorLine, &item.errorSlice);
+		for (SdlangBatchItem& item : items)
+			check(item);
+	});
+
+	const size_t cores = std::thread::hardware_concurrency();
+	for (size_t threads = 1; threads <= (cores > 4 ? cores : 4); threads *= 2)
+	{
+		benchReport(std::to_string(threads) + " thread(s)", bytes, [&] {
+			sdlangParseBatch(items.data(), items.size(), threads);
+			for (SdlangBatchItem& item : items)
+				check(item);
+		});
+	}
+
+	for (const std::string& path : paths)
+		remove(path.c_str());
+}
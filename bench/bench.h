@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stb_ds.h>
+#include <libsdlang.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+typedef void (*BenchFunc)();
+
+struct BenchRegistrar
+{
+	BenchRegistrar(const char* name, BenchFunc fn);
+};
+
+#define BENCH(name)                                                \
+	static void bench_##name();                                    \
+	static BenchRegistrar registrar_##name(#name, bench_##name);  \
+	static void bench_##name()
+
+// Runs `fn` for roughly a quarter of a second and prints the time per run, along with the throughput
+// if `bytes` (the amount of input handled per run) is non-zero.
+template<typename F>
+void benchReport(const std::string& label, size_t bytes, F fn)
+{
+	typedef std::chrono::steady_clock clock;
+
+	fn(); // warm up
+	size_t runs = 0;
+	const auto start = clock::now();
+	double elapsed = 0;
+	do
+	{
+		fn();
+		runs++;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < 0.25);
+
+	const double perRun = elapsed / runs;
+	if (bytes)
+		printf("  %-40s %10.3f ms/run %8.2f ns/byte %9.1f MB/s\n", label.c_str(), perRun * 1e3, perRun * 1e9 / bytes,
+		       bytes / perRun / 1e6);
+	else
+		printf("  %-40s %10.3f ms/run\n", label.c_str(), perRun * 1e3);
+}
+
+// Parses `code` into a throwaway tree, aborting the benchmark if it fails.
+bool benchParse(const std::string& code, const SdlangParseOptions* options = NULL);
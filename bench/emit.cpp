@@ -0,0 +1,300 @@
+#include "bench.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Rows of numbers of every kind, which is where formatting dominates.
+static SdlangDocument samples(size_t count, std::string* code)
+{
+	std::mt19937_64 random(99);
+	for (size_t i = 0; i < count; i++)
+	{
+		char row[200];
+		snprintf(row, sizeof(row), "sample %lld %.17g 20%02d/%02d/%02d %02d:%02d:%02d.%03d %02d:%02d:%02d\n",
+		         (long long)(random() >> 20), (double)(random() % 100000000) / 4096, (int)(random() % 30),
+		         (int)(random() % 12 + 1), (int)(random() % 28 + 1), (int)(random() % 24), (int)(random() % 60),
+		         (int)(random() % 60), (int)(random() % 1000), (int)(random() % 24), (int)(random() % 60),
+		         (int)(random() % 60));
+		*code += row;
+	}
+
+	SdlangDocument doc;
+	SdlangCharStream stream = { code->c_str(), code->size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+	return doc;
+}
+
+static const char* countBytes(const SdlangCharSlice slice, void* userData)
+{
+	*(size_t*)userData += slice.length;
+	return NULL;
+}
+
+// What the emitter used to do for each value: a sprintf per field, and a callback per piece.
+static void sprintfValue(const SdlangValue& v, size_t* bytes)
+{
+	char buffer[50];
+	switch (v.type)
+	{
+	case SDLANG_VALUE_TYPE_INTEGER:
+		*bytes += sprintf(buffer, "%lld", (long long)v.intValue);
+		break;
+	case SDLANG_VALUE_TYPE_FLOATING:
+		*bytes += sprintf(buffer, "%.17g", (double)v.floatValue);
+		break;
+	case SDLANG_VALUE_TYPE_DATETIME:
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.date.year);
+		countBytes({ "/", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.date.month);
+		countBytes({ "/", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.date.day);
+		countBytes({ " ", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.time.hours);
+		countBytes({ ":", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.time.minutes);
+		countBytes({ ":", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.time.seconds);
+		countBytes({ ".", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.dateTimeValue.time.milliseconds);
+		break;
+	case SDLANG_VALUE_TYPE_TIMESPAN:
+		*bytes += sprintf(buffer, "%d", (int)v.timeSpanValue.days);
+		countBytes({ "d:", 2 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.timeSpanValue.hours);
+		countBytes({ ":", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.timeSpanValue.minutes);
+		countBytes({ ":", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.timeSpanValue.seconds);
+		countBytes({ ".", 1 }, bytes);
+		*bytes += sprintf(buffer, "%d", (int)v.timeSpanValue.milliseconds);
+		break;
+	default:
+		break;
+	}
+}
+
+BENCH(EmitValues)
+{
+	std::string code;
+	SdlangDocument doc = samples(100000, &code);
+
+	benchReport("sprintf per field (values only)", code.size(), [&] {
+		size_t bytes = 0;
+		for (size_t i = 0; i < arrlen(doc.root.children); i++)
+		{
+			const SdlangTag& tag = doc.root.children[i];
+			for (size_t j = 0; j < arrlen(tag.values); j++)
+				sprintfValue(tag.values[j], &bytes);
+		}
+		if (!bytes)
+			exit(1);
+	});
+
+	benchReport("sdlangEmit (whole tree)", code.size(), [&] {
+		size_t bytes = 0;
+		if (sdlangEmit(doc.root, countBytes, &bytes))
+			exit(1);
+	});
+
+	benchReport("sdlangEmitToString", code.size(), [&] {
+		char* output;
+		if (sdlangEmitToString(doc.root, &output))
+			exit(1);
+		free(output);
+	});
+
+	sdlangDocumentFree(&doc);
+}
+
+// Generated config: nested tags with short names and attributes, so most fragments are a byte or two long.
+static SdlangDocument config(size_t count, std::string* code)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		*code += "server \"web\" port=8080 enabled=true {\n";
+		*code += "    listen 80 443\n";
+		*code += "    route \"/\" handler=`index` cache=true {\n";
+		*code += "        header name=`accept` value=`text/html`\n";
+		*code += "    }\n";
+		*code += "}\n";
+	}
+
+	SdlangDocument doc;
+	SdlangCharStream stream = { code->c_str(), code->size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+	return doc;
+}
+
+BENCH(EmitSinks)
+{
+	std::string code;
+	SdlangDocument doc = config(100000, &code);
+	FILE* null = fopen("/dev/null", "wb");
+	if (!null)
+		exit(1);
+
+	// What sdlangEmitToString used to be: a callback per fragment, each checking capacity and terminating.
+	benchReport("memory, per fragment", code.size(), [&] {
+		SdlangEmitMemory memory = {};
+		if (sdlangEmit(doc.root, sdlangMemoryEmitter, &memory))
+			exit(1);
+		free(memory.data);
+	});
+	// Growing by doubling, as sdlangEmitToString used to once it was buffered.
+	benchReport("memory, buffered, doubling", code.size(), [&] {
+		SdlangEmitMemory memory = {};
+		if (sdlangEmitBuffered(doc.root, sdlangMemoryEmitter, &memory))
+			exit(1);
+		free(memory.data);
+	});
+	benchReport("memory, sdlangEmitSize", code.size(), [&] {
+		size_t size;
+		if (sdlangEmitSize(doc.root, &size) || !size)
+			exit(1);
+	});
+	std::string reused(code.size() * 2, '\0');
+	benchReport("memory, sdlangEmitToBuffer", code.size(), [&] {
+		if (sdlangEmitToBuffer(doc.root, &reused[0], reused.size()))
+			exit(1);
+	});
+	benchReport("memory, sdlangEmitToString (sized)", code.size(), [&] {
+		char* output;
+		if (sdlangEmitToString(doc.root, &output))
+			exit(1);
+		free(output);
+	});
+
+	for (size_t threads : { 2, 4, 8 })
+	{
+		benchReport("memory, ToStringParallel, " + std::to_string(threads) + " threads", code.size(), [&] {
+			char* output;
+			if (sdlangEmitToStringParallel(doc.root, threads, &output))
+				exit(1);
+			free(output);
+		});
+	}
+
+	benchReport("FILE*, per fragment", code.size(), [&] {
+		if (sdlangEmit(doc.root, sdlangFileEmitter, null))
+			exit(1);
+	});
+	benchReport("FILE*, sdlangEmitToFile", code.size(), [&] {
+		if (sdlangEmitToFile(doc.root, null))
+			exit(1);
+	});
+
+	// A write() per fragment is far too slow to run on all of it.
+	std::string smallCode;
+	SdlangDocument small = config(1000, &smallCode);
+	benchReport("fd, per fragment (1% of the size)", smallCode.size(), [&] {
+		if (sdlangEmit(small.root, sdlangFdEmitter, (void*)(intptr_t)fileno(null)))
+			exit(1);
+	});
+	benchReport("fd, sdlangEmitToFd", code.size(), [&] {
+		if (sdlangEmitToFd(doc.root, fileno(null)))
+			exit(1);
+	});
+	benchReport("fd, sdlangEmitToFdVectored", code.size(), [&] {
+		if (sdlangEmitToFdVectored(doc.root, fileno(null)))
+			exit(1);
+	});
+
+	// /dev/null never looks at the data, so also write to a real file, where the kernel copies it.
+	FILE* file = tmpfile();
+	if (!file)
+		exit(1);
+	benchReport("file, sdlangEmitToFd", code.size(), [&] {
+		rewind(file);
+		if (sdlangEmitToFd(doc.root, fileno(file)))
+			exit(1);
+	});
+	benchReport("file, sdlangEmitToFdVectored", code.size(), [&] {
+		rewind(file);
+		if (sdlangEmitToFdVectored(doc.root, fileno(file)))
+			exit(1);
+	});
+
+	// Documents of large blobs, where pointing at the strings saves copying almost everything.
+	std::string blobCode;
+	for (size_t i = 0; i < 20000; i++)
+		blobCode += "blob id=" + std::to_string(i) + " `" + std::string(4000, 'a' + i % 26) + "`\n";
+	SdlangDocument blobs;
+	SdlangCharStream stream = { blobCode.c_str(), blobCode.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	if (!sdlangParseDocument(stream, &blobs, &error, &errorLine, &errorSlice))
+		exit(1);
+	benchReport("file, blobs, sdlangEmitToFd", blobCode.size(), [&] {
+		rewind(file);
+		if (sdlangEmitToFd(blobs.root, fileno(file)))
+			exit(1);
+	});
+	benchReport("file, blobs, sdlangEmitToFdVectored", blobCode.size(), [&] {
+		rewind(file);
+		if (sdlangEmitToFdVectored(blobs.root, fileno(file)))
+			exit(1);
+	});
+	sdlangDocumentFree(&blobs);
+	fclose(file);
+
+	fclose(null);
+	sdlangDocumentFree(&small);
+	sdlangDocumentFree(&doc);
+}
+
+BENCH(EmitCompact)
+{
+	std::string code;
+	SdlangDocument doc = config(100000, &code);
+
+	SdlangEmitOptions compact = {};
+	compact.compact = true;
+	char *pretty, *small;
+	if (sdlangEmitToString(doc.root, &pretty) || sdlangEmitToString(doc.root, &small, NULL, &compact))
+		exit(1);
+	const size_t prettySize = strlen(pretty), smallSize = strlen(small);
+	printf("  default %zu bytes, compact %zu bytes (%.1f%% smaller)\n", prettySize, smallSize,
+		100.0 * (1.0 - (double)smallSize / prettySize));
+
+	// Throughput is per byte of the default output for all of these, so they compare as times.
+	benchReport("emit, default", prettySize, [&] {
+		char* output;
+		if (sdlangEmitToString(doc.root, &output))
+			exit(1);
+		free(output);
+	});
+	benchReport("emit, compact", prettySize, [&] {
+		char* output;
+		if (sdlangEmitToString(doc.root, &output, NULL, &compact))
+			exit(1);
+		free(output);
+	});
+
+	const auto parse = [](const char* text, size_t length) {
+		SdlangCharStream stream = { text, length };
+		SdlangDocument parsed;
+		SdlangError error;
+		SdlangCharSlice errorLine, errorSlice;
+		if (!sdlangParseDocument(stream, &parsed, &error, &errorLine, &errorSlice))
+			exit(1);
+		sdlangDocumentFree(&parsed);
+	};
+	benchReport("parse, default", prettySize, [&] { parse(pretty, prettySize); });
+	benchReport("parse, compact", prettySize, [&] { parse(small, smallSize); });
+
+	free(pretty);
+	free(small);
+	sdlangDocumentFree(&doc);
+}
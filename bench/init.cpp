@@ -0,0 +1,4 @@
+#define SDLANG_IMPLEMENTATION
+#include <libsdlang.h>
+#define STB_DS_IMPLEMENTATION
+#include <stb_ds.h>
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "bench.h"
+#include <cstring>
+
+// A large config split into top level sections, each with a sizeable block of settings, of which only a few are
+// ever looked at.
+static std::string sections(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "section \"s" + std::to_string(i) + "\" enabled=true {\n";
+		for (size_t j = 0; j < 8; j++)
+		{
+			code += "    server \"srv" + std::to_string(j) + "\" port=" + std::to_string(8000 + j) + " {\n";
+			code += "        listen 80 443\n";
+			code += "        route \"/{id}\" handler=`index` cache=true timeout=30.5\n";
+			code += "    }\n";
+		}
+		code += "}\n";
+	}
+	return code;
+}
+
+BENCH(ParseLazy)
+{
+	const std::string code = sections(50000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	// The floor: one pass over the text looking for something that isn't there.
+	benchReport("memchr", code.size(), [&] {
+		if (memchr(code.c_str(), '\0', code.size()))
+			exit(1);
+	});
+
+	benchReport("eager document", code.size(), [&] {
+		SdlangDocument doc;
+		if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice))
+		{
+			fprintf(stderr, "parse failed: %s\n", error);
+			exit(1);
+		}
+		sdlangDocumentFree(&doc);
+	});
+
+	// Opening a section parses its servers, and then the first server's own block too.
+	SdlangParseOptions options = {};
+	options.lazy = true;
+	for (size_t percent : { 0, 2, 100 })
+	{
+		benchReport("lazy document, reading " + std::to_string(percent) + "% of sections", code.size(), [&] {
+			SdlangDocument doc;
+			if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options))
+			{
+				fprintf(stderr, "parse failed: %s\n", error);
+				exit(1);
+			}
+			const size_t count = arrlen(doc.root.children);
+			for (size_t i = 0; percent && i < count; i += 100 / percent)
+			{
+				SdlangTag* servers = sdlangTagChildren(&doc, &doc.root.children[i], &error);
+				if (!servers)
+				{
+					fprintf(stderr, "parse failed: %s\n", error);
+					exit(1);
+				}
+				sdlangTagChildren(&doc, &servers[0]);
+			}
+			sdlangDocumentFree(&doc);
+		});
+	}
+}
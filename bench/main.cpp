@@ -0,0 +1,52 @@
+#include "bench.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct BenchEntry
+{
+	const char* name;
+	BenchFunc fn;
+};
+
+static std::vector<BenchEntry>& benchmarks()
+{
+	static std::vector<BenchEntry> list;
+	return list;
+}
+
+BenchRegistrar::BenchRegistrar(const char* name, BenchFunc fn)
+{
+	benchmarks().push_back({ name, fn });
+}
+
+bool benchParse(const std::string& code, const SdlangParseOptions* options)
+{
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag tag = {};
+	const bool parsed = sdlangParseCharStream(stream, &tag, &error, &errorLine, &errorSlice, options);
+	if (!parsed)
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+	sdlangTagFree(tag);
+	return parsed;
+}
+
+// Usage: bench_runner [filter]
+// Only benchmarks whose name contains `filter` are run.
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : "";
+	for (const auto& bench : benchmarks())
+	{
+		if (!strstr(bench.name, filter))
+			continue;
+		printf("%s\n", bench.name);
+		bench.fn();
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include "bench.h"
+#include <thread>
+
+// Lots of independent top level tags, as in a large generated config.
+static std::string config(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "server \"srv" + std::to_string(i) + "\" port=" + std::to_string(8000 + i % 1000) + " {\n";
+		code += "    listen 80 443\n";
+		code += "    route \"/\" handler=`index` cache=true\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+BENCH(ParseParallel)
+{
+	const std::string code = config(100000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	benchReport("serial", code.size(), [&] { benchParse(code); });
+
+	// Past the number of cores this should level off rather than keep scaling.
+	const size_t cores = std::thread::hardware_concurrency();
+	for (size_t threads = 1; threads <= (cores > 4 ? cores : 4); threads *= 2)
+	{
+		benchReport(std::to_string(threads) + " thread(s)", code.size(), [&] {
+			SdlangTag root = {};
+			if (!sdlangParseCharStreamParallel(stream, threads, &root, &error, &errorLine, &errorSlice))
+			{
+				fprintf(stderr, "parse failed: %s\n", error);
+				exit(1);
+			}
+			sdlangTagFree(root);
+		});
+	}
+}
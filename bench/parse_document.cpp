@@ -0,0 +1,34 @@
+#include "bench.h"
+
+// A config made of many small tags, where allocation rather than tokenizing dominates.
+static std::string manyTags(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i += 4)
+	{
+		code += "server \"srv" + std::to_string(i) + "\" port=" + std::to_string(8000 + i % 1000) + " {\n";
+		code += "    listen 80 443\n";
+		code += "    route \"/\" handler=`index` cache=true\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+BENCH(ParseDocument)
+{
+	const std::string code = manyTags(200000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	benchReport("heap tree + sdlangTagFree", code.size(), [&] { benchParse(code); });
+	benchReport("document arena + sdlangDocumentFree", code.size(), [&] {
+		SdlangDocument doc;
+		if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice))
+		{
+			fprintf(stderr, "parse failed: %s\n", error);
+			exit(1);
+		}
+		sdlangDocumentFree(&doc);
+	});
+}
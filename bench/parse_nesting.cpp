@@ -0,0 +1,44 @@
+#include "bench.h"
+
+// The cost per byte should stay flat as the nesting gets deeper, since the parser no longer recurses per level.
+BENCH(ParseNesting)
+{
+	const size_t targetBytes = 4 * 1024 * 1024;
+	const size_t depths[] = { 1, 16, 256, 4096 };
+
+	for (size_t depth : depths)
+	{
+		std::string block;
+		for (size_t i = 0; i < depth; i++)
+			block += "node 1 {\n";
+		for (size_t i = depth; i > 0; i--)
+			block += "}\n";
+
+		std::string code;
+		while (code.size() < targetBytes)
+			code += block;
+
+		SdlangParseOptions options = {};
+		options.maxDepth = depth;
+		benchReport("depth " + std::to_string(depth), code.size(), [&] { benchParse(code, &options); });
+	}
+}
+
+BENCH(ParseLineContinuations)
+{
+	const size_t lengths[] = { 1, 64, 4096, 262144 };
+
+	for (size_t length : lengths)
+	{
+		std::string line = "tag";
+		for (size_t i = 0; i < length; i++)
+			line += " \\\n    1";
+		line += "\n";
+
+		std::string code;
+		while (code.size() < 4 * 1024 * 1024)
+			code += line;
+
+		benchReport("chain of " + std::to_string(length), code.size(), [&] { benchParse(code); });
+	}
+}
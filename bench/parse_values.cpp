@@ -0,0 +1,44 @@
+#include "bench.h"
+
+// Builds ~4MB of tags that each hold eight copies of `value`, so the time is dominated by value parsing.
+static std::string valueDocument(const std::string& value)
+{
+	std::string line = "v";
+	for (int i = 0; i < 8; i++)
+		line += " " + value;
+	line += "\n";
+
+	std::string code;
+	while (code.size() < 4 * 1024 * 1024)
+		code += line;
+	return code;
+}
+
+// Each literal is only read once, so the cost per byte should stay roughly flat across types and lengths.
+BENCH(ParseValues)
+{
+	const std::pair<const char*, const char*> values[] = {
+		{ "int (1 digit)", "7" },
+		{ "int (9 digits)", "123456789" },
+		{ "int (18 digits)", "123456789012345678" },
+		{ "hex int", "0x7FFFFFFFFFFFFFFF" },
+		{ "float (short)", "1.5" },
+		{ "float (17 digits)", "3.1415926535897931" },
+		{ "float (exponent)", "6.02214076e23" },
+		{ "date", "2021/08/30" },
+		{ "datetime", "2021/08/30 18:00:00" },
+		{ "datetime (ms)", "2021/08/30 18:00:00.125" },
+		{ "timespan", "12:34:56" },
+		{ "timespan (days, ms)", "-365d:12:34:56.789" },
+	};
+
+	// Deferring skips converting values that are never read, but they still have to be checked.
+	SdlangParseOptions deferred = {};
+	deferred.deferValues = true;
+	for (const auto& value : values)
+	{
+		const std::string code = valueDocument(value.second);
+		benchReport(value.first, code.size(), [&] { benchParse(code); });
+		benchReport(std::string(value.first) + ", deferred", code.size(), [&] { benchParse(code, &deferred); });
+	}
+}
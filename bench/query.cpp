@@ -0,0 +1,91 @@
+#include "bench.h"
+#include <cstring>
+
+static std::string servers(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "server \"s\" {\n";
+		code += "    listen port=" + std::to_string(i % 2 ? 443 : 80) + "\n";
+		code += "    route \"/\" name=\"index\" {\n        cache on\n    }\n";
+		code += "    route \"/api\" name=\"api\"\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+static bool named(SdlangCharSlice name, const char* expected)
+{
+	return strncmp(name.ptr, expected, name.length) == 0 && expected[name.length] == '\0';
+}
+
+// What `server/listen[@port=443]` takes without queries.
+static size_t byHand(const SdlangTag& root)
+{
+	size_t found = 0;
+	for (ptrdiff_t i = 0; i < arrlen(root.children); i++)
+	{
+		const SdlangTag& server = root.children[i];
+		if (!named(server.name, "server"))
+			continue;
+		for (ptrdiff_t j = 0; j < arrlen(server.children); j++)
+		{
+			const SdlangTag& listen = server.children[j];
+			if (!named(listen.name, "listen"))
+				continue;
+			for (ptrdiff_t k = 0; k < arrlen(listen.attributes); k++)
+			{
+				const SdlangAttribute& port = listen.attributes[k];
+				if (named(port.name, "port") && port.value.type == SDLANG_VALUE_TYPE_INTEGER && port.value.intValue == 443)
+					found++;
+			}
+		}
+	}
+	return found;
+}
+
+static size_t run(const SdlangQuery* query, SdlangTag* root)
+{
+	size_t found = 0;
+	SdlangQueryIterator iterator;
+	sdlangQueryBegin(&iterator, query, root);
+	while (sdlangQueryNext(&iterator))
+		found++;
+	return found;
+}
+
+BENCH(Query)
+{
+	const std::string code = servers(20000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangDocument doc;
+	if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+
+	volatile size_t found = 0;
+	SdlangQuery query;
+	sdlangQueryCompile("server/listen[@port=443]", &query);
+	benchReport("hand written loop", 0, [&] { found = byHand(doc.root); });
+	benchReport("server/listen[@port=443]", 0, [&] { found = run(&query, &doc.root); });
+	benchReport("server/listen[@port=443], recompiled", 0, [&] {
+		SdlangQuery once;
+		sdlangQueryCompile("server/listen[@port=443]", &once);
+		found = run(&once, &doc.root);
+		sdlangQueryFree(&once);
+	});
+	sdlangQueryFree(&query);
+
+	for (const char* text : { "*/route[name=\"api\"]", "//cache" })
+	{
+		sdlangQueryCompile(text, &query);
+		benchReport(text, 0, [&] { found = run(&query, &doc.root); });
+		sdlangQueryFree(&query);
+	}
+	sdlangDocumentFree(&doc);
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+
+// String heavy, which is where the index saves the parser the most work.
+static std::string strings(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "entry \"" + std::string(20 + i % 40, 'x') + "\" `raw " + std::to_string(i) + "` note=\"a \\\"quoted\\\" word\" {\n";
+		code += "    path \"/srv/data/" + std::to_string(i) + "/file.txt\"\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+BENCH(StructuralIndex)
+{
+	const std::string code = strings(100000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+
+	SdlangStructuralIndex index;
+	if (!sdlangStructuralIndexBuild(stream, &index, &error))
+	{
+		fprintf(stderr, "index failed: %s\n", error);
+		exit(1);
+	}
+	printf("  %zu entries for %zu bytes\n", index.count, code.size());
+
+	benchReport("stage 1: build index", code.size(), [&] {
+		SdlangStructuralIndex other;
+		sdlangStructuralIndexBuild(stream, &other, &error);
+		sdlangStructuralIndexFree(&other);
+	});
+
+	SdlangParseOptions options = {};
+	benchReport("parse without index", code.size(), [&] { benchParse(code, &options); });
+	options.index = &index;
+	benchReport("stage 2: parse with a reused index", code.size(), [&] { benchParse(code, &options); });
+	benchReport("stage 1 + stage 2", code.size(), [&] {
+		SdlangStructuralIndex other;
+		sdlangStructuralIndexBuild(stream, &other, &error);
+		options.index = &other;
+		benchParse(code, &options);
+		sdlangStructuralIndexFree(&other);
+	});
+
+	sdlangStructuralIndexFree(&index);
+}
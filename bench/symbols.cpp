@@ -0,0 +1,109 @@
+#include "bench.h"
+#include <cstring>
+
+// A config full of the tags a binder knows about, plus some it doesn't.
+static std::string config(size_t count)
+{
+	static const char* const TAGS[] = { "listen", "route", "cache", "timeout", "header", "upstream", "unknown" };
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "server port=8080 {\n";
+		for (const char* tag : TAGS)
+			code += std::string("    ") + tag + " \"value\" weight=1 enabled=true\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+enum Binding
+{
+	LISTEN = 1,
+	ROUTE,
+	CACHE,
+	TIMEOUT,
+	HEADER,
+	UPSTREAM,
+	BINDING_COUNT,
+};
+
+static bool named(SdlangCharSlice name, const char* expected)
+{
+	return strncmp(name.ptr, expected, name.length) == 0 && expected[name.length] == '\0';
+}
+
+// What binding code does without symbols: compare the name against each one it knows in turn.
+static int bindByName(const SdlangTag& tag)
+{
+	if (named(tag.name, "listen"))
+		return LISTEN;
+	if (named(tag.name, "route"))
+		return ROUTE;
+	if (named(tag.name, "cache"))
+		return CACHE;
+	if (named(tag.name, "timeout"))
+		return TIMEOUT;
+	if (named(tag.name, "header"))
+		return HEADER;
+	if (named(tag.name, "upstream"))
+		return UPSTREAM;
+	return 0;
+}
+
+static int bindBySymbol(const SdlangTag& tag)
+{
+	switch (tag.symbol)
+	{
+	case LISTEN:
+	case ROUTE:
+	case CACHE:
+	case TIMEOUT:
+	case HEADER:
+	case UPSTREAM:
+		return (int)tag.symbol;
+	default:
+		return 0;
+	}
+}
+
+template<typename F>
+static void bindAll(const SdlangTag& root, F bind)
+{
+	volatile int bound = 0;
+	for (ptrdiff_t i = 0; i < arrlen(root.children); i++)
+	{
+		const SdlangTag& server = root.children[i];
+		for (ptrdiff_t j = 0; j < arrlen(server.children); j++)
+			bound = bound + bind(server.children[j]);
+	}
+}
+
+BENCH(Symbols)
+{
+	const std::string code = config(20000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	// Registering the names up front in the same order as the enum gives them the enum's values.
+	SdlangSymbolTable table = {};
+	static const char* const NAMES[] = { "listen", "route", "cache", "timeout", "header", "upstream" };
+	for (const char* name : NAMES)
+		sdlangSymbolIntern(&table, SdlangCharSlice(), SdlangCharSlice{ name, strlen(name) });
+
+	SdlangParseOptions options = {};
+	options.symbols = &table;
+	benchReport("parse", code.size(), [&] { benchParse(code); });
+	benchReport("parse, interning names", code.size(), [&] { benchParse(code, &options); });
+
+	SdlangDocument doc;
+	if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+	benchReport("bind by comparing names", 0, [&] { bindAll(doc.root, bindByName); });
+	benchReport("bind by switching on symbols", 0, [&] { bindAll(doc.root, bindBySymbol); });
+	sdlangDocumentFree(&doc);
+	sdlangSymbolTableFree(&table);
+}
@@ -0,0 +1,82 @@
+#include "bench.h"
+
+// Nested enough that walking it touches a good spread of tags.
+static std::string config(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i += 5)
+	{
+		code += "server \"srv" + std::to_string(i) + "\" port=" + std::to_string(8000 + i % 1000) + " {\n";
+		code += "    listen 80 443\n";
+		code += "    route \"/\" {\n";
+		code += "        cache 60 shared=true\n";
+		code += "    }\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+static int64_t sumTree(const SdlangTag& tag)
+{
+	int64_t sum = 0;
+	for (int i = 0; i < arrlen(tag.values); i++)
+		sum += tag.values[i].type == SDLANG_VALUE_TYPE_INTEGER ? tag.values[i].intValue : 0;
+	for (int i = 0; i < arrlen(tag.children); i++)
+		sum += sumTree(tag.children[i]);
+	return sum;
+}
+
+static int64_t sumTape(const SdlangTape& tape)
+{
+	// Every node's values are a range in the same pool, so no need to follow any links.
+	int64_t sum = 0;
+	for (size_t i = 0; i < tape.valueCount; i++)
+		sum += tape.values[i].type == SDLANG_VALUE_TYPE_INTEGER ? tape.values[i].intValue : 0;
+	return sum;
+}
+
+static int64_t sumTapeLinks(const SdlangTape& tape, SdlangTapeIndex node)
+{
+	size_t count;
+	const SdlangValue* values = sdlangTapeValues(&tape, node, &count);
+	int64_t sum = 0;
+	for (size_t i = 0; i < count; i++)
+		sum += values[i].type == SDLANG_VALUE_TYPE_INTEGER ? values[i].intValue : 0;
+	for (SdlangTapeIndex child = sdlangTapeFirstChild(&tape, node); child != SDLANG_TAPE_NONE;
+	     child = sdlangTapeNextSibling(&tape, child))
+		sum += sumTapeLinks(tape, child);
+	return sum;
+}
+
+BENCH(Tape)
+{
+	const std::string code = config(200000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	SdlangTag tree = {};
+	SdlangTape tape;
+	if (!sdlangParseCharStream(stream, &tree, &error, &errorLine, &errorSlice)
+	    || !sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+
+	benchReport("parse: heap tree + sdlangTagFree", code.size(), [&] { benchParse(code); });
+	benchReport("parse: tape + sdlangTapeFree", code.size(), [&] {
+		SdlangTape other;
+		sdlangParseTape(stream, &other, &error, &errorLine, &errorSlice);
+		sdlangTapeFree(&other);
+	});
+
+	volatile int64_t sink = 0;
+	benchReport("walk: tree", 0, [&] { sink = sumTree(tree); });
+	benchReport("walk: tape links", 0, [&] { sink = sumTapeLinks(tape, SDLANG_TAPE_ROOT); });
+	benchReport("walk: tape value pool", 0, [&] { sink = sumTape(tape); });
+	(void)sink;
+
+	sdlangTapeFree(&tape);
+	sdlangTagFree(tree);
+}
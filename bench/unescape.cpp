@@ -0,0 +1,67 @@
+#include "bench.h"
+#include <cstdlib>
+
+// Log lines where most strings are long, and about half of them have an escape somewhere.
+static std::string messages(size_t count)
+{
+	std::string code;
+	for (size_t i = 0; i < count; i++)
+	{
+		code += "entry level=`info` {\n";
+		code += "    message \"request for /api/items completed in a reasonable amount of time\"\n";
+		code += "    detail \"header \\\"accept\\\" was set to\\tapplication/json for path C:\\\\srv\\\\items\"\n";
+		code += "}\n";
+	}
+	return code;
+}
+
+static void parseDocument(SdlangCharStream stream, SdlangDocument* doc, const SdlangParseOptions* options = NULL)
+{
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	if (!sdlangParseDocument(stream, doc, &error, &errorLine, &errorSlice, options))
+	{
+		fprintf(stderr, "parse failed: %s\n", error);
+		exit(1);
+	}
+}
+
+BENCH(Unescape)
+{
+	const std::string code = messages(50000);
+	SdlangCharStream stream = { code.c_str(), code.size() };
+
+	benchReport("document", code.size(), [&] {
+		SdlangDocument doc;
+		parseDocument(stream, &doc);
+		sdlangDocumentFree(&doc);
+	});
+
+	// The old way: walk the tree, and allocate a string for each one that needs escaping.
+	benchReport("document + EscapeFull per string", code.size(), [&] {
+		SdlangDocument doc;
+		parseDocument(stream, &doc);
+		for (size_t i = 0; i < arrlen(doc.root.children); i++)
+		{
+			const SdlangTag& entry = doc.root.children[i];
+			for (size_t j = 0; j < arrlen(entry.children); j++)
+			{
+				const SdlangValue& value = entry.children[j].values[0];
+				SdlangCharStream text;
+				if (!value.requiresEscape || !sdlangCharStreamFromValue(value, &text))
+					continue;
+				SdlangCharSlice escaped = sdlangCharStreamEscapeFull(text);
+				free((void*)escaped.ptr);
+			}
+		}
+		sdlangDocumentFree(&doc);
+	});
+
+	SdlangParseOptions options = {};
+	options.unescapeStrings = true;
+	benchReport("document, unescapeStrings", code.size(), [&] {
+		SdlangDocument doc;
+		parseDocument(stream, &doc, &options);
+		sdlangDocumentFree(&doc);
+	});
+}
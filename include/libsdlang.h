@@ -23,11 +23,36 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "stb_ds.h"
 #include <assert.h>
+#include <float.h>
+#include <locale.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef SDLANG_IMPLEMENTATION
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <io.h>
+#include <windows.h>
+#define _SDLANG_THREADS
+#elif defined(__unix__) || defined(__APPLE__)
+#define _SDLANG_POSIX
+#define _SDLANG_THREADS
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -60,6 +85,15 @@ extern "C"
     const SdlangError SDLANG_ERROR_NUMBER_TOO_LARGE =
         "Number is too large to parse, which likely means the number isn't even "
         "valid.";
+    const SdlangError SDLANG_ERROR_INTEGER_OVERFLOW = "Integer does not fit into a signed 64-bit integer.";
+    const SdlangError SDLANG_ERROR_MAX_DEPTH_EXCEEDED = "Tags are nested deeper than the maximum allowed depth.";
+    const SdlangError SDLANG_ERROR_STOPPED = "Parsing was stopped by a callback.";
+    const SdlangError SDLANG_ERROR_SECOND_CHILDREN = "A tag can only have one block of children.";
+    const SdlangError SDLANG_ERROR_OUT_OF_MEMORY = "Failed to allocate memory.";
+    const SdlangError SDLANG_ERROR_FILE_OPEN = "Could not open the file.";
+    const SdlangError SDLANG_ERROR_FILE_READ = "Could not read or map the file.";
+    const SdlangError SDLANG_ERROR_TAPE_TOO_LARGE = "The document has too many tags to fit into a tape.";
+    const SdlangError SDLANG_ERROR_TEXT_TOO_LARGE = "The text is too large to index.";
 
 #define SDLANG_CHAR_SLICE(str)                                                                                         \
     {                                                                                                                  \
@@ -72,6 +106,84 @@ extern "C"
         size_t length;
     } SdlangCharSlice;
 
+    // Where the library gets memory from. Anything that allocates can be given one, in which case everything it
+    // allocates (including scratch space) comes from it, and NULL means malloc, realloc and free. The functions
+    // behave the same as their C counterparts.
+    typedef struct SdlangAllocator
+    {
+        void *(*alloc)(void *context, size_t size);
+        void *(*realloc)(void *context, void *ptr, size_t size);
+        void (*free)(void *context, void *ptr);
+        void *context;
+    } SdlangAllocator;
+
+    // A growable run of bytes whose memory comes from an SdlangAllocator.
+    typedef struct _SdlangBuffer
+    {
+        char *data;
+        size_t length;
+        size_t capacity;
+    } _SdlangBuffer;
+
+// Views the contents of a buffer as an array of `type`.
+#define _SDLANG_SCRATCH(buffer, type) ((type *)(buffer).data)
+#define _SDLANG_SCRATCH_COUNT(buffer, type) ((buffer).length / sizeof(type))
+
+#ifdef SDLANG_IMPLEMENTATION
+    static void *_mallocAlloc(void *context, size_t size)
+    {
+        (void)context;
+        return malloc(size);
+    }
+
+    static void *_mallocRealloc(void *context, void *ptr, size_t size)
+    {
+        (void)context;
+        return realloc(ptr, size);
+    }
+
+    static void _mallocFree(void *context, void *ptr)
+    {
+        (void)context;
+        free(ptr);
+    }
+
+    static const SdlangAllocator _MALLOC_ALLOCATOR = {_mallocAlloc, _mallocRealloc, _mallocFree, NULL};
+
+    static const SdlangAllocator *_allocatorOrDefault(const SdlangAllocator *allocator)
+    {
+        return allocator ? allocator : &_MALLOC_ALLOCATOR;
+    }
+
+    // Makes room for `bytes` more bytes at the end of `buffer`, returning where they start or NULL if out of memory.
+    static void *_bufferPush(_SdlangBuffer *buffer, const SdlangAllocator *allocator, size_t bytes)
+    {
+        if (buffer->capacity - buffer->length < bytes)
+        {
+            size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+            while (capacity - buffer->length < bytes)
+                capacity *= 2;
+
+            char *data = (char *)allocator->realloc(allocator->context, buffer->data, capacity);
+            if (!data)
+                return NULL;
+            buffer->data = data;
+            buffer->capacity = capacity;
+        }
+
+        void *ptr = buffer->data + buffer->length;
+        buffer->length += bytes;
+        return ptr;
+    }
+
+    static void _bufferFree(_SdlangBuffer *buffer, const SdlangAllocator *allocator)
+    {
+        if (buffer->data)
+            allocator->free(allocator->context, buffer->data);
+        *buffer = {};
+    }
+#endif
+
     typedef struct SdlangCharStream
     {
         const char *text;
@@ -119,24 +231,604 @@ extern "C"
 
     SdlangCharSlice sdlangCharStreamGetLine(const SdlangCharStream *stream, const size_t forCursorAt)
     {
-        size_t start = forCursorAt;
-        size_t end = forCursorAt;
+        size_t end = forCursorAt < stream->textLength ? forCursorAt : stream->textLength;
+        size_t start = end;
 
-        while (start > 0 && stream->text[start] != '\n')
+        // A cursor sitting on a new line belongs to the line that it ends.
+        while (start > 0 && stream->text[start - 1] != '\n')
             start--;
 
         while (end < stream->textLength && stream->text[end] != '\n' && stream->text[end] != '\r')
             end++;
 
-        if (start != 0) // Don't include the new line character.
-            start++;
-
         const size_t len = end - start;
         SdlangCharSlice slice = {stream->text + start, len};
         return slice;
     }
 #endif
 
+#ifdef SDLANG_IMPLEMENTATION
+    // Scanning kernels used by the lexer's hot loops.
+    //
+    // Every kernel takes the range [p, end) and returns a pointer to the first "stop" character, or `end` if there
+    // isn't one. On x86-64 the bulk of the range is classified 16 (SSE2) or 32 (AVX2) bytes at a time, with the
+    // AVX2 path chosen at runtime so one binary runs everywhere. The scalar loop then handles whatever is left over.
+    // Define SDLANG_NO_SIMD to only ever use the scalar loops.
+
+#if !defined(SDLANG_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define _SDLANG_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define _SDLANG_TARGET_AVX2
+#else
+#define _SDLANG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifdef _SDLANG_SIMD_X86
+    static inline unsigned _sdlangCtz(uint32_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned)index;
+#else
+        return (unsigned)__builtin_ctz(mask);
+#endif
+    }
+
+    // 0 = scalar only, 1 = SSE2, 2 = AVX2
+    //
+    // The level is cached with relaxed atomic loads and stores, so any number of threads can call this at once. At
+    // worst a few of them detect it at the same time, all finding the same answer. (MSVC's volatile accesses are
+    // atomic on x86-64.)
+    static int _simdLevel(void)
+    {
+#ifdef _MSC_VER
+        static volatile long level = -1;
+        const int cached = (int)level;
+#else
+        static int level = -1;
+        const int cached = __atomic_load_n(&level, __ATOMIC_RELAXED);
+#endif
+        if (cached >= 0)
+            return cached;
+
+        int detected = 1; // SSE2 is part of the x86-64 baseline.
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7)
+        {
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (osxsave && (_xgetbv(0) & 0x6) == 0x6)
+            {
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5))
+                    detected = 2;
+            }
+        }
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            detected = 2;
+#endif
+#ifdef _MSC_VER
+        level = detected;
+#else
+        __atomic_store_n(&level, detected, __ATOMIC_RELAXED);
+#endif
+        return detected;
+    }
+
+    static const char *_scanSpacesSse2(const char *p, const char *end)
+    {
+        const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+        for (; end - p >= 16; p += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i *)p);
+            const uint32_t keep = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)));
+            if (keep != 0xFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    static const char *_scanNewlinesSse2(const char *p, const char *end)
+    {
+        const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+        for (; end - p >= 16; p += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i *)p);
+            const uint32_t keep = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+            if (keep != 0xFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    static const char *_scanIdentifierSse2(const char *p, const char *end)
+    {
+        const __m128i caseBit = _mm_set1_epi8(0x20), lo = _mm_set1_epi8('a' - 1), hi = _mm_set1_epi8('z' + 1),
+                      underscore = _mm_set1_epi8('_');
+        for (; end - p >= 16; p += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i *)p);
+            const __m128i lower = _mm_or_si128(v, caseBit);
+            const __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, lo), _mm_cmplt_epi8(lower, hi));
+            // Bytes with the high bit set are negative, so movemask(v) picks up the UTF-8 bytes for free.
+            const uint32_t keep =
+                (uint32_t)_mm_movemask_epi8(_mm_or_si128(alpha, _mm_cmpeq_epi8(v, underscore))) |
+                (uint32_t)_mm_movemask_epi8(v);
+            if (keep != 0xFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    static const char *_findAny3Sse2(const char *p, const char *end, char a, char b, char c)
+    {
+        const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b), vc = _mm_set1_epi8(c);
+        for (; end - p >= 16; p += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i *)p);
+            const __m128i hit =
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)), _mm_cmpeq_epi8(v, vc));
+            const uint32_t stop = (uint32_t)_mm_movemask_epi8(hit);
+            if (stop)
+                return p + _sdlangCtz(stop);
+        }
+        return p;
+    }
+
+    _SDLANG_TARGET_AVX2 static const char *_scanSpacesAvx2(const char *p, const char *end)
+    {
+        const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+        for (; end - p >= 32; p += 32)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            const uint32_t keep =
+                (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)));
+            if (keep != 0xFFFFFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    _SDLANG_TARGET_AVX2 static const char *_scanNewlinesAvx2(const char *p, const char *end)
+    {
+        const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+        for (; end - p >= 32; p += 32)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            const uint32_t keep =
+                (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+            if (keep != 0xFFFFFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    _SDLANG_TARGET_AVX2 static const char *_scanIdentifierAvx2(const char *p, const char *end)
+    {
+        const __m256i caseBit = _mm256_set1_epi8(0x20), lo = _mm256_set1_epi8('a' - 1), hi = _mm256_set1_epi8('z' + 1),
+                      underscore = _mm256_set1_epi8('_');
+        for (; end - p >= 32; p += 32)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            const __m256i lower = _mm256_or_si256(v, caseBit);
+            const __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, lo), _mm256_cmpgt_epi8(hi, lower));
+            const uint32_t keep =
+                (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(alpha, _mm256_cmpeq_epi8(v, underscore))) |
+                (uint32_t)_mm256_movemask_epi8(v);
+            if (keep != 0xFFFFFFFF)
+                return p + _sdlangCtz(~keep);
+        }
+        return p;
+    }
+
+    _SDLANG_TARGET_AVX2 static const char *_findAny3Avx2(const char *p, const char *end, char a, char b, char c)
+    {
+        const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b), vc = _mm256_set1_epi8(c);
+        for (; end - p >= 32; p += 32)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)p);
+            const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+                                                _mm256_cmpeq_epi8(v, vc));
+            const uint32_t stop = (uint32_t)_mm256_movemask_epi8(hit);
+            if (stop)
+                return p + _sdlangCtz(stop);
+        }
+        return p;
+    }
+#endif
+
+    static inline bool _isIdentifierChar(const char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || (ch & 0x80); // poor man's UTF support.
+    }
+
+    static const char *_scanSpaces(const char *p, const char *end)
+    {
+#ifdef _SDLANG_SIMD_X86
+        p = (_simdLevel() >= 2) ? _scanSpacesAvx2(p, end) : _scanSpacesSse2(p, end);
+#endif
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        return p;
+    }
+
+    static const char *_scanNewlines(const char *p, const char *end)
+    {
+#ifdef _SDLANG_SIMD_X86
+        p = (_simdLevel() >= 2) ? _scanNewlinesAvx2(p, end) : _scanNewlinesSse2(p, end);
+#endif
+        while (p < end && (*p == '\r' || *p == '\n'))
+            p++;
+        return p;
+    }
+
+    static const char *_scanIdentifier(const char *p, const char *end)
+    {
+#ifdef _SDLANG_SIMD_X86
+        p = (_simdLevel() >= 2) ? _scanIdentifierAvx2(p, end) : _scanIdentifierSse2(p, end);
+#endif
+        while (p < end && _isIdentifierChar(*p))
+            p++;
+        return p;
+    }
+
+    // Finds the first occurrence of any of `a`, `b`, or `c`. Pass the same character multiple times to search for less.
+    static const char *_findAny3(const char *p, const char *end, char a, char b, char c)
+    {
+#ifdef _SDLANG_SIMD_X86
+        p = (_simdLevel() >= 2) ? _findAny3Avx2(p, end, a, b, c) : _findAny3Sse2(p, end, a, b, c);
+#endif
+        while (p < end && *p != a && *p != b && *p != c)
+            p++;
+        return p;
+    }
+#endif
+
+    // Structural index.
+    //
+    // A first pass over the text that records the offset of every character that gives a document its structure:
+    // braces, new lines, `=`, `:`, the quotes that open and close strings, and the backslashes of escapes and line
+    // continuations. Everything inside of a string other than its escapes (and stray new lines, which are always an
+    // error) is left out, so the index can be used to find the end of a string, or the end of a line or a tag's
+    // children, without looking at the text in between.
+    //
+    // On x86-64 the text is classified 64 bytes at a time into bitmasks. Escaped characters are found with the
+    // odd-length backslash run trick, and the inside of double-quoted strings with a prefix XOR over the unescaped
+    // quotes. Blocks that involve WYSIWYG (backtick) strings pair their quotes up one by one instead, and the rare
+    // block with a backslash inside of a WYSIWYG string is left to the scalar loop, since backslashes don't escape
+    // anything in there.
+    //
+    // The index can be passed to any of the parse functions through SdlangParseOptions, and can be kept around and
+    // reused by anything else that walks the same text.
+    typedef struct SdlangStructuralIndex
+    {
+        uint32_t *offsets;
+        size_t count;
+        SdlangAllocator _allocator;
+    } SdlangStructuralIndex;
+
+    // Builds an index of `stream`, which must be freed with sdlangStructuralIndexFree even if this fails.
+    // The text can be at most 4GB long.
+    bool sdlangStructuralIndexBuild(SdlangCharStream stream, SdlangStructuralIndex *index, SdlangError *error,
+                                    const SdlangAllocator *allocator = NULL);
+    void sdlangStructuralIndexFree(SdlangStructuralIndex *index);
+
+#ifdef SDLANG_IMPLEMENTATION
+    static inline bool _isStructural(char ch)
+    {
+        return ch == '{' || ch == '}' || ch == '=' || ch == ':' || ch == '\n' || ch == '\r';
+    }
+
+    typedef struct _SdlangIndexState
+    {
+        bool inString;   // Inside of a double-quoted string.
+        bool inWysiwyg;  // Inside of a backtick string.
+        bool escapeNext; // The previous character was a backslash that escapes this one.
+        bool bracesOnly; // Only index braces, for when all that matters is where blocks start and end.
+    } _SdlangIndexState;
+
+    // Indexes [p, end) a character at a time, writing offsets relative to `base`. Returns where it stopped writing.
+    static uint32_t *_indexScalar(const char *p, const char *end, const char *base, _SdlangIndexState *state,
+                                  uint32_t *out)
+    {
+        for (; p < end; p++)
+        {
+            const char ch = *p;
+            bool found = true;
+            if (state->escapeNext)
+                state->escapeNext = found = false;
+            else if (state->inWysiwyg)
+            {
+                found = ch == '`';
+                state->inWysiwyg = !found;
+            }
+            else if (ch == '\\')
+                state->escapeNext = true;
+            else if (ch == '"')
+                state->inString = !state->inString;
+            else if (state->inString)
+                found = ch == '\n' || ch == '\r';
+            else if (ch == '`')
+                state->inWysiwyg = true;
+            else
+                found = _isStructural(ch);
+
+            if (found && (!state->bracesOnly || ch == '{' || ch == '}'))
+                *out++ = (uint32_t)(p - base);
+        }
+        return out;
+    }
+
+#ifdef _SDLANG_SIMD_X86
+    static inline unsigned _sdlangCtz64(uint64_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return (unsigned)index;
+#else
+        return (unsigned)__builtin_ctzll(mask);
+#endif
+    }
+
+    typedef struct _SdlangBlockMasks
+    {
+        uint64_t quote;
+        uint64_t backtick;
+        uint64_t backslash;
+        uint64_t newline;
+        uint64_t structural; // Everything from _isStructural other than new lines.
+        uint64_t braces;
+    } _SdlangBlockMasks;
+
+    static void _classifySse2(const char *p, _SdlangBlockMasks *masks)
+    {
+        const __m128i quote = _mm_set1_epi8('"'), backtick = _mm_set1_epi8('`'), backslash = _mm_set1_epi8('\\'),
+                      cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n'), open = _mm_set1_epi8('{'),
+                      close = _mm_set1_epi8('}'), equals = _mm_set1_epi8('='), colon = _mm_set1_epi8(':');
+        *masks = {};
+        int i;
+        for (i = 0; i < 64; i += 16)
+        {
+            const __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            masks->quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+            masks->backtick |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backtick)) << i;
+            masks->backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << i;
+            masks->newline |=
+                (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)))
+                << i;
+            const __m128i braces = _mm_or_si128(_mm_cmpeq_epi8(v, open), _mm_cmpeq_epi8(v, close));
+            const __m128i other = _mm_or_si128(_mm_cmpeq_epi8(v, equals), _mm_cmpeq_epi8(v, colon));
+            masks->structural |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_or_si128(braces, other)) << i;
+            masks->braces |= (uint64_t)(uint32_t)_mm_movemask_epi8(braces) << i;
+        }
+    }
+
+    _SDLANG_TARGET_AVX2 static void _classifyAvx2(const char *p, _SdlangBlockMasks *masks)
+    {
+        const __m256i quote = _mm256_set1_epi8('"'), backtick = _mm256_set1_epi8('`'),
+                      backslash = _mm256_set1_epi8('\\'), cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n'),
+                      open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}'), equals = _mm256_set1_epi8('='),
+                      colon = _mm256_set1_epi8(':');
+        *masks = {};
+        int i;
+        for (i = 0; i < 64; i += 32)
+        {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+            masks->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+            masks->backtick |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backtick)) << i;
+            masks->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << i;
+            masks->newline |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)))
+                              << i;
+            const __m256i braces = _mm256_or_si256(_mm256_cmpeq_epi8(v, open), _mm256_cmpeq_epi8(v, close));
+            const __m256i other = _mm256_or_si256(_mm256_cmpeq_epi8(v, equals), _mm256_cmpeq_epi8(v, colon));
+            masks->structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(braces, other)) << i;
+            masks->braces |= (uint64_t)(uint32_t)_mm256_movemask_epi8(braces) << i;
+        }
+    }
+
+    // Each bit becomes the XOR of itself and every bit below it, which turns the bits of a string's opening and
+    // closing quotes into a mask of everything from the opening quote up to (but not including) the closing one.
+    static inline uint64_t _prefixXor(uint64_t bits)
+    {
+        bits ^= bits << 1;
+        bits ^= bits << 2;
+        bits ^= bits << 4;
+        bits ^= bits << 8;
+        bits ^= bits << 16;
+        bits ^= bits << 32;
+        return bits;
+    }
+
+    // Finds the characters escaped by a backslash, i.e. the ones following an odd-length run of backslashes.
+    // `carry` says whether the first character of the block is escaped, and is updated for the next block.
+    static inline uint64_t _escaped(uint64_t backslash, uint64_t *carry)
+    {
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        backslash &= ~*carry;
+        const uint64_t followsEscape = (backslash << 1) | *carry;
+        const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+        const uint64_t sum = oddStarts + backslash;
+        *carry = sum < oddStarts;
+        const uint64_t invert = sum << 1;
+        return (evenBits ^ invert) & followsEscape;
+    }
+
+    // The bits from `low` up to (but not including) `high`.
+    static inline uint64_t _bitRange(unsigned low, unsigned high)
+    {
+        return (high == 64 ? ~0ULL : (1ULL << high) - 1) & (~0ULL << low);
+    }
+
+    // Indexes one classified 64 byte block. Returns NULL and leaves the state alone if there's a backslash inside of
+    // a WYSIWYG string, since that would throw off which characters are escaped.
+    static inline uint32_t *_indexMasks(const _SdlangBlockMasks *masks, uint32_t offset, _SdlangIndexState *state,
+                                        uint32_t *out)
+    {
+        uint64_t carry = state->escapeNext;
+        const uint64_t escaped = _escaped(masks->backslash, &carry);
+        const uint64_t quotes = masks->quote & ~escaped;
+        const uint64_t backticks = masks->backtick & ~escaped;
+
+        uint64_t inString = 0, inWysiwyg = 0;
+        bool endsInString, endsInWysiwyg;
+        if (!backticks && !state->inWysiwyg)
+        {
+            inString = _prefixXor(quotes) ^ (state->inString ? ~0ULL : 0);
+            endsInString = (inString >> 63) != 0;
+            endsInWysiwyg = false;
+        }
+        else
+        {
+            // With both kinds of string involved, walk through the quotes in order to pair them up.
+            uint64_t *region = state->inString ? &inString : state->inWysiwyg ? &inWysiwyg : NULL;
+            unsigned regionStart = 0;
+            uint64_t pending;
+            for (pending = quotes | backticks; pending; pending &= pending - 1)
+            {
+                const unsigned bit = _sdlangCtz64(pending);
+                const bool isQuote = (quotes >> bit) & 1;
+                if (!region)
+                {
+                    region = isQuote ? &inString : &inWysiwyg;
+                    regionStart = bit;
+                }
+                else if ((region == &inString) == isQuote)
+                {
+                    *region |= _bitRange(regionStart, bit);
+                    region = NULL;
+                }
+            }
+            if (region)
+                *region |= _bitRange(regionStart, 64);
+            if (masks->backslash & inWysiwyg)
+                return NULL;
+            endsInString = region == &inString;
+            endsInWysiwyg = region == &inWysiwyg;
+        }
+
+        uint64_t found = state->bracesOnly ? (masks->braces & ~escaped & ~inString & ~inWysiwyg)
+                                           : (quotes & ~inWysiwyg) | (backticks & ~inString) |
+                                                 (((masks->backslash | masks->newline) & ~escaped) & ~inWysiwyg) |
+                                                 (masks->structural & ~escaped & ~inString & ~inWysiwyg);
+        state->inString = endsInString;
+        state->inWysiwyg = endsInWysiwyg;
+        state->escapeNext = carry != 0;
+
+        for (; found; found &= found - 1)
+            *out++ = offset + _sdlangCtz64(found);
+        return out;
+    }
+
+    // Indexes as many whole blocks of [at, length) as possible, stopping early at a block that needs the scalar
+    // loop. Returns where it stopped.
+    static size_t _indexBlocksSse2(const char *text, size_t at, size_t length, _SdlangIndexState *state,
+                                   uint32_t **out)
+    {
+        for (; length - at >= 64; at += 64)
+        {
+            _SdlangBlockMasks masks;
+            _classifySse2(text + at, &masks);
+            uint32_t *next = _indexMasks(&masks, (uint32_t)at, state, *out);
+            if (!next)
+                break;
+            *out = next;
+        }
+        return at;
+    }
+
+    _SDLANG_TARGET_AVX2 static size_t _indexBlocksAvx2(const char *text, size_t at, size_t length,
+                                                       _SdlangIndexState *state, uint32_t **out)
+    {
+        for (; length - at >= 64; at += 64)
+        {
+            _SdlangBlockMasks masks;
+            _classifyAvx2(text + at, &masks);
+            // The compiler doesn't always clear the upper halves of the registers before leaving AVX code here, and
+            // then every SSE instruction that follows (in _indexMasks and the caller) pays for the transition.
+            _mm256_zeroupper();
+            uint32_t *next = _indexMasks(&masks, (uint32_t)at, state, *out);
+            if (!next)
+                break;
+            *out = next;
+        }
+        return at;
+    }
+#endif
+
+    // Indexes [at, end) of `text`, where `out` has room for an entry per character. Returns the new end of `out`.
+    static uint32_t *_indexRange(const char *text, size_t at, size_t end, _SdlangIndexState *state, uint32_t *out)
+    {
+        while (at < end)
+        {
+#ifdef _SDLANG_SIMD_X86
+            at = (_simdLevel() >= 2) ? _indexBlocksAvx2(text, at, end, state, &out)
+                                     : _indexBlocksSse2(text, at, end, state, &out);
+#endif
+            // Whatever the blocks couldn't handle: a backslash in a WYSIWYG string, or the tail end of the text.
+            const size_t scalarEnd = end - at < 64 ? end : at + 64;
+            out = _indexScalar(text + at, text + scalarEnd, text, state, out);
+            at = scalarEnd;
+        }
+        return out;
+    }
+
+    bool sdlangStructuralIndexBuild(SdlangCharStream stream, SdlangStructuralIndex *index, SdlangError *error,
+                                    const SdlangAllocator *allocator)
+    {
+        *index = {};
+        index->_allocator = *_allocatorOrDefault(allocator);
+        *error = NULL;
+        if (stream.textLength > UINT32_MAX)
+        {
+            *error = SDLANG_ERROR_TEXT_TOO_LARGE;
+            return false;
+        }
+
+        // The text is indexed a chunk at a time, with room made for the worst case of every character in the chunk
+        // being structural.
+        const size_t chunkSize = 64 * 1024;
+        _SdlangBuffer buffer = {};
+        _SdlangIndexState state = {};
+        size_t at = 0;
+        while (at < stream.textLength)
+        {
+            const size_t chunkEnd = stream.textLength - at < chunkSize ? stream.textLength : at + chunkSize;
+            uint32_t *out = (uint32_t *)_bufferPush(&buffer, &index->_allocator, (chunkEnd - at) * sizeof(uint32_t));
+            if (!out)
+            {
+                _bufferFree(&buffer, &index->_allocator);
+                *error = SDLANG_ERROR_OUT_OF_MEMORY;
+                return false;
+            }
+
+            out = _indexRange(stream.text, at, chunkEnd, &state, out);
+            buffer.length = (char *)out - buffer.data;
+            at = chunkEnd;
+        }
+
+        index->offsets = _SDLANG_SCRATCH(buffer, uint32_t);
+        index->count = _SDLANG_SCRATCH_COUNT(buffer, uint32_t);
+        return true;
+    }
+
+    void sdlangStructuralIndexFree(SdlangStructuralIndex *index)
+    {
+        if (index->offsets)
+            index->_allocator.free(index->_allocator.context, index->offsets);
+        *index = {};
+    }
+#endif
+
     typedef enum SdlangTokenType
     {
         SDLANG_TOKEN_TYPE_NONE = 0,
@@ -189,19 +881,18 @@ extern "C"
         SdlangCharSlice nspace; // Set for TAG_NAME and ATTRIBUTE
         SdlangCharSlice name;   // Set for TAG_NAME and ATTRIBUTE
         bool isAttrib;
+        bool deferred;       // Set for numeric values when deferring them, in which case only `deferredText` is.
+        bool requiresEscape; // Set for strings that contain escapes or line continuations.
 
         union {
-            union {
-                SdlangCharSlice stringValue;
-                bool requiresEscape;
-            };
-
+            SdlangCharSlice stringValue;
             int64_t intValue;
             long double floatValue;
             bool boolValue;
             SdlangTimeSpan timeSpanValue;
             SdlangDate dateValue;
             SdlangDateTime dateTimeValue;
+            SdlangCharSlice deferredText;
         };
     } SdlangToken;
 
@@ -210,6 +901,9 @@ extern "C"
         SdlangCharStream stream;
         SdlangToken front;
         int _state;
+        const uint32_t *_structural; // The next entry of a structural index, if parsing with one.
+        const uint32_t *_structuralEnd;
+        bool _deferValues;
     } SdlangParser;
 
     void sdlangParserNext(SdlangParser *parser, SdlangError *error, SdlangCharSlice *errorLine,
@@ -219,9 +913,8 @@ extern "C"
     static bool _spaces(SdlangParser *parser)
     {
         const size_t start = parser->stream.cursor;
-        while (!sdlangCharStreamEof(&parser->stream) &&
-               (sdlangCharStreamPeek(&parser->stream) == ' ' || sdlangCharStreamPeek(&parser->stream) == '\t'))
-            parser->stream.cursor++;
+        const char *text = parser->stream.text;
+        parser->stream.cursor = _scanSpaces(text + start, text + parser->stream.textLength) - text;
 
         return parser->stream.cursor > start;
     }
@@ -229,9 +922,8 @@ extern "C"
     static bool _newline(SdlangParser *parser)
     {
         const size_t start = parser->stream.cursor;
-        while (!sdlangCharStreamEof(&parser->stream) &&
-               (sdlangCharStreamPeek(&parser->stream) == '\r' || sdlangCharStreamPeek(&parser->stream) == '\n'))
-            parser->stream.cursor++;
+        const char *text = parser->stream.text;
+        parser->stream.cursor = _scanNewlines(text + start, text + parser->stream.textLength) - text;
 
         return parser->stream.cursor > start || sdlangCharStreamEof(&parser->stream);
     }
@@ -239,17 +931,10 @@ extern "C"
     static SdlangCharSlice _identifier(SdlangParser *parser)
     {
         const size_t start = parser->stream.cursor;
+        const char *text = parser->stream.text;
+        parser->stream.cursor = _scanIdentifier(text + start, text + parser->stream.textLength) - text;
 
-        while (!sdlangCharStreamEof(&parser->stream))
-        {
-            const char ch = sdlangCharStreamPeek(&parser->stream);
-            if (!(ch >= 'a' && ch <= 'z') && !(ch >= 'A' && ch <= 'Z') && ch != '_' &&
-                !(ch & 0x80)) // poor man's UTF support.
-                break;
-            parser->stream.cursor++;
-        }
-
-        SdlangCharSlice slice = {parser->stream.text + start, parser->stream.cursor - start};
+        SdlangCharSlice slice = {text + start, parser->stream.cursor - start};
 
         return slice;
     }
@@ -273,6 +958,18 @@ extern "C"
         return name->length > 0;
     }
 
+    // Moves the parser's structural index up to `offset`, returning the entry for it if there is one.
+    static const uint32_t *_structuralSeek(SdlangParser *parser, size_t offset)
+    {
+        const uint32_t *at = parser->_structural;
+        if (!at)
+            return NULL;
+        while (at < parser->_structuralEnd && *at < offset)
+            at++;
+        parser->_structural = at;
+        return (at < parser->_structuralEnd && *at == offset) ? at : NULL;
+    }
+
     static bool _string(SdlangParser *parser, SdlangCharSlice *str, bool *wasUnterminated, bool *needsEscape)
     {
         const char stringCh = sdlangCharStreamPeek(&parser->stream);
@@ -281,6 +978,43 @@ extern "C"
             return false;
         parser->stream.cursor++;
         const size_t start = parser->stream.cursor;
+        const char *text = parser->stream.text;
+
+        // With a structural index the string ends at the next quote in the index, since the only other entries that
+        // can be inside of a string are escapes and stray new lines.
+        const uint32_t *at = _structuralSeek(parser, start - 1);
+        if (at)
+        {
+            for (at++; at < parser->_structuralEnd; at++)
+            {
+                const char ch = text[*at];
+                if (ch == stringCh)
+                {
+                    str->ptr = text + start;
+                    str->length = *at - start;
+                    parser->stream.cursor = *at + 1;
+                    parser->_structural = at + 1;
+                    return true;
+                }
+                else if (ch == '\\')
+                    *needsEscape = stringCh == '"';
+                else // unescaped new line in a normal string
+                {
+                    parser->stream.cursor = *at;
+                    *wasUnterminated = true;
+                    return false;
+                }
+            }
+
+            parser->stream.cursor = parser->stream.textLength;
+            *wasUnterminated = true;
+            return false;
+        }
+
+        // WYSIWYG strings only end at the next backtick, normal strings also stop on escapes and new lines.
+        const char *end = text + parser->stream.textLength;
+        const char escapeCh = (stringCh == '"') ? '\\' : stringCh;
+        const char newlineCh = (stringCh == '"') ? '\n' : stringCh;
 
         while (true)
         {
@@ -289,359 +1023,993 @@ extern "C"
                 *wasUnterminated = true;
                 return false;
             }
-            else if (stringCh == '"' && sdlangCharStreamPeek(&parser->stream) == '\n')
+
+            const char *found = _findAny3(text + parser->stream.cursor, end, stringCh, escapeCh, newlineCh);
+            parser->stream.cursor = found - text;
+            if (found == end)
             {
                 *wasUnterminated = true;
                 return false;
             }
-            else if (stringCh == '"' && sdlangCharStreamPeek(&parser->stream) == '\\')
+            else if (*found == stringCh)
+            {
+                str->ptr = text + start;
+                str->length = parser->stream.cursor - start;
+                parser->stream.cursor++;
+                break;
+            }
+            else if (*found == '\\')
             {
                 *needsEscape = true;
                 parser->stream.cursor += 2;
                 continue;
             }
-            else if (sdlangCharStreamPeek(&parser->stream) == stringCh)
+            else // unescaped new line in a normal string
             {
-                str->ptr = parser->stream.text + start;
-                str->length = parser->stream.cursor - start;
-                parser->stream.cursor++;
-                break;
+                *wasUnterminated = true;
+                return false;
             }
-            else
-                parser->stream.cursor++;
         }
 
         return true;
     }
 
-    static void _number(SdlangParser *parser, int64_t *asInt, long double *asFloat, SdlangTokenType *type,
-                        SdlangError *error)
-    {
-        const size_t start = parser->front.start;
-        bool foundDot = false;
-        char buffer[100];
-        int base = 10;
+    // Numeric conversion.
+    //
+    // Literals are converted straight out of the stream's text without copying them or going through libc, which
+    // also makes the result independent of the process' locale. Integers are accumulated in place with overflow
+    // detection. Decimal floats are split into up to 19 significant digits plus a power of ten, and then converted
+    // with Clinger's fast path when it's exact, the Eisel-Lemire algorithm otherwise, and `strtod` as a last resort
+    // for the rare inputs that neither can round correctly.
 
-        if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '-')
-            parser->stream.cursor++;
+    static inline uint64_t _mul128(uint64_t a, uint64_t b, uint64_t *high)
+    {
+#if defined(__SIZEOF_INT128__)
+        const unsigned __int128 r = (unsigned __int128)a * b;
+        *high = (uint64_t)(r >> 64);
+        return (uint64_t)r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return _umul128(a, b, high);
+#else
+        const uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+        const uint64_t lolo = aLo * bLo, lohi = aLo * bHi, hilo = aHi * bLo, hihi = aHi * bHi;
+        const uint64_t cross = (lolo >> 32) + (uint32_t)hilo + lohi;
+        *high = hihi + (hilo >> 32) + (cross >> 32);
+        return (cross << 32) | (uint32_t)lolo;
+#endif
+    }
 
-        while (true)
+    static inline int _clz64(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return 63 - (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+        return __builtin_clzll(value);
+#else
+        int count = 0;
+        while (!(value & 0x8000000000000000ULL))
         {
-            if (sdlangCharStreamEof(&parser->stream))
-                break;
-            const char ch = sdlangCharStreamPeek(&parser->stream);
-            if (ch == '.')
-            {
-                if (foundDot)
-                {
-                    *error = SDLANG_ERROR_UNEXPECTED_DOT;
-                    return;
-                }
-                foundDot = true;
-            }
-            else if (base == 10 && !(ch >= '0' && ch <= '9'))
-                break;
-            parser->stream.cursor++;
+            value <<= 1;
+            count++;
         }
+        return count;
+#endif
+    }
 
-        const size_t end = parser->stream.cursor;
-        const size_t len = end - start;
-        if (len >= 100)
+    static const int _POWER_OF_FIVE_MIN = -342;
+    static const int _POWER_OF_FIVE_MAX = 308;
+
+    // 128-bit approximations of 5^q for every q in [_POWER_OF_FIVE_MIN, _POWER_OF_FIVE_MAX], normalised so the top
+    // bit is set. Each entry is stored as its high 64 bits followed by its low 64 bits.
+    static const uint64_t _POWERS_OF_FIVE[] = {
+        0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL, 0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+        0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL, 0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+        0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL, 0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+        0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL, 0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+        0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL, 0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+        0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL, 0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+        0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL, 0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+        0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL, 0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+        0x84a57695fe98746dULL, 0x014bb630f7604b57ULL, 0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+        0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL, 0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+        0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL, 0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+        0xfd00b897478238d0ULL, 0x8920b098955522b4ULL, 0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+        0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL, 0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+        0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL, 0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+        0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL, 0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+        0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL, 0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+        0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL, 0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+        0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL, 0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+        0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL, 0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+        0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL, 0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+        0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL, 0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+        0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL, 0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+        0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL, 0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+        0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL, 0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+        0xa37fce126597973cULL, 0xe50ff107bab528a0ULL, 0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+        0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL, 0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+        0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL, 0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+        0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL, 0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+        0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL, 0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+        0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL, 0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+        0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL, 0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+        0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL, 0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+        0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL, 0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+        0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL, 0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+        0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL, 0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+        0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL, 0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+        0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL, 0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+        0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL, 0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+        0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL, 0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+        0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL, 0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+        0xc987434744ac874eULL, 0xa327ffb266b56220ULL, 0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+        0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL, 0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+        0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL, 0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+        0xc0314325637a1939ULL, 0xfa911155fefb5308ULL, 0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+        0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL, 0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+        0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL, 0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+        0xb749faed14125d36ULL, 0xcef980ec671f667bULL, 0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+        0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL, 0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+        0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL, 0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+        0xaecc49914078536dULL, 0x58fae9f773886e18ULL, 0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+        0x888f99797a5e012dULL, 0x6d8406c952429603ULL, 0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+        0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL, 0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+        0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL, 0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+        0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL, 0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+        0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL, 0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+        0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL, 0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+        0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL, 0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+        0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL, 0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+        0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL, 0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+        0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL, 0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+        0xb913179899f68584ULL, 0x28e2557b59846e3fULL, 0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+        0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL, 0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+        0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL, 0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+        0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL, 0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+        0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL, 0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+        0xd77485cb25823ac7ULL, 0x7d633293366b828bULL, 0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+        0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL, 0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+        0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL, 0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+        0xcd795be870516656ULL, 0x67902e276c921f8bULL, 0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+        0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL, 0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+        0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL, 0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+        0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL, 0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+        0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL, 0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+        0xef340a98172aace4ULL, 0x86fb897116c87c34ULL, 0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+        0xbae0a846d2195712ULL, 0x8974836059cca109ULL, 0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+        0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL, 0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+        0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL, 0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+        0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL, 0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+        0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL, 0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+        0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL, 0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+        0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL, 0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+        0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL, 0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+        0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL, 0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+        0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL, 0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+        0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL, 0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+        0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL, 0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+        0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL, 0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+        0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL, 0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+        0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL, 0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+        0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL, 0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+        0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL, 0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+        0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL, 0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+        0x8c974f7383725573ULL, 0x1e414218c73a13fbULL, 0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+        0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL, 0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+        0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL, 0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+        0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL, 0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+        0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL, 0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+        0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL, 0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+        0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL, 0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+        0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL, 0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+        0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL, 0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+        0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL, 0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+        0xbe89523386091465ULL, 0xf6bbb397f1135823ULL, 0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+        0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL, 0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+        0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL, 0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+        0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL, 0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+        0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL, 0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+        0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL, 0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+        0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL, 0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+        0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL, 0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+        0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL, 0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+        0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL, 0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+        0x811ccc668829b887ULL, 0x0806357d5a3f525fULL, 0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+        0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL, 0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+        0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL, 0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+        0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL, 0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+        0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL, 0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+        0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL, 0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+        0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL, 0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+        0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL, 0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+        0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL, 0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+        0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL, 0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+        0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL, 0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+        0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL, 0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+        0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL, 0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+        0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL, 0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+        0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL, 0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+        0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL, 0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+        0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL, 0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+        0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL, 0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+        0xc24452da229b021bULL, 0xfbe85badce996168ULL, 0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+        0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL, 0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+        0xed246723473e3813ULL, 0x290123e9aab23b68ULL, 0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+        0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL, 0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+        0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL, 0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+        0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL, 0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+        0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL, 0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+        0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL, 0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+        0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL, 0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+        0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+        0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+        0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+        0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+        0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+        0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+        0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+        0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+        0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+        0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+        0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+        0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+        0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+        0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+        0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+        0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+        0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+        0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+        0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+        0xc612062576589ddaULL, 0x95364afe032a819eULL, 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+        0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+        0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+        0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+        0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+        0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+        0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+        0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+        0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+        0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+        0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+        0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+        0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, 0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+        0x8000000000000000ULL, 0x0000000000000000ULL, 0xa000000000000000ULL, 0x0000000000000000ULL,
+        0xc800000000000000ULL, 0x0000000000000000ULL, 0xfa00000000000000ULL, 0x0000000000000000ULL,
+        0x9c40000000000000ULL, 0x0000000000000000ULL, 0xc350000000000000ULL, 0x0000000000000000ULL,
+        0xf424000000000000ULL, 0x0000000000000000ULL, 0x9896800000000000ULL, 0x0000000000000000ULL,
+        0xbebc200000000000ULL, 0x0000000000000000ULL, 0xee6b280000000000ULL, 0x0000000000000000ULL,
+        0x9502f90000000000ULL, 0x0000000000000000ULL, 0xba43b74000000000ULL, 0x0000000000000000ULL,
+        0xe8d4a51000000000ULL, 0x0000000000000000ULL, 0x9184e72a00000000ULL, 0x0000000000000000ULL,
+        0xb5e620f480000000ULL, 0x0000000000000000ULL, 0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+        0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+        0xde0b6b3a76400000ULL, 0x0000000000000000ULL, 0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+        0xad78ebc5ac620000ULL, 0x0000000000000000ULL, 0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+        0x878678326eac9000ULL, 0x0000000000000000ULL, 0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+        0xd3c21bcecceda100ULL, 0x0000000000000000ULL, 0x84595161401484a0ULL, 0x0000000000000000ULL,
+        0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+        0x813f3978f8940984ULL, 0x4000000000000000ULL, 0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+        0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+        0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, 0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+        0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+        0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+        0x96769950b50d88f4ULL, 0x1314448000000000ULL, 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+        0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+        0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+        0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+        0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+        0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+        0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+        0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+        0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+        0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+        0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+        0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+        0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+        0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL, 0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+        0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL, 0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+        0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL, 0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+        0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL, 0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+        0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL, 0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+        0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL, 0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+        0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL, 0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+        0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL, 0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+        0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL, 0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+        0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL, 0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+        0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL, 0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+        0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL, 0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+        0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL, 0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+        0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL, 0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+        0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL, 0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+        0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL, 0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+        0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL, 0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+        0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL, 0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+        0x924d692ca61be758ULL, 0x593c2626705f9c56ULL, 0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+        0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL, 0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+        0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL, 0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+        0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL, 0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+        0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL, 0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+        0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL, 0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+        0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL, 0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+        0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL, 0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+        0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL, 0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+        0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL, 0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+        0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL, 0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+        0x9ae757596946075fULL, 0x3375788de9b06958ULL, 0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+        0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL, 0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+        0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL, 0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+        0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL, 0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+        0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL, 0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+        0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL, 0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+        0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL, 0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+        0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL, 0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+        0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL, 0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+        0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL, 0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+        0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL, 0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+        0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL, 0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+        0x802221226be55a64ULL, 0xc2494954da2c9789ULL, 0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+        0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL, 0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+        0x9c69a97284b578d7ULL, 0xff2a760414536efbULL, 0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+        0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL, 0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+        0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL, 0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+        0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL, 0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+        0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL, 0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+        0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL, 0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+        0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL, 0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+        0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL, 0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+        0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL, 0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+        0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL, 0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+        0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL, 0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+        0xa59bc234db398c25ULL, 0x43fab9837e699095ULL, 0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+        0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL, 0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+        0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL, 0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+        0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL, 0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+        0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL, 0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+        0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL, 0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+        0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL, 0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+        0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL, 0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+        0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL, 0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+        0x8fa475791a569d10ULL, 0xf96e017d694487bcULL, 0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+        0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL, 0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+        0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL, 0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+        0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL, 0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+        0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL, 0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+        0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL, 0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+        0x82a45b450226b39cULL, 0xecc0024661173473ULL, 0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+        0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL, 0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+        0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL, 0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+        0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL, 0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+        0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL, 0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+        0x98165af37b2153deULL, 0xc3727a337a8b704aULL, 0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+        0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL, 0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+        0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL, 0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+        0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL, 0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+        0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL, 0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+        0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL, 0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+        0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL, 0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+        0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL, 0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+        0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL, 0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+        0x83ea2b892091e44dULL, 0x934aed0aab460432ULL, 0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+        0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL, 0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+        0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL, 0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+        0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL, 0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+        0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL, 0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+        0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL, 0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+        0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL, 0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+        0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL, 0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+        0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL, 0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+        0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL, 0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+        0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL, 0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+        0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL, 0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+        0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL, 0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+        0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL, 0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+        0x8533285c936b35deULL, 0xd53a88958f87275fULL, 0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+        0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL, 0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+        0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL, 0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+        0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL, 0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+        0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL, 0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+        0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL, 0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+        0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL, 0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+        0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL, 0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+        0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL, 0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+        0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL, 0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+        0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL, 0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+        0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL, 0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+        0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL, 0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+        0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL, 0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+        0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL, 0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+        0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL, 0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+        0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL, 0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+        0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL, 0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+        0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL, 0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+        0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL, 0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+        0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL, 0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+        0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL, 0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+        0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL, 0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+        0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL, 0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+        0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL, 0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+        0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL
+    };
+
+    static const double _EXACT_POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    static inline double _doubleFromBits(uint64_t bits)
+    {
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    // Converts mantissa * 10^exponent into the nearest double using the Eisel-Lemire algorithm. The result is
+    // always correctly rounded as long as `mantissa` holds every significant digit of the number.
+    static double _eiselLemire(uint64_t mantissa, int64_t exponent, bool negative)
+    {
+        const uint64_t sign = (uint64_t)negative << 63;
+        if (mantissa == 0 || exponent < _POWER_OF_FIVE_MIN)
+            return _doubleFromBits(sign);
+        if (exponent > _POWER_OF_FIVE_MAX)
+            return _doubleFromBits(sign | 0x7FF0000000000000ULL);
+
+        const int leadingZeroes = _clz64(mantissa);
+        mantissa <<= leadingZeroes;
+
+        // Only the top 55 bits of the product matter. If the ones below them are all set then the truncated table
+        // entry may have been too small, so pull in the second half of the 128-bit power of five.
+        const size_t index = 2 * (size_t)(exponent - _POWER_OF_FIVE_MIN);
+        uint64_t high;
+        uint64_t low = _mul128(mantissa, _POWERS_OF_FIVE[index], &high);
+        if ((high & 0x1FF) == 0x1FF)
         {
-            *error = SDLANG_ERROR_NUMBER_TOO_LARGE;
-            return;
+            uint64_t secondHigh;
+            _mul128(mantissa, _POWERS_OF_FIVE[index + 1], &secondHigh);
+            low += secondHigh;
+            if (secondHigh > low)
+                high++;
         }
 
-        memcpy(buffer, parser->stream.text + start, len);
-        buffer[len] = '\0';
+        const int upperBit = (int)(high >> 63);
+        const int shift = upperBit + 9;
+        uint64_t bits = high >> shift;
+        int64_t power2 = ((((152170 + 65536) * exponent) >> 16) + 63) + upperBit - leadingZeroes + 1023;
 
-        if (base == 10)
+        if (power2 <= 0) // subnormal
         {
-            if (foundDot)
-            {
-                *type = SDLANG_TOKEN_TYPE_VALUE_FLOATING;
-                *asFloat = atof(buffer);
-            }
-            else
-            {
-                *type = SDLANG_TOKEN_TYPE_VALUE_INTEGER;
-                *asInt = atoll(buffer);
-            }
+            if (-power2 + 1 >= 64)
+                return _doubleFromBits(sign);
+            bits >>= -power2 + 1;
+            bits += bits & 1;
+            bits >>= 1;
+            power2 = (bits < (1ULL << 52)) ? 0 : 1;
+            return _doubleFromBits(sign | ((uint64_t)power2 << 52) | (bits & ((1ULL << 52) - 1)));
         }
-        else
-            assert(false); // TODO
 
-        // Handle number suffix... eventually, it really isn't that big a deal right
-        // now.
-        if (!sdlangCharStreamEof(&parser->stream))
+        // Exactly half way between two doubles, which can only happen for small powers of ten. Round to even.
+        if (low <= 1 && exponent >= -4 && exponent <= 23 && (bits & 3) == 1 && (bits << shift) == high)
+            bits &= ~1ULL;
+
+        bits += bits & 1;
+        bits >>= 1;
+        if (bits >= (2ULL << 52))
         {
-            const char ch = sdlangCharStreamPeek(&parser->stream);
-            if (ch == 'L')
-            {
-                parser->stream.cursor++;
-            }
-            else if (ch == 'F')
-            {
-                parser->stream.cursor++;
-            }
-            else if (ch == 'D')
-            {
-                parser->stream.cursor++;
-            }
+            bits = 1ULL << 52;
+            power2++;
+        }
+        bits &= ~(1ULL << 52);
+
+        if (power2 >= 0x7FF)
+        {
+            power2 = 0x7FF;
+            bits = 0;
         }
+
+        return _doubleFromBits(sign | ((uint64_t)power2 << 52) | bits);
     }
 
-    static void _twoDigits(SdlangParser *parser, int8_t *value, SdlangError *error)
+    // `truncated` means digits after the first 19 significant ones were dropped from `mantissa`.
+    static bool _decimalToDouble(uint64_t mantissa, int64_t exponent, bool truncated, bool negative, double *value)
     {
-        const SdlangCharSlice slice = sdlangCharStreamPeekMany(&parser->stream, 2);
-        if (slice.length != 2)
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+        if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
         {
-            *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
-            return;
+            double d = (double)mantissa;
+            d = (exponent < 0) ? d / _EXACT_POWERS_OF_TEN[-exponent] : d * _EXACT_POWERS_OF_TEN[exponent];
+            *value = negative ? -d : d;
+            return true;
         }
+#endif
+
+        *value = _eiselLemire(mantissa, exponent, negative);
+        if (!truncated)
+            return true;
+
+        // The real value lies somewhere between mantissa and mantissa + 1, so it's only safe if both round the same.
+        return _eiselLemire(mantissa + 1, exponent, negative) == *value;
+    }
+
+    // Last resort for floats that the fast paths can't round correctly. `strtod` needs a terminated string in the
+    // current locale's format, so this is the only place a number gets copied.
+    static bool _slowFloat(const char *text, size_t length, double *value)
+    {
+        char buffer[800];
+        if (length >= sizeof(buffer))
+            return false;
 
-        char buffer[3] = {slice.ptr[0], slice.ptr[1], '\0'};
+        memcpy(buffer, text, length);
+        buffer[length] = '\0';
 
-        *value = atoi(buffer);
-        if (*value == 0 && strcmp("00", buffer) != 0) // atoi failed
+        const char decimalPoint = localeconv()->decimal_point[0];
+        size_t i;
+        for (i = 0; i < length; i++)
         {
-            *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
-            return;
+            if (buffer[i] == '.')
+                buffer[i] = decimalPoint;
         }
-        parser->stream.cursor += 2;
 
-        return;
+        *value = strtod(buffer, NULL);
+        return true;
     }
 
-    static void _timespan(SdlangParser *parser, SdlangTimeSpan *timeSpan, SdlangError *error)
+    static inline int _digitValue(const char ch)
     {
-        bool isDays;
+        if (ch >= '0' && ch <= '9')
+            return ch - '0';
+        else if (ch >= 'a' && ch <= 'f')
+            return ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F')
+            return ch - 'A' + 10;
+        return 99;
+    }
 
-        if (sdlangCharStreamPeek(&parser->stream) == '-')
+    // Turns the magnitude of an integer into an int64_t, failing if it doesn't fit.
+    static bool _signedInteger(uint64_t magnitude, bool negative, int64_t *value)
+    {
+        if (negative)
         {
-            parser->stream.cursor++;
-            timeSpan->isNegative = true;
+            if (magnitude > (uint64_t)INT64_MAX + 1)
+                return false;
+            *value = (int64_t)(0 - magnitude);
         }
         else
-            timeSpan->isNegative = false;
+        {
+            if (magnitude > (uint64_t)INT64_MAX)
+                return false;
+            *value = (int64_t)magnitude;
+        }
+        return true;
+    }
 
-        const size_t start = parser->stream.cursor;
-        while (true)
+    // The digits of a decimal number, gathered as they're read. Only the first 19 significant digits fit into
+    // `mantissa`, any past that bump `exponent` instead (and set `truncated` if they weren't zero).
+    typedef struct _SdlangDecimal
+    {
+        uint64_t mantissa;
+        int64_t exponent;
+        int significantDigits;
+        size_t digits; // Every digit read before the decimal point, leading zeroes included.
+        bool truncated;
+    } _SdlangDecimal;
+
+    static inline bool _isDigit(const char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    }
+
+    static size_t _integerDigits(const char *text, size_t i, const size_t end, _SdlangDecimal *decimal)
+    {
+        for (; i < end && _isDigit(text[i]); i++)
         {
-            if (sdlangCharStreamEof(&parser->stream))
-            {
-                *error = SDLANG_ERROR_UNEXPECTED_EOF;
-                return;
-            }
-            else if (sdlangCharStreamPeek(&parser->stream) == 'd')
+            const int digit = text[i] - '0';
+            decimal->digits++;
+            if (!decimal->mantissa && !digit)
+                continue;
+            if (decimal->significantDigits < 19)
             {
-                isDays = true;
-                break;
+                decimal->mantissa = decimal->mantissa * 10 + digit;
+                decimal->significantDigits++;
             }
-            else if (sdlangCharStreamPeek(&parser->stream) == ':')
+            else
             {
-                isDays = false;
-                break;
+                decimal->exponent++;
+                decimal->truncated = decimal->truncated || digit;
             }
-            else
-                parser->stream.cursor++;
         }
-        parser->stream.cursor = start;
+        return i;
+    }
 
-        if (isDays)
+    // Reads a field made of exactly two digits, such as the month of a date. On failure `i` is left on the
+    // offending character (or the end of the text).
+    static bool _twoDigits(const char *text, size_t *i, const size_t end, int8_t *value)
+    {
+        if (*i >= end || !_isDigit(text[*i]))
+            return false;
+        if (*i + 1 >= end || !_isDigit(text[*i + 1]))
         {
-            long double _1;
-            SdlangTokenType type;
-            _number(parser, &timeSpan->days, &_1, &type, error);
-            if (*error)
-                return;
-            else if (type == SDLANG_TOKEN_TYPE_VALUE_FLOATING)
-            {
-                *error = SDLANG_ERROR_EXPECTED_INTEGER;
-                return;
-            }
-
-            parser->stream.cursor++; // Skip the 'd'
-            if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamEat(&parser->stream) != ':')
-            {
-                *error = SDLANG_ERROR_EXPECTED_COLON;
-                return;
-            }
+            (*i)++;
+            return false;
         }
 
-        _twoDigits(parser, &timeSpan->hours, error);
-        if (*error)
-            return;
+        *value = (int8_t)((text[*i] - '0') * 10 + (text[*i + 1] - '0'));
+        *i += 2;
+        return true;
+    }
 
-        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamEat(&parser->stream) != ':')
+    static inline bool _expect(const char *text, size_t *i, const size_t end, const char ch)
+    {
+        if (*i >= end || text[*i] != ch)
+            return false;
+        (*i)++;
+        return true;
+    }
+
+    // Reads ":MM:SS" and an optional ".mmm" that follow the hours of a time.
+    static SdlangError _clockTime(const char *text, size_t *i, const size_t end, SdlangTimeSpan *time)
+    {
+        if (!_expect(text, i, end, ':'))
+            return SDLANG_ERROR_EXPECTED_COLON;
+        if (!_twoDigits(text, i, end, &time->minutes))
+            return SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+        if (!_expect(text, i, end, ':'))
+            return SDLANG_ERROR_EXPECTED_COLON;
+        if (!_twoDigits(text, i, end, &time->seconds))
+            return SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+
+        time->milliseconds = 0;
+        if (!_expect(text, i, end, '.'))
+            return SDLANG_ERROR_NONE;
+
+        const size_t start = *i;
+        for (; *i < end && _isDigit(text[*i]); (*i)++)
         {
-            *error = SDLANG_ERROR_EXPECTED_COLON;
-            return;
+            if (*i - start >= 18)
+                return SDLANG_ERROR_INTEGER_OVERFLOW;
+            time->milliseconds = time->milliseconds * 10 + (text[*i] - '0');
         }
+        return (*i == start) ? SDLANG_ERROR_EXPECTED_INTEGER : SDLANG_ERROR_NONE;
+    }
 
-        _twoDigits(parser, &timeSpan->minutes, error);
-        if (*error)
-            return;
-        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamEat(&parser->stream) != ':')
+    // Finishes off a number once its leading digits have been read: radix prefixes, fractions, exponents, and
+    // suffixes. `cursor` is positioned just after the leading digits. Unless `convertFloat` is set, floats are only
+    // checked, not converted.
+    static SdlangError _numberTail(const char *text, size_t start, size_t *cursor, const size_t end, bool negative,
+                                   _SdlangDecimal *decimal, bool convertFloat, int64_t *asInt, long double *asFloat,
+                                   SdlangTokenType *type)
+    {
+        size_t i = *cursor;
+
+        // Hex (0x), octal (0o), and binary (0b) integers.
+        int base = 10;
+        if (decimal->digits == 1 && !decimal->mantissa && i < end)
         {
-            *error = SDLANG_ERROR_EXPECTED_COLON;
-            return;
+            const char prefix = text[i];
+            if (prefix == 'x' || prefix == 'X')
+                base = 16;
+            else if (prefix == 'o' || prefix == 'O')
+                base = 8;
+            else if (prefix == 'b' || prefix == 'B')
+                base = 2;
         }
 
-        _twoDigits(parser, &timeSpan->seconds, error);
-        if (*error)
-            return;
-        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamPeek(&parser->stream) != '.')
-            return;
-        parser->stream.cursor++;
+        if (base != 10)
+        {
+            const size_t digitsStart = ++i;
+            uint64_t magnitude = 0;
+            bool overflowed = false;
+            int digit;
 
-        long double _1;
-        SdlangTokenType type;
-        _number(parser, &timeSpan->milliseconds, &_1, &type, error);
-        if (*error)
-            return;
-        else if (type == SDLANG_TOKEN_TYPE_VALUE_FLOATING)
+            for (; i < end && (digit = _digitValue(text[i])) < base; i++)
+            {
+                if (magnitude > (UINT64_MAX - digit) / base)
+                    overflowed = true;
+                magnitude = magnitude * base + digit;
+            }
+
+            *cursor = i;
+            if (i == digitsStart)
+                return SDLANG_ERROR_EXPECTED_INTEGER;
+            if (overflowed || !_signedInteger(magnitude, negative, asInt))
+                return SDLANG_ERROR_INTEGER_OVERFLOW;
+            *type = SDLANG_TOKEN_TYPE_VALUE_INTEGER;
+        }
+        else
         {
-            *error = SDLANG_ERROR_EXPECTED_INTEGER;
-            return;
+            bool isFloat = false, anyDigits = decimal->digits > 0;
+
+            if (i < end && text[i] == '.')
+            {
+                isFloat = true;
+                for (i++; i < end && _isDigit(text[i]); i++)
+                {
+                    const int digit = text[i] - '0';
+                    anyDigits = true;
+                    if (!decimal->mantissa && !digit)
+                        decimal->exponent--;
+                    else if (decimal->significantDigits < 19)
+                    {
+                        decimal->mantissa = decimal->mantissa * 10 + digit;
+                        decimal->significantDigits++;
+                        decimal->exponent--;
+                    }
+                    else
+                        decimal->truncated = decimal->truncated || digit;
+                }
+
+                if (i < end && text[i] == '.')
+                {
+                    *cursor = i;
+                    return SDLANG_ERROR_UNEXPECTED_DOT;
+                }
+            }
+
+            // Exponents are only consumed if there's actually a number after the 'e'.
+            if (anyDigits && i < end && (text[i] == 'e' || text[i] == 'E'))
+            {
+                size_t j = i + 1;
+                const bool negativeExponent = j < end && text[j] == '-';
+                if (j < end && (text[j] == '-' || text[j] == '+'))
+                    j++;
+                if (j < end && _isDigit(text[j]))
+                {
+                    int64_t explicitExponent = 0;
+                    for (; j < end && _isDigit(text[j]); j++)
+                    {
+                        if (explicitExponent < 100000) // Anything past this is zero or infinity anyway.
+                            explicitExponent = explicitExponent * 10 + (text[j] - '0');
+                    }
+                    decimal->exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                    isFloat = true;
+                    i = j;
+                }
+            }
+
+            *cursor = i;
+            if (!anyDigits)
+                return SDLANG_ERROR_EXPECTED_INTEGER;
+
+            if (isFloat)
+            {
+                // Only a truncated float too long for _slowFloat can fail to convert, so that's the only kind that
+                // has to be converted just to check it.
+                double value;
+                if ((convertFloat || (decimal->truncated && i - start >= 800)) &&
+                    !_decimalToDouble(decimal->mantissa, decimal->exponent, decimal->truncated, negative, &value) &&
+                    !_slowFloat(text + start, i - start, &value))
+                    return SDLANG_ERROR_NUMBER_TOO_LARGE;
+                *type = SDLANG_TOKEN_TYPE_VALUE_FLOATING;
+                if (convertFloat)
+                    *asFloat = value;
+            }
+            else
+            {
+                if (decimal->exponent || !_signedInteger(decimal->mantissa, negative, asInt))
+                    return SDLANG_ERROR_INTEGER_OVERFLOW;
+                *type = SDLANG_TOKEN_TYPE_VALUE_INTEGER;
+            }
         }
 
-        return;
+        // Handle number suffix... eventually, it really isn't that big a deal right
+        // now.
+        if (*cursor < end && (text[*cursor] == 'L' || text[*cursor] == 'F' || text[*cursor] == 'D'))
+            (*cursor)++;
+
+        return SDLANG_ERROR_NONE;
     }
 
-    static void _dateTime(SdlangParser *parser, SdlangDate *date, SdlangDateTime *dateTime, SdlangTokenType *type,
-                          SdlangError *error)
+    // Parses a number, date, date time, or time span in a single pass.
+    //
+    // All of them start with an optional '-' and a run of digits, which is accumulated as it's read. The character
+    // after that run decides what the literal is: '/' for dates, ':' or 'd' for time spans, and anything else for
+    // plain numbers. Every other field is then accumulated as it's read too, so no character is looked at twice.
+    static void _someNumeric(SdlangParser *parser, int64_t *asInt, long double *asFloat, SdlangTimeSpan *asTimespan,
+                             SdlangDate *asDate, SdlangDateTime *asDateTime, SdlangTokenType *type, SdlangError *error)
     {
-        SdlangDate dateLocal;
+        const char *text = parser->stream.text;
+        const size_t end = parser->stream.textLength;
+        const size_t start = parser->stream.cursor;
+        size_t i = start;
 
-        long double _1;
-        SdlangTokenType intType;
-        _number(parser, &dateLocal.year, &_1, &intType, error);
-        if (*error)
-            return;
-        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamEat(&parser->stream) != '/')
-        {
-            *error = SDLANG_ERROR_EXPECTED_SLASH;
-            return;
-        }
+        const bool negative = i < end && text[i] == '-';
+        if (negative)
+            i++;
 
-        _twoDigits(parser, &dateLocal.month, error);
-        if (*error)
-            return;
-        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamEat(&parser->stream) != '/')
+        _SdlangDecimal lead = {};
+        i = _integerDigits(text, i, end, &lead);
+        const char next = (i < end) ? text[i] : '\0';
+        const bool leadFits = lead.digits && !lead.exponent && lead.mantissa <= (uint64_t)INT64_MAX;
+
+        if (next == '/')
         {
-            *error = SDLANG_ERROR_EXPECTED_SLASH;
+            SdlangDate date;
+            i++;
+
+            if (!leadFits)
+                *error = lead.digits ? SDLANG_ERROR_INTEGER_OVERFLOW : SDLANG_ERROR_EXPECTED_INTEGER;
+            else if (!_twoDigits(text, &i, end, &date.month))
+                *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+            else if (!_expect(text, &i, end, '/'))
+                *error = SDLANG_ERROR_EXPECTED_SLASH;
+            else if (!_twoDigits(text, &i, end, &date.day))
+                *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+
+            parser->stream.cursor = i;
+            if (*error)
+                return;
+            date.year = negative ? -(int64_t)lead.mantissa : (int64_t)lead.mantissa;
+
+            // A time may follow after some whitespace. If it doesn't fully parse then this is just a date, and the
+            // cursor stays at the end of it.
+            size_t j = _scanSpaces(text + i, text + end) - text;
+            SdlangTimeSpan time = {};
+            if (j > i && _twoDigits(text, &j, end, &time.hours) && !_clockTime(text, &j, end, &time))
+            {
+                asDateTime->date = date;
+                asDateTime->time = time;
+                *type = SDLANG_TOKEN_TYPE_VALUE_DATETIME;
+                parser->stream.cursor = j;
+            }
+            else
+            {
+                *asDate = date;
+                *type = SDLANG_TOKEN_TYPE_VALUE_DATE;
+            }
             return;
         }
+        else if (next == ':' || (next == 'd' && lead.digits))
+        {
+            SdlangTimeSpan span = {};
+            span.isNegative = negative;
 
-        _twoDigits(parser, &dateLocal.day, error);
-        if (*error)
-            return;
+            if (next == 'd')
+            {
+                i++;
+                span.days = (int64_t)lead.mantissa;
+                if (!leadFits)
+                    *error = SDLANG_ERROR_INTEGER_OVERFLOW;
+                else if (!_expect(text, &i, end, ':'))
+                    *error = SDLANG_ERROR_EXPECTED_COLON;
+                else if (!_twoDigits(text, &i, end, &span.hours))
+                    *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+            }
+            else if (lead.digits != 2)
+                *error = SDLANG_ERROR_EXPECTED_TWO_DIGITS;
+            else
+                span.hours = (int8_t)lead.mantissa;
 
-        _spaces(parser);
+            if (!*error)
+                *error = _clockTime(text, &i, end, &span);
 
-        if (sdlangCharStreamEof(&parser->stream))
-        {
-            *date = dateLocal;
-            *type = SDLANG_TOKEN_TYPE_VALUE_DATE;
+            parser->stream.cursor = i;
+            if (*error)
+                return;
+            *asTimespan = span;
+            *type = SDLANG_TOKEN_TYPE_VALUE_TIMESPAN;
             return;
         }
 
-        SdlangTimeSpan timeSpan;
-        _timespan(parser, &timeSpan, error);
+        *error = _numberTail(text, start, &i, end, negative, &lead, !parser->_deferValues, asInt, asFloat, type);
+        parser->stream.cursor = i;
+    }
 
-        if (!*error)
+    // Returns true if the identifier that was just read is one of the keyword values, filling in the token if so.
+    static bool _keyword(SdlangParser *parser)
+    {
+        const SdlangCharSlice name = parser->front.name;
+        if (parser->front.nspace.length)
+            return false;
+
+        if ((name.length == 4 && memcmp("true", name.ptr, 4) == 0) ||
+            (name.length == 2 && memcmp("on", name.ptr, 2) == 0))
         {
-            dateTime->date = dateLocal;
-            dateTime->time = timeSpan;
-            *type = SDLANG_TOKEN_TYPE_VALUE_DATETIME;
+            parser->front.boolValue = true;
+            parser->front.type = SDLANG_TOKEN_TYPE_VALUE_BOOLEAN;
         }
-        else
+        else if ((name.length == 5 && memcmp("false", name.ptr, 5) == 0) ||
+                 (name.length == 3 && memcmp("off", name.ptr, 3) == 0))
         {
-            *date = dateLocal;
-            *type = SDLANG_TOKEN_TYPE_VALUE_DATE;
+            parser->front.boolValue = false;
+            parser->front.type = SDLANG_TOKEN_TYPE_VALUE_BOOLEAN;
         }
-        *error = SDLANG_ERROR_NONE;
+        else if (name.length == 4 && memcmp("null", name.ptr, 4) == 0)
+            parser->front.type = SDLANG_TOKEN_TYPE_VALUE_NULL;
+        else
+            return false;
 
-        return;
+        parser->front.end = parser->stream.cursor;
+        return true;
     }
 
-    static void _someNumeric(SdlangParser *parser, int64_t *asInt, long double *asFloat, SdlangTimeSpan *asTimespan,
-                             SdlangDate *asDate, SdlangDateTime *asDateTime, SdlangTokenType *type, SdlangError *error)
+    // Parses a string or numeric value starting at the cursor. Keyword values are handled by `_keyword`.
+    static bool _value(SdlangParser *parser, SdlangError *error, SdlangCharSlice *errorLine)
     {
-        const size_t start = parser->stream.cursor;
-        while (true)
+        const char ch = sdlangCharStreamPeek(&parser->stream);
+
+        bool wasUnterminated = false;
+        const bool isString =
+            _string(parser, &parser->front.stringValue, &wasUnterminated, &parser->front.requiresEscape);
+        if (!isString && wasUnterminated)
         {
-            if (sdlangCharStreamEof(&parser->stream))
-            {
-                parser->stream.cursor = start;
-                return _number(parser, asInt, asFloat, type, error);
-            }
+            *error = SDLANG_ERROR_UNTERMINATED_STRING;
+            *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
+            return false;
+        }
+        else if (isString)
+        {
+            parser->front.end = parser->stream.cursor;
+            parser->front.type = SDLANG_TOKEN_TYPE_VALUE_STRING;
+            return true;
+        }
 
-            const char ch = sdlangCharStreamPeek(&parser->stream);
-            if (ch == ':' || ch == 'd')
-            {
-                parser->stream.cursor = start;
-                *type = SDLANG_TOKEN_TYPE_VALUE_TIMESPAN;
-                _timespan(parser, asTimespan, error);
-                return;
-            }
-            else if (ch == '/')
-            {
-                parser->stream.cursor = start;
-                _dateTime(parser, asDate, asDateTime, type, error);
-                return;
-            }
-            else if ((ch >= '0' && ch <= '9') || ch == '-')
+        if (ch == '-' || (ch >= '0' && ch <= '9'))
+        {
+            const size_t start = parser->stream.cursor;
+            _someNumeric(parser, &parser->front.intValue, &parser->front.floatValue, &parser->front.timeSpanValue,
+                         &parser->front.dateValue, &parser->front.dateTimeValue, &parser->front.type, error);
+            if (*error)
             {
-                parser->stream.cursor++;
-                continue;
+                *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
+                return false;
             }
-            else
+
+            if (parser->_deferValues)
             {
-                parser->stream.cursor = start;
-                _number(parser, asInt, asFloat, type, error);
-                return;
+                parser->front.deferred = true;
+                parser->front.deferredText.ptr = parser->stream.text + start;
+                parser->front.deferredText.length = parser->stream.cursor - start;
             }
+            parser->front.end = parser->stream.cursor;
+            return true;
         }
-        assert(false);
+
+        return false;
     }
 
     void sdlangParserNext(SdlangParser *parser, SdlangError *error, SdlangCharSlice *errorLine,
                           SdlangCharSlice *errorSlice)
     {
         parser->front.isAttrib = false;
+        parser->front.deferred = false;
+        parser->front.requiresEscape = false;
         parser->front.nspace = {};
         parser->front.name = {};
         *error = NULL;
-        if (sdlangCharStreamEof(&parser->stream))
-        {
-            parser->front.type = SDLANG_TOKEN_TYPE_EOF;
-            return;
-        }
 
-        const char ch = sdlangCharStreamPeek(&parser->stream);
-        if (ch == ' ' || ch == '\t')
+        // Skip over whitespace and line continuations without recursing, so long chains of either can't blow the
+        // stack.
+        char ch;
+        while (true)
         {
-            _spaces(parser);
-            sdlangParserNext(parser, error, errorLine, errorSlice);
-            return;
+            if (sdlangCharStreamEof(&parser->stream))
+            {
+                parser->front.type = SDLANG_TOKEN_TYPE_EOF;
+                parser->front.start = parser->front.end = parser->stream.textLength;
+                return;
+            }
+
+            ch = sdlangCharStreamPeek(&parser->stream);
+            if (ch == ' ' || ch == '\t')
+                _spaces(parser);
+            else if (ch == '\\')
+                parser->stream.cursor += 2;
+            else
+                break;
         }
-        else if (ch == '\n' || ch == '\r')
+
+        if (ch == '\n' || ch == '\r' || ch == ';') // A semicolon ends a tag just like a new line does.
         {
-            _newline(parser);
+            parser->front.start = parser->stream.cursor;
+            if (ch == ';')
+                parser->stream.cursor++;
+            else
+                _newline(parser);
+            parser->front.end = parser->stream.cursor;
             parser->_state = _STATE_LOOKING_FOR_TAG_START;
             parser->front.type = SDLANG_TOKEN_TYPE_NEWLINE;
             return;
         }
-        else if (ch == '\\')
-        {
-            parser->stream.cursor += 2;
-            sdlangParserNext(parser, error, errorLine, errorSlice);
-            return;
-        }
 
-        bool foundIdent = false, isString = false, wasUnterminated = false, isIdent = false;
+        bool foundIdent = false, isIdent = false;
 
         switch (parser->_state)
         {
@@ -653,6 +2021,7 @@ extern "C"
                 parser->front.end = parser->front.start;
                 parser->front.type = SDLANG_TOKEN_TYPE_CHILDREN_END;
                 parser->stream.cursor++;
+                parser->_state = _STATE_READING_TAG; // The rest of the line still belongs to the parent tag.
                 return;
             }
 
@@ -677,7 +2046,9 @@ extern "C"
                 parser->_state = _STATE_LOOKING_FOR_TAG_START;
 
                 _spaces(parser);
-                if (!_newline(parser))
+                if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == ';')
+                    parser->stream.cursor++;
+                else if (!_newline(parser))
                 {
                     *error = SDLANG_ERROR_EXPECTED_NEWLINE;
                     *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
@@ -691,35 +2062,11 @@ extern "C"
             isIdent = _identifierWithNamespace(parser, &parser->front.nspace, &parser->front.name);
             if (isIdent)
             {
-                // check for bools and null
-                if (parser->front.name.length && !parser->front.nspace.length)
-                {
-                    if (strncmp("true", parser->front.name.ptr, 4) == 0 ||
-                        strncmp("on", parser->front.name.ptr, 2) == 0)
-                    {
-                        parser->front.end = parser->stream.cursor;
-                        parser->front.boolValue = true;
-                        parser->front.type = SDLANG_TOKEN_TYPE_VALUE_BOOLEAN;
-                        return;
-                    }
-                    else if (strncmp("false", parser->front.name.ptr, 5) == 0 ||
-                             strncmp("off", parser->front.name.ptr, 3) == 0)
-                    {
-                        parser->front.end = parser->stream.cursor;
-                        parser->front.boolValue = false;
-                        parser->front.type = SDLANG_TOKEN_TYPE_VALUE_BOOLEAN;
-                        return;
-                    }
-                    else if (strncmp("null", parser->front.name.ptr, 4) == 0)
-                    {
-                        parser->front.end = parser->stream.cursor;
-                        parser->front.type = SDLANG_TOKEN_TYPE_VALUE_NULL;
-                        return;
-                    }
-                }
-                // otherwise it's an identifier.
+                if (_keyword(parser))
+                    return;
 
-                if (sdlangCharStreamPeek(&parser->stream) != '=')
+                // otherwise it's an attribute name, so parse its value in place.
+                if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamPeek(&parser->stream) != '=')
                 {
                     *error = SDLANG_ERROR_EXPECTED_EQUALS;
                     *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
@@ -727,75 +2074,50 @@ extern "C"
                 }
                 parser->stream.cursor++;
 
-                // We'll use ParseNext again.
-                const size_t start = parser->stream.cursor;
-                const SdlangToken tokenCopy = parser->front;
-                sdlangParserNext(parser, error, errorLine, errorSlice);
-                if (*error)
-                    return;
-                if (parser->front.start != start)
+                const SdlangCharSlice nspace = parser->front.nspace;
+                const SdlangCharSlice name = parser->front.name;
+                const size_t start = parser->front.start;
+                bool foundValue = false;
+
+                if (!sdlangCharStreamEof(&parser->stream))
                 {
-                    *error = SDLANG_ERROR_EXPECTED_VALUE;
-                    *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
-                    return;
+                    const char valueCh = sdlangCharStreamPeek(&parser->stream);
+                    if (_isIdentifierChar(valueCh))
+                        foundValue = _identifierWithNamespace(parser, &parser->front.nspace, &parser->front.name) &&
+                                     _keyword(parser);
+                    else
+                    {
+                        foundValue = _value(parser, error, errorLine);
+                        if (*error)
+                            return;
+                    }
                 }
 
-                parser->front.nspace = tokenCopy.nspace;
-                parser->front.name = tokenCopy.name;
-
                 // Only certain types can be attribute values.
-                switch (parser->front.type)
+                if (!foundValue || parser->front.type == SDLANG_TOKEN_TYPE_VALUE_NULL)
                 {
-                case SDLANG_TOKEN_TYPE_VALUE_BOOLEAN:
-                case SDLANG_TOKEN_TYPE_VALUE_DATE:
-                case SDLANG_TOKEN_TYPE_VALUE_DATETIME:
-                case SDLANG_TOKEN_TYPE_VALUE_TIMESPAN:
-                case SDLANG_TOKEN_TYPE_VALUE_FLOATING:
-                case SDLANG_TOKEN_TYPE_VALUE_INTEGER:
-                case SDLANG_TOKEN_TYPE_VALUE_STRING:
-                    break;
-
-                default:
                     *error = SDLANG_ERROR_EXPECTED_VALUE;
                     *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
                     return;
                 }
 
+                parser->front.start = start;
+                parser->front.nspace = nspace;
+                parser->front.name = name;
                 parser->front.isAttrib = true;
                 return;
             }
 
-            // Otherwise, it must be a value.
-            wasUnterminated = false;
-            isString = _string(parser, &parser->front.stringValue, &wasUnterminated, &parser->front.requiresEscape);
-            if (!isString && wasUnterminated)
+            // Otherwise, it must be a value. A namespace that ran into the end of the text (`ns:`) leaves nothing
+            // to read one from.
+            if (sdlangCharStreamEof(&parser->stream))
             {
-                *error = SDLANG_ERROR_UNTERMINATED_STRING;
-                *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
+                *error = SDLANG_ERROR_UNEXPECTED_EOF;
+                *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->front.start);
                 return;
             }
-            else if (isString)
-            {
-                parser->front.end = parser->stream.cursor;
-                parser->front.type = SDLANG_TOKEN_TYPE_VALUE_STRING;
+            if (_value(parser, error, errorLine) || *error)
                 return;
-            }
-
-            if (ch == '-' || (ch >= '0' && ch <= '9'))
-            {
-                _someNumeric(parser, &parser->front.intValue, &parser->front.floatValue, &parser->front.timeSpanValue,
-                             &parser->front.dateValue, &parser->front.dateTimeValue, &parser->front.type, error);
-                if (*error)
-                {
-                    *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
-                    return;
-                }
-                else
-                {
-                    parser->front.end = parser->stream.cursor;
-                    return;
-                }
-            }
 
             *error = SDLANG_ERROR_UNEXPECTED_CHARACTER;
             *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->stream.cursor);
@@ -807,440 +2129,4153 @@ extern "C"
     }
 #endif
 
-    typedef enum SdlangValueType
-    {
-        SDLANG_VALUE_TYPE_STRING,
-        SDLANG_VALUE_TYPE_INTEGER,
-        SDLANG_VALUE_TYPE_FLOATING,
-        SDLANG_VALUE_TYPE_BOOLEAN,
-        SDLANG_VALUE_TYPE_DATETIME,
-        SDLANG_VALUE_TYPE_DATE,
-        SDLANG_VALUE_TYPE_TIMESPAN,
-        SDLANG_VALUE_TYPE_NULL,
-    } SdlangValueType;
-
-    typedef struct SdlangValue
-    {
-        SdlangValueType type;
-        union {
-            union {
-                SdlangCharSlice stringValue;
-                bool requiresEscape;
-            };
-
-            int64_t intValue;
-            long double floatValue;
-            bool boolValue;
-            SdlangTimeSpan timeSpanValue;
-            SdlangDate dateValue;
-            SdlangDateTime dateTimeValue;
-        };
-    } SdlValue;
-
-    typedef struct SdlangAttribute
-    {
-        SdlangCharSlice nspace;
-        SdlangCharSlice name;
-        SdlangValue value;
-    } SdlangAttribute;
+    // Called for every token a push parser completes, including the final EOF token. The token's slices point into
+    // either the chunk that was just fed or the parser's own carry-over buffer, so they're only valid until the
+    // callback returns. The token's `start` and `end` are offsets from the start of the whole document.
+    // Return an error message to stop parsing, or NULL to carry on.
+    //
+    // Error slices reported by a push parser point into its carry-over buffer, so they stay valid until
+    // sdlangPushParserFree is called, which must always be done once finished with the parser.
+    typedef const char *(*SdlangPushTokenFunc)(const SdlangToken *token, void *userData);
 
-    typedef struct SdlangTag
+    typedef struct SdlangPushParser
     {
-        SdlangCharSlice nspace;
-        SdlangCharSlice name;
-        SdlangAttribute *attributes;
-        SdlangValue *values;
-        SdlangTag *children;
-    } SdlangTag;
-
-    bool sdlangParseCharStream(SdlangCharStream stream, SdlangTag *rootTag, SdlangError *error,
-                               SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice);
-    void sdlangTagFree(SdlangTag tag);
+        SdlangParser _tokenizer;
+        SdlangPushTokenFunc _onToken;
+        void *_userData;
+        _SdlangBuffer _carry; // The start of a token that straddles two chunks.
+        size_t _carryOffset;  // Document offset of _carry.data[0].
+        size_t _offset;       // Document offset of the next chunk.
+        SdlangError _error;
+        SdlangAllocator _allocator;
+    } SdlangPushParser;
+
+    void sdlangPushParserInit(SdlangPushParser *parser, SdlangPushTokenFunc onToken, void *userData,
+                              const SdlangAllocator *allocator = NULL);
+    bool sdlangPushParserFeed(SdlangPushParser *parser, const char *chunk, size_t length, SdlangError *error,
+                              SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice);
+    bool sdlangPushParserFinish(SdlangPushParser *parser, SdlangError *error, SdlangCharSlice *errorLine,
+                                SdlangCharSlice *errorSlice);
+    void sdlangPushParserFree(SdlangPushParser *parser);
 
 #ifdef SDLANG_IMPLEMENTATION
-    void sdlangTagFree(SdlangTag tag)
-    {
-        size_t i;
+    static const int _PUSH_DONE = 0;
+    static const int _PUSH_INCOMPLETE = 1;
+    static const int _PUSH_ERROR = 2;
 
-        if (tag.children)
-        {
-            for (i = 0; i < arrlen(tag.children); i++)
-                sdlangTagFree(tag.children[i]);
-            arrfree(tag.children);
-        }
-
-        if (tag.attributes)
-            arrfree(tag.attributes);
-
-        if (tag.values)
-            arrfree(tag.values);
-    }
-
-    static SdlangValue _nextValue(SdlangToken token, SdlangError *error)
+    // Whether the token that was just read could turn out differently once more input arrives.
+    static bool _pushTokenIncomplete(const SdlangParser *parser, SdlangError error)
     {
-        SdlangValue v;
+        const char *text = parser->stream.text;
+        const size_t end = parser->stream.textLength;
+
+        // Anything that ran into the end of the buffer (identifiers, numbers, new lines, unterminated strings, a
+        // namespace still waiting for its name, or the EOF token itself) may still continue.
+        if (parser->stream.cursor >= end || (parser->stream.cursor && text[parser->stream.cursor - 1] == ':'))
+            return true;
+        if (error)
+            return false;
 
-        switch (token.type)
-        {
-        case SDLANG_TOKEN_TYPE_VALUE_BOOLEAN:
-            v.type = SDLANG_VALUE_TYPE_BOOLEAN;
-            v.boolValue = token.boolValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_DATE:
-            v.type = SDLANG_VALUE_TYPE_DATE;
-            v.dateValue = token.dateValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_DATETIME:
-            v.type = SDLANG_VALUE_TYPE_DATETIME;
-            v.dateTimeValue = token.dateTimeValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_FLOATING:
-            v.type = SDLANG_VALUE_TYPE_FLOATING;
-            v.floatValue = token.floatValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_INTEGER:
-            v.type = SDLANG_VALUE_TYPE_INTEGER;
-            v.intValue = token.intValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_NULL:
-            v.type = SDLANG_VALUE_TYPE_NULL;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_STRING:
-            v.type = SDLANG_VALUE_TYPE_STRING;
-            v.stringValue = token.stringValue;
-            break;
-        case SDLANG_TOKEN_TYPE_VALUE_TIMESPAN:
-            v.type = SDLANG_VALUE_TYPE_TIMESPAN;
-            v.timeSpanValue = token.timeSpanValue;
-            break;
+        // Numbers stop at the first char they can't use, which could be the start of an unfinished exponent,
+        // suffix or the like, so only trust a token that's followed by a proper separator.
+        size_t i = parser->stream.cursor;
+        while (i < end && !strchr(" \t\r\n;{}\"`", text[i]))
+            i++;
+        if (i >= end)
+            return true;
 
-        default:
-            break;
+        // A date is only a date once we know no time follows it, which may need more than what's been seen.
+        if (parser->front.type == SDLANG_TOKEN_TYPE_VALUE_DATE)
+        {
+            i = _scanSpaces(text + parser->stream.cursor, text + end) - text;
+            SdlangTimeSpan time;
+            if (i >= end)
+                return true;
+            if (_twoDigits(text, &i, end, &time.hours))
+                _clockTime(text, &i, end, &time);
+            return i >= end;
         }
 
-        return v;
+        return false;
     }
 
-    static SdlangTag _nextTag(SdlangParser *parser, SdlangError *error, SdlangCharSlice *errorLine,
-                              SdlangCharSlice *errorSlice)
+    // Tokenizes `text` starting from the tokenizer's cursor, passing completed tokens on. When a token might be
+    // incomplete the tokenizer is rolled back to its start, which is returned in `stoppedAt`.
+    static int _pushRun(SdlangPushParser *push, const char *text, size_t length, size_t offset, bool final,
+                        size_t *stoppedAt, SdlangError *error, SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice)
     {
-        SdlangTag tag = {};
-
-        if (parser->front.type != SDLANG_TOKEN_TYPE_TAG_NAME)
-        {
-            *error = SDLANG_ERROR_EXPECTED_TAG_NAME;
-            *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->front.start);
-            return tag;
-        }
-
-        tag.nspace = parser->front.nspace;
-        tag.name = parser->front.name;
-
-        SdlangValue value;
-        SdlangTag t;
+        SdlangParser *parser = &push->_tokenizer;
+        parser->stream.text = text;
+        parser->stream.textLength = length;
 
         while (true)
         {
+            const SdlangParser saved = *parser;
             sdlangParserNext(parser, error, errorLine, errorSlice);
-            if (*error)
-                return tag;
-
-            switch (parser->front.type)
+            if (!final && _pushTokenIncomplete(parser, *error))
             {
-            case SDLANG_TOKEN_TYPE_NEWLINE:
-            case SDLANG_TOKEN_TYPE_EOF:
-                return tag;
-
-            case SDLANG_TOKEN_TYPE_VALUE_BOOLEAN:
-            case SDLANG_TOKEN_TYPE_VALUE_DATE:
-            case SDLANG_TOKEN_TYPE_VALUE_DATETIME:
-            case SDLANG_TOKEN_TYPE_VALUE_FLOATING:
-            case SDLANG_TOKEN_TYPE_VALUE_INTEGER:
-            case SDLANG_TOKEN_TYPE_VALUE_NULL:
-            case SDLANG_TOKEN_TYPE_VALUE_STRING:
-            case SDLANG_TOKEN_TYPE_VALUE_TIMESPAN:
-                value = _nextValue(parser->front, error);
-                if (*error)
-                    return tag;
-
-                if (parser->front.isAttrib)
-                {
-                    SdlangAttribute attrib;
-                    attrib.nspace = parser->front.nspace;
-                    attrib.name = parser->front.name;
-                    attrib.value = value;
-                    arrput(tag.attributes, attrib);
-                }
-                else
-                    arrput(tag.values, value);
-                break;
-
-            case SDLANG_TOKEN_TYPE_CHILDREN_START:
-                sdlangParserNext(parser, error, errorLine, errorSlice);
-                if (*error)
-                    return tag;
-
-                t = _nextTag(parser, error, errorLine, errorSlice);
-                if (*error)
-                    return tag;
-
-                arrput(tag.children, t);
-                sdlangParserNext(parser, error, errorLine, errorSlice);
-                if (*error)
-                    return tag;
-                if (parser->front.type != SDLANG_TOKEN_TYPE_CHILDREN_END)
-                {
-                    *error = SDLANG_ERROR_EXPECTED_END_BRACE;
-                    *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->front.start);
-                    return tag;
-                }
-                break;
-
-            default:
-                *error = SDLANG_ERROR_UNEXPECTED_CHARACTER;
-                *errorLine = sdlangCharStreamGetLine(&parser->stream, parser->front.start);
-                return tag;
+                *parser = saved;
+                *error = SDLANG_ERROR_NONE;
+                *stoppedAt = saved.stream.cursor;
+                return _PUSH_INCOMPLETE;
             }
-        }
-
-        return tag;
-    }
+            if (*error)
+                return _PUSH_ERROR;
 
-    bool sdlangParseCharStream(SdlangCharStream stream, SdlangTag *rootTag, SdlangError *error,
-                               SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice)
-    {
-        SdlangParser parser = {stream};
+            SdlangToken token = parser->front;
+            token.start += offset;
+            token.end += offset;
+            if ((*error = push->_onToken(&token, push->_userData)))
+                return _PUSH_ERROR;
 
-        while (parser.front.type != SDLANG_TOKEN_TYPE_EOF)
-        {
-            sdlangParserNext(&parser, error, errorLine, errorSlice);
-            if (*error)
-                return false;
-            if (parser.front.type != SDLANG_TOKEN_TYPE_EOF)
+            if (token.type == SDLANG_TOKEN_TYPE_EOF)
             {
-                SdlangTag tag = _nextTag(&parser, error, errorLine, errorSlice);
-                if (*error)
-                    return false;
-                arrput(rootTag->children, tag);
+                *stoppedAt = length;
+                return _PUSH_DONE;
             }
         }
-
-        return true;
     }
-#endif
-
-    SdlangAttribute *sdlangTagGetAttribute(SdlangTag tag, const char *name);
-    bool sdlangCharStreamFromValue(SdlangValue value, SdlangCharStream *stream);
-    bool sdlangCharStreamEscapeNext(SdlangCharStream *stream, SdlangCharSlice *slice);
-    SdlangCharSlice sdlangCharStreamEscapeFull(SdlangCharStream stream);
 
-#ifdef SDLANG_IMPLEMENTATION
-    SdlangCharSlice sdlangCharStreamEscapeFull(SdlangCharStream stream)
+    void sdlangPushParserInit(SdlangPushParser *parser, SdlangPushTokenFunc onToken, void *userData,
+                              const SdlangAllocator *allocator)
     {
-        char *buffer = (char *)calloc(stream.textLength + 1, 1);
-        size_t written = 0;
+        memset(parser, 0, sizeof(*parser));
+        parser->_onToken = onToken;
+        parser->_userData = userData;
+        parser->_allocator = *_allocatorOrDefault(allocator);
+    }
 
-        SdlangCharSlice next;
-        while (sdlangCharStreamEscapeNext(&stream, &next))
+    // Appends to the carry-over buffer, failing the parser if there's no memory for it.
+    static bool _pushCarry(SdlangPushParser *parser, const char *text, size_t length, SdlangError *error)
+    {
+        void *ptr = length ? _bufferPush(&parser->_carry, &parser->_allocator, length) : NULL;
+        if (length && !ptr)
         {
-            const size_t end = written + next.length;
-            if (end > stream.textLength) // Shouldn't ever really happen, buuuuut
-                // better safe than sorry.
-                break;
-            memcpy(buffer + written, next.ptr, next.length);
-            written = end;
+            *error = parser->_error = SDLANG_ERROR_OUT_OF_MEMORY;
+            return false;
         }
-
-        SdlangCharSlice slice = {buffer, written};
-        return slice;
+        if (length)
+            memcpy(ptr, text, length);
+        return true;
     }
 
-    bool sdlangCharStreamEscapeNext(SdlangCharStream *stream, SdlangCharSlice *slice)
+    bool sdlangPushParserFeed(SdlangPushParser *parser, const char *chunk, size_t length, SdlangError *error,
+                              SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice)
     {
-        if (sdlangCharStreamEof(stream))
+        *error = parser->_error;
+        if (*error)
             return false;
 
-        if (sdlangCharStreamPeek(stream) == '\\')
+        const size_t chunkOffset = parser->_offset;
+        parser->_offset += length;
+
+        // First finish off the token that straddles the previous chunk. Only as much of the new chunk as it takes to
+        // complete it is copied, growing geometrically so long tokens don't get rescanned too often.
+        size_t copied = 0, resumeAt = 0, stoppedAt;
+        _SdlangBuffer *carry = &parser->_carry;
+        while (carry->length)
         {
-            stream->cursor++;
-            if (sdlangCharStreamEof(stream))
+            const size_t carried = carry->length - copied;
+            if (copied == length)
+                return true; // Still incomplete, wait for more.
+
+            size_t take = carry->length < 64 ? 64 : carry->length;
+            if (take > length - copied)
+                take = length - copied;
+            if (!_pushCarry(parser, chunk + copied, take, error))
                 return false;
+            copied += take;
 
-            static const SdlangCharSlice _t = {"\t", 1};
-            static const SdlangCharSlice _n = {"\n", 1};
-
-            switch (sdlangCharStreamEat(stream))
+            parser->_tokenizer.stream.cursor = 0;
+            const int status = _pushRun(parser, carry->data, carry->length, parser->_carryOffset, false, &stoppedAt,
+                                        error, errorLine, errorSlice);
+            if (status == _PUSH_ERROR)
             {
-            case 't':
-                *slice = _t;
-                return true;
-            case 'n':
-                *slice = _n;
-                return true;
+                parser->_error = *error;
+                return false;
+            }
 
-            default:
+            if (stoppedAt >= carried)
+            {
+                // Everything left starts inside the new chunk, so carry on from there without copying.
+                resumeAt = stoppedAt - carried;
+                carry->length = 0;
                 break;
             }
-        }
-
-        const size_t start = stream->cursor;
-        while (!sdlangCharStreamEof(stream) && sdlangCharStreamPeek(stream) != '\\')
-            stream->cursor++;
 
-        slice->ptr = stream->text + start;
-        slice->length = stream->cursor - start;
-        return true;
-    }
+            // Drop what's been dealt with so the next attempt doesn't see those tokens again.
+            memmove(carry->data, carry->data + stoppedAt, carry->length - stoppedAt);
+            carry->length -= stoppedAt;
+            parser->_carryOffset += stoppedAt;
+        }
 
-    bool sdlangCharStreamFromValue(SdlangValue value, SdlangCharStream *stream)
-    {
-        if (value.type != SDLANG_VALUE_TYPE_STRING)
+        parser->_tokenizer.stream.cursor = resumeAt;
+        const int status =
+            _pushRun(parser, chunk, length, chunkOffset, false, &stoppedAt, error, errorLine, errorSlice);
+        if (status == _PUSH_ERROR)
+        {
+            parser->_error = *error;
             return false;
+        }
 
-        stream->text = value.stringValue.ptr;
-        stream->textLength = value.stringValue.length;
-        stream->cursor = 0;
+        if (!_pushCarry(parser, chunk + stoppedAt, length - stoppedAt, error))
+            return false;
+        parser->_carryOffset = chunkOffset + stoppedAt;
         return true;
     }
 
-    SdlangAttribute *sdlangTagGetAttribute(SdlangTag tag, const char *name)
+    bool sdlangPushParserFinish(SdlangPushParser *parser, SdlangError *error, SdlangCharSlice *errorLine,
+                                SdlangCharSlice *errorSlice)
     {
-        if (!tag.attributes)
-            return NULL;
-
-        size_t i;
-        for (i = 0; i < arrlen(tag.attributes); i++)
+        *error = parser->_error;
+        if (!*error)
         {
-            if (strncmp(name, tag.attributes[i].name.ptr, tag.attributes[i].name.length) == 0)
-                return &tag.attributes[i];
+            size_t stoppedAt;
+            parser->_tokenizer.stream.cursor = 0;
+            if (_pushRun(parser, parser->_carry.data, parser->_carry.length, parser->_carryOffset, true, &stoppedAt,
+                         error, errorLine, errorSlice) == _PUSH_ERROR)
+                parser->_error = *error;
         }
+        return !*error;
+    }
 
-        return NULL;
+    void sdlangPushParserFree(SdlangPushParser *parser)
+    {
+        _bufferFree(&parser->_carry, &parser->_allocator);
     }
 #endif
 
-    typedef struct _SdlangStringEmit
+    typedef enum SdlangValueType
     {
-        char **ptr;
-        size_t length;
-        size_t capacity;
-    } _SdlangStringEmit;
+        SDLANG_VALUE_TYPE_STRING,
+        SDLANG_VALUE_TYPE_INTEGER,
+        SDLANG_VALUE_TYPE_FLOATING,
+        SDLANG_VALUE_TYPE_BOOLEAN,
+        SDLANG_VALUE_TYPE_DATETIME,
+        SDLANG_VALUE_TYPE_DATE,
+        SDLANG_VALUE_TYPE_TIMESPAN,
+        SDLANG_VALUE_TYPE_NULL,
 
-    typedef const char *(*SdlangEmitterFunc)(const SdlangCharSlice slice, void *userData);
+        // Added onto the type of a value that was deferred, see SdlangParseOptions::deferValues. Only `deferredText`,
+        // the value's text in the document, is set: read it with sdlangValueAs* or decode it with sdlangValueDecode.
+        SDLANG_VALUE_TYPE_DEFERRED = 0x100,
+    } SdlangValueType;
 
-    const char *sdlangEmit(SdlangTag tag, SdlangEmitterFunc emitter, void *userData, bool isRoot = true,
-                           int level = -1);
-    const char *sdlangEmitToString(SdlangTag tag, char **output);
+    typedef struct SdlangValue
+    {
+        SdlangValueType type;
 
-#ifdef SDLANG_IMPLEMENTATION
+        // Set for strings whose `stringValue` still contains escapes or line continuations, as it's written in the
+        // document. See sdlangUnescape and SdlangParseOptions::unescapeStrings.
+        bool requiresEscape;
+        union {
+            SdlangCharSlice stringValue;
+            int64_t intValue;
+            long double floatValue;
+            bool boolValue;
+            SdlangTimeSpan timeSpanValue;
+            SdlangDate dateValue;
+            SdlangDateTime dateTimeValue;
+            SdlangCharSlice deferredText;
+        };
+    } SdlValue;
 
-#ifdef SDLANG_EMIT_NO_BRANCH
-#define _SDLANG_EMIT_RETURN(...) error = emitter(__VA_ARGS__, userData)
-#else
-#define _SDLANG_EMIT_RETURN(...)                                                                                       \
-    if ((error = emitter(__VA_ARGS__, userData)))                                                                      \
-    return error
-#endif
+    // Decodes a deferred value in place, so it can be read like any other from then on. Values that aren't deferred
+    // are left alone. Not thread safe, since it changes the value.
+    void sdlangValueDecode(SdlangValue *value);
+
+    // Read a value of the given type, decoding it first if it was deferred (without caching the result, see
+    // sdlangValueDecode for that). Return false if the value is of another type, deferred or not.
+    bool sdlangValueAsInt(const SdlangValue *value, int64_t *out);
+    bool sdlangValueAsFloat(const SdlangValue *value, long double *out);
+    bool sdlangValueAsDate(const SdlangValue *value, SdlangDate *out);
+    bool sdlangValueAsDateTime(const SdlangValue *value, SdlangDateTime *out);
+    bool sdlangValueAsTimeSpan(const SdlangValue *value, SdlangTimeSpan *out);
 
-    static const char *_emitString(const SdlangCharSlice slice, void *userData)
+#ifdef SDLANG_IMPLEMENTATION
+    // Runs a deferred value's text back through the tokenizer's number parsing, which already checked it.
+    static SdlangValue _decoded(const SdlangValue *value)
     {
-        _SdlangStringEmit *info = (_SdlangStringEmit *)userData;
-        if (!info->capacity)
-        {
-            *info->ptr = (char *)malloc(128);
-            info->capacity = 128;
-        }
-        while (info->length + slice.length >= info->capacity)
-        {
-            *info->ptr = (char *)realloc(*info->ptr, info->capacity * 2);
-            info->capacity *= 2;
-        }
-        if (!*info->ptr)
-            return "Failed to allocate memory.";
+        if (!(value->type & SDLANG_VALUE_TYPE_DEFERRED))
+            return *value;
 
-        memcpy(*info->ptr + info->length, slice.ptr, slice.length);
-        info->length += slice.length;
-        (*info->ptr)[info->length] = '\0';
-        return NULL;
+        SdlangParser parser = {};
+        parser.stream.text = value->deferredText.ptr;
+        parser.stream.textLength = value->deferredText.length;
+        SdlangValue decoded = {};
+        SdlangTokenType type;
+        SdlangError error = SDLANG_ERROR_NONE;
+        _someNumeric(&parser, &decoded.intValue, &decoded.floatValue, &decoded.timeSpanValue, &decoded.dateValue,
+                     &decoded.dateTimeValue, &type, &error);
+        assert(!error);
+        decoded.type = (SdlangValueType)(value->type & ~SDLANG_VALUE_TYPE_DEFERRED);
+        return decoded;
     }
 
-    const char *sdlangEmitToString(SdlangTag tag, char **output)
+    void sdlangValueDecode(SdlangValue *value)
     {
-        _SdlangStringEmit emit = {output, 0, 0};
-        return sdlangEmit(tag, _emitString, &emit);
+        *value = _decoded(value);
     }
 
-    static const char *_emitValue(SdlangValue v, SdlangEmitterFunc emitter, void *userData)
+    bool sdlangValueAsInt(const SdlangValue *value, int64_t *out)
     {
-        const char *error = NULL;
-        char buffer[50];
-        SdlangCharSlice slice;
+        if ((value->type & ~SDLANG_VALUE_TYPE_DEFERRED) != SDLANG_VALUE_TYPE_INTEGER)
+            return false;
+        *out = _decoded(value).intValue;
+        return true;
+    }
+
+    bool sdlangValueAsFloat(const SdlangValue *value, long double *out)
+    {
+        if ((value->type & ~SDLANG_VALUE_TYPE_DEFERRED) != SDLANG_VALUE_TYPE_FLOATING)
+            return false;
+        *out = _decoded(value).floatValue;
+        return true;
+    }
+
+    bool sdlangValueAsDate(const SdlangValue *value, SdlangDate *out)
+    {
+        if ((value->type & ~SDLANG_VALUE_TYPE_DEFERRED) != SDLANG_VALUE_TYPE_DATE)
+            return false;
+        *out = _decoded(value).dateValue;
+        return true;
+    }
+
+    bool sdlangValueAsDateTime(const SdlangValue *value, SdlangDateTime *out)
+    {
+        if ((value->type & ~SDLANG_VALUE_TYPE_DEFERRED) != SDLANG_VALUE_TYPE_DATETIME)
+            return false;
+        *out = _decoded(value).dateTimeValue;
+        return true;
+    }
+
+    bool sdlangValueAsTimeSpan(const SdlangValue *value, SdlangTimeSpan *out)
+    {
+        if ((value->type & ~SDLANG_VALUE_TYPE_DEFERRED) != SDLANG_VALUE_TYPE_TIMESPAN)
+            return false;
+        *out = _decoded(value).timeSpanValue;
+        return true;
+    }
+#endif
+
+    // How long the text of a string (like an SdlangValue's `stringValue`) is once its escape sequences are resolved:
+    // `\"`, `\\`, `\n`, `\r`, `\t`, and line continuations, which also skip the indentation of the next line.
+    size_t sdlangUnescapedLength(SdlangCharSlice str);
+
+    // Writes the text of `str` with its escape sequences resolved into `out`, which must have room for
+    // sdlangUnescapedLength(str) chars, returning how many were written. No null terminator is added.
+    size_t sdlangUnescape(SdlangCharSlice str, char *out);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // Resolves the escapes in `str` into `out`, or just counts how long the result is if `out` is NULL.
+    static size_t _unescape(SdlangCharSlice str, char *out)
+    {
+        const char *p = str.ptr, *end = str.ptr + str.length;
+        size_t written = 0;
+        while (p < end)
+        {
+            const char *slash = _findAny3(p, end, '\\', '\\', '\\');
+            if (out)
+                memcpy(out + written, p, (size_t)(slash - p));
+            written += (size_t)(slash - p);
+            if (slash + 1 >= end) // A lone backslash at the very end has nothing to escape.
+                break;
+
+            char ch = slash[1];
+            p = slash + 2;
+            switch (ch)
+            {
+            case 'n':
+                ch = '\n';
+                break;
+            case 't':
+                ch = '\t';
+                break;
+            case 'r':
+                ch = '\r';
+                break;
+            case '\r':
+                if (p < end && *p == '\n')
+                    p++;
+                // fallthrough
+            case '\n': // A line continuation, which also swallows the next line's indentation.
+                p = _scanSpaces(p, end);
+                continue;
+            default: // Quotes, backslashes, and anything else unknown stand for themselves.
+                break;
+            }
+            if (out)
+                out[written] = ch;
+            written++;
+        }
+        return written;
+    }
+
+    size_t sdlangUnescapedLength(SdlangCharSlice str)
+    {
+        return _unescape(str, NULL);
+    }
+
+    size_t sdlangUnescape(SdlangCharSlice str, char *out)
+    {
+        return _unescape(str, out);
+    }
+#endif
+
+    // A small integer standing in for a `namespace:name` pair, handed out by an SdlangSymbolTable.
+    typedef uint32_t SdlangSymbol;
+#define SDLANG_SYMBOL_NONE 0 // For names that weren't interned.
+
+    // Maps each distinct `namespace:name` to an SdlangSymbol, so names can be compared (or switched on) as integers.
+    // Symbols are handed out in order starting from 1, so names interned up front in a known order get known symbols.
+    // The table keeps its own copy of every name, so it can be shared between any number of trees and documents, and
+    // outlive them. Zero initialise it, or use sdlangSymbolTableInit for a custom allocator. Not thread safe.
+    typedef struct SdlangSymbolTable
+    {
+        const SdlangAllocator *allocator; // NULL means malloc and friends.
+        _SdlangBuffer _entries;           // _SdlangSymbolEntry for each symbol, at symbol - 1.
+        uint32_t *_slots;                 // A power of two of them, each holding a symbol or SDLANG_SYMBOL_NONE.
+        size_t _slotCount;
+    } SdlangSymbolTable;
+
+    void sdlangSymbolTableInit(SdlangSymbolTable *table, const SdlangAllocator *allocator = NULL);
+
+    // Returns the symbol for `nspace` (empty for none) and `name`, adding it if it's new. Returns SDLANG_SYMBOL_NONE
+    // if out of memory.
+    SdlangSymbol sdlangSymbolIntern(SdlangSymbolTable *table, SdlangCharSlice nspace, SdlangCharSlice name);
+
+    // Returns the symbol for `nspace` and `name` without adding it, or SDLANG_SYMBOL_NONE if it was never interned.
+    SdlangSymbol sdlangSymbolFind(const SdlangSymbolTable *table, SdlangCharSlice nspace, SdlangCharSlice name);
+
+    // Gets the namespace and name `symbol` stands for, which are null terminated. Returns false for unknown symbols.
+    bool sdlangSymbolName(const SdlangSymbolTable *table, SdlangSymbol symbol, SdlangCharSlice *nspace,
+                          SdlangCharSlice *name);
+
+    void sdlangSymbolTableFree(SdlangSymbolTable *table);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // FNV-1a over an attribute's namespace and name, with a separator so "a:bc" and "ab:c" differ.
+    static uint32_t _hashAttribute(SdlangCharSlice nspace, SdlangCharSlice name)
+    {
+        uint32_t hash = 2166136261u;
+        size_t i;
+        for (i = 0; i < nspace.length; i++)
+            hash = (hash ^ (unsigned char)nspace.ptr[i]) * 16777619u;
+        hash = (hash ^ ':') * 16777619u;
+        for (i = 0; i < name.length; i++)
+            hash = (hash ^ (unsigned char)name.ptr[i]) * 16777619u;
+        return hash;
+    }
+
+    static bool _sliceEqual(SdlangCharSlice a, SdlangCharSlice b)
+    {
+        return a.length == b.length && (!a.length || memcmp(a.ptr, b.ptr, a.length) == 0);
+    }
+
+    typedef struct _SdlangSymbolEntry
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        uint32_t hash;
+    } _SdlangSymbolEntry;
+
+    void sdlangSymbolTableInit(SdlangSymbolTable *table, const SdlangAllocator *allocator)
+    {
+        *table = {};
+        table->allocator = allocator;
+    }
+
+    // Returns the slot `nspace:name` is in, or the empty one it would go in.
+    static uint32_t *_symbolSlot(const SdlangSymbolTable *table, SdlangCharSlice nspace, SdlangCharSlice name,
+                                 uint32_t hash)
+    {
+        const _SdlangSymbolEntry *entries = _SDLANG_SCRATCH(table->_entries, _SdlangSymbolEntry);
+        size_t slot = hash & (table->_slotCount - 1);
+        for (;; slot = (slot + 1) & (table->_slotCount - 1))
+        {
+            const uint32_t symbol = table->_slots[slot];
+            if (!symbol)
+                return &table->_slots[slot];
+
+            const _SdlangSymbolEntry *entry = &entries[symbol - 1];
+            if (entry->hash == hash && _sliceEqual(entry->name, name) && _sliceEqual(entry->nspace, nspace))
+                return &table->_slots[slot];
+        }
+    }
+
+    // Doubles the number of slots, rehashing every symbol into them.
+    static bool _growSymbolSlots(SdlangSymbolTable *table, const SdlangAllocator *allocator)
+    {
+        const size_t count = table->_slotCount ? table->_slotCount * 2 : 64;
+        uint32_t *slots = (uint32_t *)allocator->alloc(allocator->context, count * sizeof(uint32_t));
+        if (!slots)
+            return false;
+        memset(slots, 0, count * sizeof(uint32_t));
+
+        const _SdlangSymbolEntry *entries = _SDLANG_SCRATCH(table->_entries, _SdlangSymbolEntry);
+        const size_t symbols = _SDLANG_SCRATCH_COUNT(table->_entries, _SdlangSymbolEntry);
+        size_t i;
+        for (i = 0; i < symbols; i++)
+        {
+            size_t slot = entries[i].hash & (count - 1);
+            while (slots[slot])
+                slot = (slot + 1) & (count - 1);
+            slots[slot] = (uint32_t)(i + 1);
+        }
+
+        if (table->_slots)
+            allocator->free(allocator->context, table->_slots);
+        table->_slots = slots;
+        table->_slotCount = count;
+        return true;
+    }
+
+    SdlangSymbol sdlangSymbolIntern(SdlangSymbolTable *table, SdlangCharSlice nspace, SdlangCharSlice name)
+    {
+        const SdlangAllocator *allocator = _allocatorOrDefault(table->allocator);
+        const uint32_t hash = _hashAttribute(nspace, name);
+        if (table->_slotCount)
+        {
+            const uint32_t *slot = _symbolSlot(table, nspace, name, hash);
+            if (*slot)
+                return *slot;
+        }
+
+        // Keep the slots at most half full, so probe runs stay short.
+        const size_t symbols = _SDLANG_SCRATCH_COUNT(table->_entries, _SdlangSymbolEntry);
+        if ((symbols + 1) * 2 > table->_slotCount && !_growSymbolSlots(table, allocator))
+            return SDLANG_SYMBOL_NONE;
+
+        char *text = (char *)allocator->alloc(allocator->context, nspace.length + name.length + 2);
+        if (!text)
+            return SDLANG_SYMBOL_NONE;
+        _SdlangSymbolEntry *entry =
+            (_SdlangSymbolEntry *)_bufferPush(&table->_entries, allocator, sizeof(_SdlangSymbolEntry));
+        if (!entry)
+        {
+            allocator->free(allocator->context, text);
+            return SDLANG_SYMBOL_NONE;
+        }
+
+        if (nspace.length)
+            memcpy(text, nspace.ptr, nspace.length);
+        text[nspace.length] = '\0';
+        if (name.length)
+            memcpy(text + nspace.length + 1, name.ptr, name.length);
+        text[nspace.length + 1 + name.length] = '\0';
+        entry->nspace.ptr = text;
+        entry->nspace.length = nspace.length;
+        entry->name.ptr = text + nspace.length + 1;
+        entry->name.length = name.length;
+        entry->hash = hash;
+
+        const SdlangSymbol symbol = (SdlangSymbol)(symbols + 1);
+        *_symbolSlot(table, nspace, name, hash) = symbol;
+        return symbol;
+    }
+
+    SdlangSymbol sdlangSymbolFind(const SdlangSymbolTable *table, SdlangCharSlice nspace, SdlangCharSlice name)
+    {
+        if (!table->_slotCount)
+            return SDLANG_SYMBOL_NONE;
+        return *_symbolSlot(table, nspace, name, _hashAttribute(nspace, name));
+    }
+
+    bool sdlangSymbolName(const SdlangSymbolTable *table, SdlangSymbol symbol, SdlangCharSlice *nspace,
+                          SdlangCharSlice *name)
+    {
+        if (symbol == SDLANG_SYMBOL_NONE || symbol > _SDLANG_SCRATCH_COUNT(table->_entries, _SdlangSymbolEntry))
+            return false;
+
+        const _SdlangSymbolEntry *entry = &_SDLANG_SCRATCH(table->_entries, _SdlangSymbolEntry)[symbol - 1];
+        *nspace = entry->nspace;
+        *name = entry->name;
+        return true;
+    }
+
+    void sdlangSymbolTableFree(SdlangSymbolTable *table)
+    {
+        const SdlangAllocator *allocator = _allocatorOrDefault(table->allocator);
+        const _SdlangSymbolEntry *entries = _SDLANG_SCRATCH(table->_entries, _SdlangSymbolEntry);
+        size_t i;
+        for (i = 0; i < _SDLANG_SCRATCH_COUNT(table->_entries, _SdlangSymbolEntry); i++)
+            allocator->free(allocator->context, (void *)entries[i].nspace.ptr);
+        _bufferFree(&table->_entries, allocator);
+        if (table->_slots)
+            allocator->free(allocator->context, table->_slots);
+        sdlangSymbolTableInit(table, table->allocator);
+    }
+#endif
+
+    typedef struct SdlangAttribute
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        SdlangValue value;
+        SdlangSymbol symbol; // Set when parsing with a symbol table, see SdlangParseOptions::symbols.
+    } SdlangAttribute;
+
+    typedef struct SdlangTag
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        SdlangAttribute *attributes;
+        SdlangValue *values;
+        SdlangTag *children;
+
+        // The text of a children block that was skipped by a lazy parse, until sdlangTagChildren parses it.
+        SdlangCharSlice _unparsedChildren;
+
+        // A hash table over `attributes`, see sdlangTagIndexAttributes. Its first item is how many attributes there
+        // were when it was built, followed by a power of two slots each holding an attribute's index + 1, or 0.
+        uint32_t *_attributeIndex;
+
+        // Set when parsing with a symbol table, see SdlangParseOptions::symbols. Kept after the original fields, so
+        // tags can still be initialised positionally.
+        SdlangSymbol symbol;
+    } SdlangTag;
+
+#ifndef SDLANG_ATTRIBUTE_INDEX_MIN_COUNT
+#define SDLANG_ATTRIBUTE_INDEX_MIN_COUNT 8
+#endif
+
+#ifndef SDLANG_DEFAULT_MAX_DEPTH
+#define SDLANG_DEFAULT_MAX_DEPTH 1024
+#endif
+
+    typedef struct SdlangParseOptions
+    {
+        size_t maxDepth; // How many levels of children may be nested. 0 means SDLANG_DEFAULT_MAX_DEPTH.
+
+        // Where the tree (or a document's arena) and any scratch space comes from. NULL means malloc and friends.
+        // Arrays made with a custom allocator are exactly sized and must not be grown with arrput and the like.
+        const SdlangAllocator *allocator;
+
+        // A structural index of the text being parsed, from sdlangStructuralIndexBuild. When given, the parser looks
+        // up where strings end in the index rather than scanning for it.
+        const SdlangStructuralIndex *index;
+
+        // Leave numbers, dates, date times, and time spans as their text, only decoding them when they're read
+        // through sdlangValueAs* or sdlangValueDecode (see SDLANG_VALUE_TYPE_DEFERRED). They're still checked while
+        // parsing, so a value that would have failed to parse still does.
+        bool deferValues;
+
+        // Build an attribute index (see sdlangTagIndexAttributes) for every tag with at least
+        // SDLANG_ATTRIBUTE_INDEX_MIN_COUNT attributes, so sdlangTagFindAttribute doesn't have to scan them.
+        bool indexAttributes;
+
+        // Intern the name of every tag and attribute into this table, setting their `symbol`s. NULL means they're
+        // left as SDLANG_SYMBOL_NONE. The table must outlive any lazy document parsed with it.
+        SdlangSymbolTable *symbols;
+
+        // Only for documents: skip over every block of children without parsing it, leaving it to sdlangTagChildren
+        // to parse the first time it's asked for. Errors inside of a block aren't found until then.
+        bool lazy;
+
+        // Only for documents: resolve the escapes of every string that has any, see sdlangDocumentUnescapeStrings.
+        bool unescapeStrings;
+    } SdlangParseOptions;
+
+    bool sdlangParseCharStream(SdlangCharStream stream, SdlangTag *rootTag, SdlangError *error,
+                               SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                               const SdlangParseOptions *options = NULL);
+
+    // Frees a tree made by sdlangParseCharStream. `allocator` must be the one it was parsed with, if any.
+    void sdlangTagFree(SdlangTag tag, const SdlangAllocator *allocator = NULL);
+
+    // Interns the names of `tag`, its attributes, and all of its descendants into `symbols`, setting their `symbol`s,
+    // the same as parsing with SdlangParseOptions::symbols would. The root's empty name is left alone. Returns false
+    // if out of memory, in which case some names may not have been interned.
+    bool sdlangTagInternNames(SdlangTag *tag, SdlangSymbolTable *symbols);
+
+    // What the parser should do after an event callback returns.
+    typedef enum SdlangEventAction
+    {
+        SDLANG_EVENT_CONTINUE,
+        SDLANG_EVENT_SKIP, // From onTagStart: skip the rest of the tag and all of its children, including onTagEnd.
+                           // From onChildrenStart: skip the children, onChildrenEnd is still called.
+        SDLANG_EVENT_STOP, // Stop parsing and fail with SDLANG_ERROR_STOPPED.
+    } SdlangEventAction;
+
+    // Callbacks for sdlangParseEvents. Any of them can be NULL. Slices point into the text being parsed.
+    //
+    // For every tag the order is: onTagStart, then any onValue/onAttribute, then onChildrenStart, the events of each
+    // child and onChildrenEnd if it has a block, and finally onTagEnd. Anything that follows the block's closing
+    // brace on the same line still belongs to the tag, so more onValue/onAttribute calls can come after
+    // onChildrenEnd.
+    typedef struct SdlangEvents
+    {
+        SdlangEventAction (*onTagStart)(SdlangCharSlice nspace, SdlangCharSlice name, void *userData);
+        SdlangEventAction (*onValue)(SdlangValue value, void *userData);
+        SdlangEventAction (*onAttribute)(SdlangCharSlice nspace, SdlangCharSlice name, SdlangValue value,
+                                         void *userData);
+        SdlangEventAction (*onChildrenStart)(void *userData);
+        SdlangEventAction (*onChildrenEnd)(void *userData);
+        SdlangEventAction (*onTagEnd)(void *userData);
+        void *userData;
+    } SdlangEvents;
+
+    // Parses `stream` calling `events` as it goes, without building a tree or allocating anything.
+    bool sdlangParseEvents(SdlangCharStream stream, const SdlangEvents *events, SdlangError *error,
+                           SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                           const SdlangParseOptions *options = NULL);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // Frees an array made by the tree builder. With a custom allocator it was made by _allocatorArray.
+    static void _freeArray(void *array, const SdlangAllocator *custom)
+    {
+        if (!array)
+            return;
+        if (custom)
+            custom->free(custom->context, stbds_header(array));
+        else
+            arrfree(array);
+    }
+
+    void sdlangTagFree(SdlangTag tag, const SdlangAllocator *allocator)
+    {
+        size_t i;
+
+        if (tag.children)
+        {
+            for (i = 0; i < arrlen(tag.children); i++)
+                sdlangTagFree(tag.children[i], allocator);
+        }
+
+        _freeArray(tag.children, allocator);
+        _freeArray(tag.attributes, allocator);
+        _freeArray(tag.values, allocator);
+        _freeArray(tag._attributeIndex, allocator);
+    }
+
+    bool sdlangTagInternNames(SdlangTag *tag, SdlangSymbolTable *symbols)
+    {
+        size_t i;
+        if (tag->name.length && !(tag->symbol = sdlangSymbolIntern(symbols, tag->nspace, tag->name)))
+            return false;
+
+        for (i = 0; i < arrlen(tag->attributes); i++)
+        {
+            SdlangAttribute *attrib = &tag->attributes[i];
+            if (!(attrib->symbol = sdlangSymbolIntern(symbols, attrib->nspace, attrib->name)))
+                return false;
+        }
+        for (i = 0; i < arrlen(tag->children); i++)
+        {
+            if (!sdlangTagInternNames(&tag->children[i], symbols))
+                return false;
+        }
+        return true;
+    }
+
+    static SdlangValue _nextValue(const SdlangToken *token)
+    {
+        SdlangValue v;
+        v.requiresEscape = false;
+
+        switch (token->type)
+        {
+        case SDLANG_TOKEN_TYPE_VALUE_BOOLEAN:
+            v.type = SDLANG_VALUE_TYPE_BOOLEAN;
+            v.boolValue = token->boolValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_DATE:
+            v.type = SDLANG_VALUE_TYPE_DATE;
+            if (!token->deferred)
+                v.dateValue = token->dateValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_DATETIME:
+            v.type = SDLANG_VALUE_TYPE_DATETIME;
+            if (!token->deferred)
+                v.dateTimeValue = token->dateTimeValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_FLOATING:
+            v.type = SDLANG_VALUE_TYPE_FLOATING;
+            if (!token->deferred)
+                v.floatValue = token->floatValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_INTEGER:
+            v.type = SDLANG_VALUE_TYPE_INTEGER;
+            if (!token->deferred)
+                v.intValue = token->intValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_NULL:
+            v.type = SDLANG_VALUE_TYPE_NULL;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_STRING:
+            v.type = SDLANG_VALUE_TYPE_STRING;
+            v.requiresEscape = token->requiresEscape;
+            v.stringValue = token->stringValue;
+            break;
+        case SDLANG_TOKEN_TYPE_VALUE_TIMESPAN:
+            v.type = SDLANG_VALUE_TYPE_TIMESPAN;
+            if (!token->deferred)
+                v.timeSpanValue = token->timeSpanValue;
+            break;
+
+        default:
+            break;
+        }
+
+        if (token->deferred)
+        {
+            v.type = (SdlangValueType)(v.type | SDLANG_VALUE_TYPE_DEFERRED);
+            v.deferredText = token->deferredText;
+        }
+        return v;
+    }
+
+    static const int _EVENTS_MORE = 0;
+    static const int _EVENTS_DONE = 1;
+    static const int _EVENTS_ERROR = 2;
+    static const size_t _NOT_SKIPPING = (size_t)-1;
+
+    // The structural state shared by everything that turns tokens into events: how deep we are, whether a tag is
+    // open on the current line, and which part of the document (if any) a callback asked us to skip.
+    typedef struct _SdlangEventState
+    {
+        size_t maxDepth;
+        size_t depth;
+        size_t skipDepth; // The depth skipping started at, or _NOT_SKIPPING.
+        bool skipTag;     // Whether the skipped tag itself is being skipped, rather than only its children.
+        bool inTag;
+        bool closed; // The open tag's block of children has already ended.
+    } _SdlangEventState;
+
+    static void _eventStateInit(_SdlangEventState *state, const SdlangParseOptions *options)
+    {
+        state->maxDepth = (options && options->maxDepth) ? options->maxDepth : SDLANG_DEFAULT_MAX_DEPTH;
+        state->depth = 0;
+        state->skipDepth = _NOT_SKIPPING;
+        state->skipTag = false;
+        state->inTag = false;
+        state->closed = false;
+    }
+
+    static bool _eventAction(SdlangEventAction action, SdlangError *error)
+    {
+        if (action == SDLANG_EVENT_STOP)
+        {
+            *error = SDLANG_ERROR_STOPPED;
+            return false;
+        }
+        return true;
+    }
+
+    // Feeds a single token through the event engine. Returns _EVENTS_DONE after the EOF token, and _EVENTS_ERROR
+    // with `error` set if the token doesn't fit or a callback stopped parsing.
+    static int _eventsToken(_SdlangEventState *state, const SdlangEvents *events, const SdlangToken *token,
+                            SdlangError *error)
+    {
+        void *const userData = events->userData;
+        const bool skipping = state->skipDepth != _NOT_SKIPPING;
+        SdlangEventAction action = SDLANG_EVENT_CONTINUE;
+
+        switch (token->type)
+        {
+        case SDLANG_TOKEN_TYPE_TAG_NAME:
+            state->inTag = true;
+            state->closed = false;
+            if (!skipping && events->onTagStart)
+            {
+                action = events->onTagStart(token->nspace, token->name, userData);
+                if (action == SDLANG_EVENT_SKIP)
+                {
+                    state->skipDepth = state->depth;
+                    state->skipTag = true;
+                }
+            }
+            break;
+
+        case SDLANG_TOKEN_TYPE_NEWLINE:
+        case SDLANG_TOKEN_TYPE_EOF:
+            if (state->inTag)
+            {
+                state->inTag = false;
+                if (!skipping && events->onTagEnd)
+                    action = events->onTagEnd(userData);
+                else if (skipping && state->skipTag && state->depth == state->skipDepth)
+                    state->skipDepth = _NOT_SKIPPING;
+            }
+            if (!_eventAction(action, error))
+                return _EVENTS_ERROR;
+
+            if (token->type == SDLANG_TOKEN_TYPE_NEWLINE)
+                return _EVENTS_MORE;
+            if (state->depth)
+            {
+                *error = SDLANG_ERROR_EXPECTED_END_BRACE;
+                return _EVENTS_ERROR;
+            }
+            return _EVENTS_DONE;
+
+        case SDLANG_TOKEN_TYPE_VALUE_BOOLEAN:
+        case SDLANG_TOKEN_TYPE_VALUE_DATE:
+        case SDLANG_TOKEN_TYPE_VALUE_DATETIME:
+        case SDLANG_TOKEN_TYPE_VALUE_FLOATING:
+        case SDLANG_TOKEN_TYPE_VALUE_INTEGER:
+        case SDLANG_TOKEN_TYPE_VALUE_NULL:
+        case SDLANG_TOKEN_TYPE_VALUE_STRING:
+        case SDLANG_TOKEN_TYPE_VALUE_TIMESPAN:
+            assert(state->inTag);
+            if (skipping)
+                break;
+            if (token->isAttrib)
+            {
+                if (events->onAttribute)
+                    action = events->onAttribute(token->nspace, token->name, _nextValue(token), userData);
+            }
+            else if (events->onValue)
+                action = events->onValue(_nextValue(token), userData);
+            break;
+
+        case SDLANG_TOKEN_TYPE_CHILDREN_START:
+            assert(state->inTag);
+            if (state->closed)
+            {
+                *error = SDLANG_ERROR_SECOND_CHILDREN;
+                return _EVENTS_ERROR;
+            }
+            if (state->depth >= state->maxDepth)
+            {
+                *error = SDLANG_ERROR_MAX_DEPTH_EXCEEDED;
+                return _EVENTS_ERROR;
+            }
+            state->depth++;
+            state->inTag = false;
+            if (!skipping && events->onChildrenStart)
+            {
+                action = events->onChildrenStart(userData);
+                if (action == SDLANG_EVENT_SKIP)
+                {
+                    state->skipDepth = state->depth - 1;
+                    state->skipTag = false;
+                }
+            }
+            break;
+
+        case SDLANG_TOKEN_TYPE_CHILDREN_END:
+            if (!state->depth)
+            {
+                *error = SDLANG_ERROR_UNEXPECTED_CHARACTER;
+                return _EVENTS_ERROR;
+            }
+
+            // The parent is still on its own line, so any values or attributes up until the next new line still belong
+            // to it. Another block of children doesn't.
+            state->depth--;
+            state->inTag = true;
+            state->closed = true;
+            if (skipping && !state->skipTag && state->depth == state->skipDepth)
+                state->skipDepth = _NOT_SKIPPING;
+            if (state->skipDepth == _NOT_SKIPPING && events->onChildrenEnd)
+                action = events->onChildrenEnd(userData);
+            break;
+
+        default:
+            *error = SDLANG_ERROR_UNEXPECTED_CHARACTER;
+            return _EVENTS_ERROR;
+        }
+
+        return _eventAction(action, error) ? _EVENTS_MORE : _EVENTS_ERROR;
+    }
+
+    // Finds the brace closing the block of children that starts at `at`, just after its opening brace's new line,
+    // using the structural index to step over strings without tokenizing anything. Returns false if the block can't
+    // be skipped without changing what parsing it would find: it isn't closed, nests deeper than `maxDepth`, or its
+    // closing brace doesn't start a line (or follow a `;`). Parsing it normally then reports the error.
+    static bool _skipBlock(const char *text, size_t at, size_t length, size_t maxDepth, size_t *close)
+    {
+        if (length > UINT32_MAX)
+            return false;
+
+        // Most blocks are small, so index a small chunk at a time rather than far past the end of the block.
+        const size_t chunk = 256;
+        uint32_t entries[chunk];
+        size_t depth = 0;
+        _SdlangIndexState state = {};
+        state.bracesOnly = true;
+        while (at < length)
+        {
+            const size_t chunkEnd = length - at < chunk ? length : at + chunk;
+            const uint32_t *end = _indexRange(text, at, chunkEnd, &state, entries);
+            const uint32_t *entry;
+            for (entry = entries; entry < end; entry++)
+            {
+                if (text[*entry] == '{' && ++depth > maxDepth)
+                    return false;
+                if (text[*entry] == '}' && depth-- == 0)
+                {
+                    // Only spaces may come between the brace and an unescaped new line, or a `;`, which ends a tag
+                    // just the same (including the one in `{;`).
+                    size_t start = *entry;
+                    while (start > 0 && (text[start - 1] == ' ' || text[start - 1] == '\t'))
+                        start--;
+                    if (start == 0 || (text[start - 1] != '\n' && text[start - 1] != '\r' && text[start - 1] != ';'))
+                        return false;
+                    start -= (text[start - 1] == '\n' && start > 1 && text[start - 2] == '\r') ? 2 : 1;
+                    if (start > 0 && text[start - 1] == '\\')
+                        return false;
+
+                    *close = *entry;
+                    return true;
+                }
+            }
+            at = chunkEnd;
+        }
+        return false;
+    }
+
+    // Called with the text of each block of children that a lazy parse skips.
+    typedef void (*_SdlangLazyFunc)(SdlangCharSlice block, void *userData);
+
+    // sdlangParseEvents, which can also skip blocks of children for lazy parsing when `onLazyChildren` is given.
+    static bool _parseEvents(SdlangCharStream stream, const SdlangEvents *events, _SdlangLazyFunc onLazyChildren,
+                             SdlangError *error, SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                             const SdlangParseOptions *options)
+    {
+        SdlangParser parser = {stream};
+        parser._deferValues = options && options->deferValues;
+        if (options && options->index)
+        {
+            parser._structural = options->index->offsets;
+            parser._structuralEnd = options->index->offsets + options->index->count;
+        }
+        _SdlangEventState state;
+        _eventStateInit(&state, options);
+
+        while (true)
+        {
+            sdlangParserNext(&parser, error, errorLine, errorSlice);
+            if (*error)
+                return false;
+
+            const int status = _eventsToken(&state, events, &parser.front, error);
+            if (status == _EVENTS_DONE)
+                return true;
+            if (status == _EVENTS_ERROR)
+            {
+                *errorLine = sdlangCharStreamGetLine(&parser.stream, parser.front.start);
+                return false;
+            }
+
+            // The closing brace is left for the parser, so the block ends the same way it would have otherwise.
+            size_t close;
+            if (onLazyChildren && parser.front.type == SDLANG_TOKEN_TYPE_CHILDREN_START &&
+                state.skipDepth == _NOT_SKIPPING &&
+                _skipBlock(stream.text, parser.stream.cursor, stream.textLength, state.maxDepth - state.depth, &close))
+            {
+                SdlangCharSlice block = {stream.text + parser.stream.cursor, close - parser.stream.cursor};
+                onLazyChildren(block, events->userData);
+                parser.stream.cursor = close;
+            }
+        }
+    }
+
+    bool sdlangParseEvents(SdlangCharStream stream, const SdlangEvents *events, SdlangError *error,
+                           SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice, const SdlangParseOptions *options)
+    {
+        return _parseEvents(stream, events, NULL, error, errorLine, errorSlice, options);
+    }
+
+    // The tree builder is just another consumer of events.
+    //
+    // The values, attributes and children of every tag that's still open are collected on shared scratch stacks, and
+    // only once a tag ends are its items copied out into arrays of exactly the right size by `makeArray`. This keeps
+    // the tree to one allocation per array, and lets the same builder target the heap, a custom allocator, or a
+    // document's arena. Open tags also live on a scratch stack instead of the call stack, so nesting is only limited
+    // by `maxDepth`.
+    typedef void *(*_SdlangArrayFunc)(void *context, const void *items, size_t count, size_t itemSize);
+
+    typedef struct _SdlangTagFrame
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        SdlangSymbol symbol;
+        size_t values; // How many items were on each of the scratch stacks when this tag started.
+        size_t attributes;
+        size_t children;
+        SdlangCharSlice unparsedChildren;
+    } _SdlangTagFrame;
+
+    typedef struct _SdlangTreeBuilder
+    {
+        _SdlangBuffer frames; // The root, followed by every tag that's still open.
+        _SdlangBuffer values;
+        _SdlangBuffer attributes;
+        _SdlangBuffer children;
+        const SdlangAllocator *allocator; // For the scratch stacks.
+        _SdlangArrayFunc makeArray;
+        void *context;
+        bool ownsTags;                       // Whether tags that can't be used after all have to be freed.
+        const SdlangAllocator *tagAllocator; // Which allocator to free them with, if any.
+        bool indexAttributes;                // Whether to index the attributes of tags that have enough of them.
+        SdlangSymbolTable *symbols;          // Where names are interned, if anywhere.
+        SdlangError error; // Set when a callback stops parsing.
+    } _SdlangTreeBuilder;
+
+    // Makes a normal stb_ds array. `items` can be NULL to leave it uninitialised.
+    static void *_heapArray(void *context, const void *items, size_t count, size_t itemSize)
+    {
+        (void)context;
+        if (!count)
+            return NULL;
+
+        void *array = stbds_arrgrowf(NULL, itemSize, count, 0);
+        stbds_header(array)->length = count;
+        if (items)
+            memcpy(array, items, count * itemSize);
+        return array;
+    }
+
+    // Makes an array from an SdlangAllocator, complete with an stb_ds header so arrlen and friends work.
+    // `items` can be NULL to leave it uninitialised.
+    static void *_allocatorArray(void *context, const void *items, size_t count, size_t itemSize)
+    {
+        if (!count)
+            return NULL;
+
+        const SdlangAllocator *allocator = (const SdlangAllocator *)context;
+        stbds_array_header *header = (stbds_array_header *)allocator->alloc(
+            allocator->context, sizeof(stbds_array_header) + count * itemSize);
+        if (!header)
+            return NULL;
+        header->length = count;
+        header->capacity = count;
+        header->hash_table = NULL;
+        header->temp = 0;
+        if (items)
+            memcpy(header + 1, items, count * itemSize);
+        return header + 1;
+    }
+
+    // Builds `tag`'s attribute index out of an array from `makeArray`, replacing (but not freeing) any it had.
+    static bool _buildAttributeIndex(SdlangTag *tag, _SdlangArrayFunc makeArray, void *context)
+    {
+        const size_t count = arrlen(tag->attributes);
+        size_t slots = 8;
+        while (slots < count * 2) // Keeps the table at most half full, so probe runs stay short.
+            slots *= 2;
+
+        uint32_t *index = (uint32_t *)makeArray(context, NULL, slots + 1, sizeof(uint32_t));
+        if (!index)
+            return false;
+        memset(index, 0, (slots + 1) * sizeof(uint32_t));
+        index[0] = (uint32_t)count;
+
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            const SdlangAttribute *attrib = &tag->attributes[i];
+            size_t slot = _hashAttribute(attrib->nspace, attrib->name) & (slots - 1);
+            for (;; slot = (slot + 1) & (slots - 1))
+            {
+                const uint32_t at = index[slot + 1];
+                if (!at)
+                {
+                    index[slot + 1] = (uint32_t)(i + 1);
+                    break;
+                }
+
+                // Only the first of any duplicates is indexed, which is the one a scan would have found.
+                const SdlangAttribute *other = &tag->attributes[at - 1];
+                if (_sliceEqual(other->name, attrib->name) && _sliceEqual(other->nspace, attrib->nspace))
+                    break;
+            }
+        }
+
+        tag->_attributeIndex = index;
+        return true;
+    }
+
+    static SdlangEventAction _treeOutOfMemory(_SdlangTreeBuilder *builder)
+    {
+        builder->error = SDLANG_ERROR_OUT_OF_MEMORY;
+        return SDLANG_EVENT_STOP;
+    }
+
+    static SdlangEventAction _treeTagStart(SdlangCharSlice nspace, SdlangCharSlice name, void *userData)
+    {
+        _SdlangTreeBuilder *builder = (_SdlangTreeBuilder *)userData;
+        _SdlangTagFrame *frame =
+            (_SdlangTagFrame *)_bufferPush(&builder->frames, builder->allocator, sizeof(_SdlangTagFrame));
+        if (!frame)
+            return _treeOutOfMemory(builder);
+
+        frame->nspace = nspace;
+        frame->name = name;
+        frame->symbol = SDLANG_SYMBOL_NONE;
+        if (builder->symbols && !(frame->symbol = sdlangSymbolIntern(builder->symbols, nspace, name)))
+            return _treeOutOfMemory(builder);
+        frame->values = _SDLANG_SCRATCH_COUNT(builder->values, SdlangValue);
+        frame->attributes = _SDLANG_SCRATCH_COUNT(builder->attributes, SdlangAttribute);
+        frame->children = _SDLANG_SCRATCH_COUNT(builder->children, SdlangTag);
+        frame->unparsedChildren = {};
+        return SDLANG_EVENT_CONTINUE;
+    }
+
+    static SdlangEventAction _treeValue(SdlangValue value, void *userData)
+    {
+        _SdlangTreeBuilder *builder = (_SdlangTreeBuilder *)userData;
+        SdlangValue *slot = (SdlangValue *)_bufferPush(&builder->values, builder->allocator, sizeof(SdlangValue));
+        if (!slot)
+            return _treeOutOfMemory(builder);
+
+        *slot = value;
+        return SDLANG_EVENT_CONTINUE;
+    }
+
+    static SdlangEventAction _treeAttribute(SdlangCharSlice nspace, SdlangCharSlice name, SdlangValue value,
+                                            void *userData)
+    {
+        _SdlangTreeBuilder *builder = (_SdlangTreeBuilder *)userData;
+        SdlangAttribute *attrib =
+            (SdlangAttribute *)_bufferPush(&builder->attributes, builder->allocator, sizeof(SdlangAttribute));
+        if (!attrib)
+            return _treeOutOfMemory(builder);
+
+        attrib->nspace = nspace;
+        attrib->name = name;
+        attrib->value = value;
+        attrib->symbol = SDLANG_SYMBOL_NONE;
+        if (builder->symbols && !(attrib->symbol = sdlangSymbolIntern(builder->symbols, nspace, name)))
+            return _treeOutOfMemory(builder);
+        return SDLANG_EVENT_CONTINUE;
+    }
+
+    // Frees tags that were finished but never made it into the tree.
+    static void _treeDrop(_SdlangTreeBuilder *builder, const SdlangTag *tags, size_t count)
+    {
+        size_t i;
+        if (builder->ownsTags)
+        {
+            for (i = 0; i < count; i++)
+                sdlangTagFree(tags[i], builder->tagAllocator);
+        }
+    }
+
+    // Moves one of `frame`'s scratch stacks into an array of its own.
+    static bool _treeMove(_SdlangTreeBuilder *builder, _SdlangBuffer *scratch, size_t from, size_t itemSize,
+                          void **array)
+    {
+        const size_t count = scratch->length / itemSize - from;
+        *array = NULL;
+        if (!count) // Most tags lack at least one kind of item, so don't bother calling out for those.
+            return true;
+
+        char *items = scratch->data + from * itemSize;
+        *array = builder->makeArray(builder->context, items, count, itemSize);
+        if (!*array && scratch == &builder->children)
+            _treeDrop(builder, (const SdlangTag *)items, count);
+
+        scratch->length = from * itemSize;
+        return *array != NULL;
+    }
+
+    // Moves everything collected for `frame` off of the scratch stacks and into `tag`.
+    static bool _treeFinish(_SdlangTreeBuilder *builder, const _SdlangTagFrame *frame, SdlangTag *tag)
+    {
+        bool moved = _treeMove(builder, &builder->values, frame->values, sizeof(SdlangValue), (void **)&tag->values);
+        moved &= _treeMove(builder, &builder->attributes, frame->attributes, sizeof(SdlangAttribute),
+                           (void **)&tag->attributes);
+        moved &= _treeMove(builder, &builder->children, frame->children, sizeof(SdlangTag), (void **)&tag->children);
+
+        // The index is only ever a shortcut, so a tag that can't have one just goes without.
+        if (moved && builder->indexAttributes && arrlen(tag->attributes) >= SDLANG_ATTRIBUTE_INDEX_MIN_COUNT)
+            _buildAttributeIndex(tag, builder->makeArray, builder->context);
+        return moved;
+    }
+
+    static SdlangEventAction _treeTagEnd(void *userData)
+    {
+        _SdlangTreeBuilder *builder = (_SdlangTreeBuilder *)userData;
+        builder->frames.length -= sizeof(_SdlangTagFrame);
+        const _SdlangTagFrame frame = *(_SdlangTagFrame *)(builder->frames.data + builder->frames.length);
+
+        // Make sure there's room for the tag before finishing it, since even an incomplete tag has to go somewhere it
+        // can be freed from. Its items are about to leave the scratch stacks, so the room is guaranteed to be there.
+        if (!_bufferPush(&builder->children, builder->allocator, sizeof(SdlangTag)))
+            return _treeOutOfMemory(builder);
+        builder->children.length -= sizeof(SdlangTag);
+
+        SdlangTag tag = {};
+        tag.nspace = frame.nspace;
+        tag.name = frame.name;
+        tag.symbol = frame.symbol;
+        tag._unparsedChildren = frame.unparsedChildren;
+        const bool finished = _treeFinish(builder, &frame, &tag);
+        *(SdlangTag *)_bufferPush(&builder->children, builder->allocator, sizeof(SdlangTag)) = tag;
+        return finished ? SDLANG_EVENT_CONTINUE : _treeOutOfMemory(builder);
+    }
+
+    static void _treeLazyChildren(SdlangCharSlice block, void *userData)
+    {
+        _SdlangTreeBuilder *builder = (_SdlangTreeBuilder *)userData;
+        _SdlangTagFrame *frames = _SDLANG_SCRATCH(builder->frames, _SdlangTagFrame);
+        frames[_SDLANG_SCRATCH_COUNT(builder->frames, _SdlangTagFrame) - 1].unparsedChildren = block;
+    }
+
+    static const SdlangEvents _TREE_EVENTS = {_treeTagStart, _treeValue, _treeAttribute, NULL, NULL, _treeTagEnd};
+
+    // Parses `stream` into a new tree, whose arrays all come from `makeArray`, using `allocator` for scratch space.
+    // When parsing fails the root still holds every top level tag that was fully parsed. If `ownsTags` is set, tags
+    // that don't end up in the tree are freed with `tagAllocator`. If `lazy` is set, blocks of children are skipped.
+    static bool _buildTree(SdlangCharStream stream, const SdlangAllocator *allocator, _SdlangArrayFunc makeArray,
+                           void *context, bool ownsTags, const SdlangAllocator *tagAllocator, bool lazy,
+                           SdlangTag *root, SdlangError *error, SdlangCharSlice *errorLine,
+                           SdlangCharSlice *errorSlice, const SdlangParseOptions *options)
+    {
+        _SdlangTreeBuilder builder = {};
+        builder.allocator = allocator;
+        builder.makeArray = makeArray;
+        builder.context = context;
+        builder.ownsTags = ownsTags;
+        builder.tagAllocator = tagAllocator;
+        builder.indexAttributes = options && options->indexAttributes;
+        builder.symbols = options ? options->symbols : NULL;
+
+        bool parsed = false;
+        *root = {};
+        _SdlangTagFrame *rootFrame =
+            (_SdlangTagFrame *)_bufferPush(&builder.frames, allocator, sizeof(_SdlangTagFrame));
+        if (rootFrame)
+        {
+            *rootFrame = {};
+
+            SdlangEvents events = _TREE_EVENTS;
+            events.userData = &builder;
+            parsed = _parseEvents(stream, &events, lazy ? _treeLazyChildren : NULL, error, errorLine, errorSlice,
+                                  options);
+            if (builder.error)
+            {
+                *error = builder.error;
+                *errorLine = {};
+                *errorSlice = {};
+            }
+        }
+        else
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+
+        if (!parsed && rootFrame)
+        {
+            // The finished top level tags are the ones below the first tag that's still open, and anything above them
+            // was finished inside of a tag that wasn't.
+            const _SdlangTagFrame *frames = _SDLANG_SCRATCH(builder.frames, _SdlangTagFrame);
+            const size_t finished = _SDLANG_SCRATCH_COUNT(builder.frames, _SdlangTagFrame) > 1
+                                        ? frames[1].children * sizeof(SdlangTag)
+                                        : builder.children.length;
+            _treeDrop(&builder, (const SdlangTag *)(builder.children.data + finished),
+                      (builder.children.length - finished) / sizeof(SdlangTag));
+            builder.children.length = finished;
+            builder.values.length = 0;
+            builder.attributes.length = 0;
+        }
+
+        // (The frames may have moved since the root's was pushed.)
+        if (rootFrame && !_treeFinish(&builder, _SDLANG_SCRATCH(builder.frames, _SdlangTagFrame), root))
+        {
+            parsed = false;
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+        }
+
+        _bufferFree(&builder.frames, allocator);
+        _bufferFree(&builder.values, allocator);
+        _bufferFree(&builder.attributes, allocator);
+        _bufferFree(&builder.children, allocator);
+        return parsed;
+    }
+
+    // Adds `children`, an array made by the tree builder, onto the end of the root tag's own, taking it over.
+    // Returns false if out of memory, in which case `children` and its tags are freed.
+    static bool _appendChildren(SdlangTag *rootTag, SdlangTag *children, const SdlangAllocator *custom)
+    {
+        size_t i;
+        if (!rootTag->children)
+        {
+            rootTag->children = children;
+            return true;
+        }
+        if (!children)
+            return true;
+
+        const size_t have = arrlen(rootTag->children), adding = arrlen(children);
+        bool ok = true;
+        if (!custom)
+            memcpy(arraddnptr(rootTag->children, adding), children, adding * sizeof(SdlangTag));
+        else
+        {
+            // Arrays from a custom allocator are exactly sized, so the two have to be merged into a new one.
+            SdlangTag *merged = (SdlangTag *)_allocatorArray((void *)custom, NULL, have + adding, sizeof(SdlangTag));
+            if (merged)
+            {
+                memcpy(merged, rootTag->children, have * sizeof(SdlangTag));
+                memcpy(merged + have, children, adding * sizeof(SdlangTag));
+                _freeArray(rootTag->children, custom);
+                rootTag->children = merged;
+            }
+            else
+            {
+                for (i = 0; i < adding; i++)
+                    sdlangTagFree(children[i], custom);
+                ok = false;
+            }
+        }
+        _freeArray(children, custom);
+        return ok;
+    }
+
+    bool sdlangParseCharStream(SdlangCharStream stream, SdlangTag *rootTag, SdlangError *error,
+                               SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                               const SdlangParseOptions *options)
+    {
+        const SdlangAllocator *custom = options ? options->allocator : NULL;
+        const SdlangAllocator *allocator = _allocatorOrDefault(custom);
+
+        SdlangTag root;
+        bool parsed = _buildTree(stream, allocator, custom ? _allocatorArray : _heapArray, (void *)custom, true, custom,
+                                 false, &root, error, errorLine, errorSlice, options);
+
+        // Add onto whatever the root tag already had, same as before.
+        if (!_appendChildren(rootTag, root.children, custom))
+        {
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            parsed = false;
+        }
+        return parsed;
+    }
+#endif
+
+#ifdef SDLANG_IMPLEMENTATION
+    // Just enough of a thread and mutex wrapper over pthreads and Win32 for the parallel parsers. Without either,
+    // threads never start and callers do the work themselves.
+    typedef struct _SdlangThread
+    {
+        void (*func)(void *arg);
+        void *arg;
+        bool started;
+#if defined(_WIN32)
+        HANDLE handle;
+#elif defined(_SDLANG_POSIX)
+        pthread_t handle;
+#endif
+    } _SdlangThread;
+
+#if defined(_WIN32)
+    static DWORD WINAPI _threadEntry(LPVOID thread)
+    {
+        ((_SdlangThread *)thread)->func(((_SdlangThread *)thread)->arg);
+        return 0;
+    }
+#elif defined(_SDLANG_POSIX)
+    static void *_threadEntry(void *thread)
+    {
+        ((_SdlangThread *)thread)->func(((_SdlangThread *)thread)->arg);
+        return NULL;
+    }
+#endif
+
+    // Runs func(arg) on a new thread, returning false if one couldn't be started. `thread` must stay put until
+    // it's joined.
+    static bool _threadStart(_SdlangThread *thread, void (*func)(void *arg), void *arg)
+    {
+        thread->func = func;
+        thread->arg = arg;
+#if defined(_WIN32)
+        thread->handle = CreateThread(NULL, 0, _threadEntry, thread, 0, NULL);
+        thread->started = thread->handle != NULL;
+#elif defined(_SDLANG_POSIX)
+        thread->started = pthread_create(&thread->handle, NULL, _threadEntry, thread) == 0;
+#else
+        thread->started = false;
+#endif
+        return thread->started;
+    }
+
+    static void _threadJoin(_SdlangThread *thread)
+    {
+        if (!thread->started)
+            return;
+#if defined(_WIN32)
+        WaitForSingleObject(thread->handle, INFINITE);
+        CloseHandle(thread->handle);
+#elif defined(_SDLANG_POSIX)
+        pthread_join(thread->handle, NULL);
+#endif
+        thread->started = false;
+    }
+
+    typedef struct _SdlangMutex
+    {
+#if defined(_WIN32)
+        CRITICAL_SECTION section;
+#elif defined(_SDLANG_POSIX)
+        pthread_mutex_t mutex;
+#else
+        int unused;
+#endif
+    } _SdlangMutex;
+
+    static void _mutexInit(_SdlangMutex *mutex)
+    {
+#if defined(_WIN32)
+        InitializeCriticalSection(&mutex->section);
+#elif defined(_SDLANG_POSIX)
+        pthread_mutex_init(&mutex->mutex, NULL);
+#else
+        (void)mutex;
+#endif
+    }
+
+    static void _mutexLock(_SdlangMutex *mutex)
+    {
+#if defined(_WIN32)
+        EnterCriticalSection(&mutex->section);
+#elif defined(_SDLANG_POSIX)
+        pthread_mutex_lock(&mutex->mutex);
+#else
+        (void)mutex;
+#endif
+    }
+
+    static void _mutexUnlock(_SdlangMutex *mutex)
+    {
+#if defined(_WIN32)
+        LeaveCriticalSection(&mutex->section);
+#elif defined(_SDLANG_POSIX)
+        pthread_mutex_unlock(&mutex->mutex);
+#else
+        (void)mutex;
+#endif
+    }
+
+    static void _mutexDestroy(_SdlangMutex *mutex)
+    {
+#if defined(_WIN32)
+        DeleteCriticalSection(&mutex->section);
+#elif defined(_SDLANG_POSIX)
+        pthread_mutex_destroy(&mutex->mutex);
+#else
+        (void)mutex;
+#endif
+    }
+
+    static size_t _cpuCount(void)
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwNumberOfProcessors;
+#elif defined(_SDLANG_POSIX)
+        const long count = sysconf(_SC_NPROCESSORS_ONLN);
+        return count > 0 ? (size_t)count : 1;
+#else
+        return 1;
+#endif
+    }
+#endif
+
+#ifndef SDLANG_PARALLEL_MIN_SEGMENT
+#define SDLANG_PARALLEL_MIN_SEGMENT (64 * 1024)
+#endif
+
+    // Parses `stream` using up to `threads` threads (0 means one per CPU), adding its tags onto `rootTag` the same as
+    // sdlangParseCharStream would. The resulting tree, and the first error if there is one, are exactly the same as
+    // a serial parse's.
+    //
+    // The text is split at new lines between top level tags into segments of at least SDLANG_PARALLEL_MIN_SEGMENT
+    // bytes (64KB unless you define it yourself). Each segment is parsed into a tree of its own on its own thread,
+    // with its own scratch space, and the trees are then spliced together in document order. A custom allocator in
+    // `options` is shared by all of the threads, so it must be thread safe. `options->index` is ignored.
+    bool sdlangParseCharStreamParallel(SdlangCharStream stream, size_t threads, SdlangTag *rootTag, SdlangError *error,
+                                       SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                                       const SdlangParseOptions *options = NULL);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // Finds up to `count - 1` places to split the text into roughly equal parts, each just after a new line that
+    // isn't escaped, inside of a string, or inside of a tag's children. Returns how many were found.
+    static size_t _findSplits(SdlangCharStream stream, size_t count, size_t *splits, const SdlangAllocator *allocator)
+    {
+        const size_t chunkSize = 64 * 1024;
+        uint32_t *entries = (uint32_t *)allocator->alloc(allocator->context, chunkSize * sizeof(uint32_t));
+        if (!entries)
+            return 0;
+
+        _SdlangIndexState state = {};
+        size_t found = 0, depth = 0, at = 0;
+        size_t target = stream.textLength / count;
+        while (at < stream.textLength && found < count - 1)
+        {
+            const size_t chunkEnd = stream.textLength - at < chunkSize ? stream.textLength : at + chunkSize;
+            const uint32_t *end = _indexRange(stream.text, at, chunkEnd, &state, entries);
+            const uint32_t *entry;
+            for (entry = entries; entry < end && found < count - 1; entry++)
+            {
+                const char ch = stream.text[*entry];
+                if (ch == '{')
+                    depth++;
+                else if (ch == '}')
+                {
+                    if (!depth) // Unbalanced, so leave the rest for the parser to complain about.
+                        goto done;
+                    depth--;
+                }
+                else if (ch == '\n' && !depth && *entry + 1 >= target && *entry + 1 < stream.textLength)
+                {
+                    splits[found++] = *entry + 1;
+                    target = stream.textLength / count * (found + 1);
+                }
+            }
+            at = chunkEnd;
+        }
+
+    done:
+        allocator->free(allocator->context, entries);
+        return found;
+    }
+
+    typedef struct _SdlangSegment
+    {
+        SdlangCharStream stream;
+        const SdlangParseOptions *options;
+        SdlangTag root;
+        bool parsed;
+        SdlangError error;
+        SdlangCharSlice errorLine;
+        SdlangCharSlice errorSlice;
+    } _SdlangSegment;
+
+    static void _parseSegment(void *arg)
+    {
+        _SdlangSegment *segment = (_SdlangSegment *)arg;
+        segment->root = {};
+        segment->parsed = sdlangParseCharStream(segment->stream, &segment->root, &segment->error,
+                                                &segment->errorLine, &segment->errorSlice, segment->options);
+    }
+
+    bool sdlangParseCharStreamParallel(SdlangCharStream stream, size_t threads, SdlangTag *rootTag, SdlangError *error,
+                                       SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                                       const SdlangParseOptions *options)
+    {
+        const SdlangAllocator *custom = options ? options->allocator : NULL;
+        const SdlangAllocator *allocator = _allocatorOrDefault(custom);
+        size_t count = stream.textLength / SDLANG_PARALLEL_MIN_SEGMENT, i;
+        if (!threads)
+            threads = _cpuCount();
+        if (count > threads)
+            count = threads;
+#ifndef _SDLANG_THREADS
+        count = 1;
+#endif
+
+        // Anything that keeps the text from being split just means parsing it in one go.
+        size_t *splits = count > 1 ? (size_t *)allocator->alloc(allocator->context, count * sizeof(size_t)) : NULL;
+        count = splits ? _findSplits(stream, count, splits, allocator) + 1 : 1;
+        _SdlangSegment *segments =
+            count > 1 ? (_SdlangSegment *)allocator->alloc(allocator->context, count * sizeof(_SdlangSegment)) : NULL;
+        if (!segments)
+        {
+            if (splits)
+                allocator->free(allocator->context, splits);
+            return sdlangParseCharStream(stream, rootTag, error, errorLine, errorSlice, options);
+        }
+
+        SdlangParseOptions segmentOptions = {};
+        if (options)
+            segmentOptions = *options;
+        segmentOptions.index = NULL;   // Its offsets are for the whole text.
+        segmentOptions.symbols = NULL; // It can't be shared between threads, so names are interned afterwards.
+
+        for (i = 0; i < count; i++)
+        {
+            const size_t start = i ? splits[i - 1] : 0, end = i + 1 < count ? splits[i] : stream.textLength;
+            segments[i].stream = SdlangCharStream();
+            segments[i].stream.text = stream.text + start;
+            segments[i].stream.textLength = end - start;
+            segments[i].options = &segmentOptions;
+        }
+        allocator->free(allocator->context, splits);
+
+        // The first segment is parsed on this thread, and any thread that can't be started is too.
+        _SdlangThread *workers = (_SdlangThread *)allocator->alloc(allocator->context, count * sizeof(_SdlangThread));
+        for (i = 1; i < count; i++)
+        {
+            if (!workers || !_threadStart(&workers[i], _parseSegment, &segments[i]))
+                _parseSegment(&segments[i]);
+        }
+        _parseSegment(&segments[0]);
+        if (workers)
+        {
+            for (i = 1; i < count; i++)
+                _threadJoin(&workers[i]);
+            allocator->free(allocator->context, workers);
+        }
+
+        // A serial parse stops at the first error, keeping the top level tags that were finished before it.
+        size_t last = 0, total = 0;
+        while (last + 1 < count && segments[last].parsed)
+            last++;
+        for (i = 0; i < count; i++)
+        {
+            if (i <= last)
+                total += arrlen(segments[i].root.children);
+            else
+                sdlangTagFree(segments[i].root, custom);
+        }
+
+        SdlangTag *children = NULL;
+        if (!custom)
+        {
+            for (i = 0; i <= last; i++)
+            {
+                const size_t adding = arrlen(segments[i].root.children);
+                if (adding)
+                    memcpy(arraddnptr(children, adding), segments[i].root.children, adding * sizeof(SdlangTag));
+            }
+        }
+        else if (total)
+        {
+            children = (SdlangTag *)_allocatorArray((void *)custom, NULL, total, sizeof(SdlangTag));
+            size_t at = 0;
+            for (i = 0; children && i <= last; i++)
+            {
+                const size_t adding = arrlen(segments[i].root.children);
+                if (adding)
+                    memcpy(children + at, segments[i].root.children, adding * sizeof(SdlangTag));
+                at += adding;
+            }
+        }
+
+        bool parsed = segments[last].parsed;
+        *error = segments[last].error;
+        *errorLine = segments[last].errorLine;
+        *errorSlice = segments[last].errorSlice;
+        for (i = 0; i <= last; i++)
+        {
+            if (total && !children)
+                sdlangTagFree(segments[i].root, custom);
+            else
+                _freeArray(segments[i].root.children, custom);
+        }
+        allocator->free(allocator->context, segments);
+
+        if (total && !children)
+        {
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            *errorLine = {};
+            *errorSlice = {};
+            return false;
+        }
+        const size_t had = arrlen(rootTag->children);
+        if (!_appendChildren(rootTag, children, custom))
+        {
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            *errorLine = {};
+            *errorSlice = {};
+            return false;
+        }
+
+        // In document order, so every name gets the same symbol a serial parse would have given it.
+        for (i = had; options && options->symbols && i < (size_t)arrlen(rootTag->children); i++)
+        {
+            if (!sdlangTagInternNames(&rootTag->children[i], options->symbols))
+            {
+                *error = SDLANG_ERROR_OUT_OF_MEMORY;
+                *errorLine = {};
+                *errorSlice = {};
+                return false;
+            }
+        }
+        return parsed;
+    }
+#endif
+
+#ifndef SDLANG_ARENA_BLOCK_SIZE
+#define SDLANG_ARENA_BLOCK_SIZE (64 * 1024)
+#endif
+
+    typedef struct _SdlangArenaBlock
+    {
+        struct _SdlangArenaBlock *next;
+        size_t used;
+        size_t capacity;
+    } _SdlangArenaBlock;
+
+    // A parsed tree together with the text it points into, so the two can't accidentally outlive one another.
+    //
+    // Every array in the tree is carved out of the document's arena rather than allocated one by one, so freeing the
+    // document is a matter of freeing a handful of blocks. The arrays still work with stb_ds's read-only macros like
+    // arrlen, but must never be grown or freed with arrput, arrfree, etc.
+    typedef struct SdlangDocument
+    {
+        SdlangTag root;
+        SdlangCharSlice text; // The text `root`'s slices point into.
+
+        _SdlangArenaBlock *_arena;  // The most recent block, which links back to the older ones.
+        SdlangAllocator _allocator; // Where the arena's blocks come from.
+        void *_mapping;             // Set when `text` is a memory mapped file.
+        size_t _mappingLength;
+        char *_buffer; // Set when `text` had to be read into memory instead.
+        bool _indexAttributes;       // From the parse options, for when sdlangTagChildren parses more of it.
+        SdlangSymbolTable *_symbols; // Likewise.
+        bool _unescapeStrings;       // Likewise, or once sdlangDocumentUnescapeStrings has been called.
+        bool _deferValues;           // From the parse options, like _indexAttributes.
+    } SdlangDocument;
+
+    // Parses `stream` into `document`, which doesn't take ownership of the text.
+    // The document must always be freed with sdlangDocumentFree, even when parsing failed.
+    bool sdlangParseDocument(SdlangCharStream stream, SdlangDocument *document, SdlangError *error,
+                             SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                             const SdlangParseOptions *options = NULL);
+
+    // Maps the file at `path` into memory and parses it directly from the mapping.
+    // The document owns both the mapping and the tree, so it must always be freed with sdlangDocumentFree, even
+    // when parsing failed (errorLine and errorSlice point into the mapping).
+    bool sdlangParseFile(const char *path, SdlangDocument *document, SdlangError *error, SdlangCharSlice *errorLine,
+                         SdlangCharSlice *errorSlice, const SdlangParseOptions *options = NULL);
+
+    // Allocates `size` bytes from the document's arena, suitably aligned for any type. They're freed along with
+    // the document.
+    void *sdlangDocumentAlloc(SdlangDocument *document, size_t size);
+
+    // Copies `length` chars of `text` into the document's arena, followed by a null terminator, so it can be added
+    // to the tree without worrying about its lifetime.
+    SdlangCharSlice sdlangDocumentAllocString(SdlangDocument *document, const char *text, size_t length);
+
+    // Returns the children of `tag`, a tag from `document`. If the document was parsed lazily, the tag's block is
+    // parsed (lazily again, so the children's own blocks are skipped) into the document's arena the first time it's
+    // asked for, which may fail with any of the errors a parse can. NULL either means the tag has no children, or
+    // that parsing them failed and `error` says why. Not thread safe, as it changes both `tag` and `document`.
+    //
+    // Anything that walks the tree by itself, like the emitter or sdlangTapeFromTag, only sees children that have
+    // already been parsed.
+    SdlangTag *sdlangTagChildren(SdlangDocument *document, SdlangTag *tag, SdlangError *error = NULL,
+                                 SdlangCharSlice *errorLine = NULL, SdlangCharSlice *errorSlice = NULL);
+
+    // Points every string in the document that `requiresEscape` at a copy of its text with the escapes resolved,
+    // so all of them can be used as they are. The copies share one allocation from the document's arena. Children
+    // that a lazy document parses later on are resolved as they're parsed. Returns false if out of memory, in which
+    // case nothing was changed.
+    bool sdlangDocumentUnescapeStrings(SdlangDocument *document);
+
+    void sdlangDocumentFree(SdlangDocument *document);
+
+#ifdef SDLANG_IMPLEMENTATION
+    static SdlangError _mapFile(const char *path, SdlangDocument *document)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return SDLANG_ERROR_FILE_OPEN;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            return SDLANG_ERROR_FILE_READ;
+        }
+        if (size.QuadPart == 0) // Empty files can't be mapped.
+        {
+            CloseHandle(file);
+            return SDLANG_ERROR_NONE;
+        }
+
+        // The view keeps the file alive by itself, so neither handle is needed afterwards.
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (!mapping)
+            return SDLANG_ERROR_FILE_READ;
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!view)
+            return SDLANG_ERROR_FILE_READ;
+
+        document->_mapping = view;
+        document->_mappingLength = (size_t)size.QuadPart;
+        document->text.ptr = (const char *)view;
+        document->text.length = (size_t)size.QuadPart;
+        return SDLANG_ERROR_NONE;
+#elif defined(_SDLANG_POSIX)
+        const int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            return SDLANG_ERROR_FILE_OPEN;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+            close(fd);
+            return SDLANG_ERROR_FILE_READ;
+        }
+        if (info.st_size == 0) // Empty files can't be mapped.
+        {
+            close(fd);
+            return SDLANG_ERROR_NONE;
+        }
+
+        void *view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd); // The mapping keeps the file alive by itself.
+        if (view == MAP_FAILED)
+            return SDLANG_ERROR_FILE_READ;
+        madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+        document->_mapping = view;
+        document->_mappingLength = (size_t)info.st_size;
+        document->text.ptr = (const char *)view;
+        document->text.length = (size_t)info.st_size;
+        return SDLANG_ERROR_NONE;
+#else
+        // No way to map files on this platform, so fall back to reading the whole thing in.
+        FILE *file = fopen(path, "rb");
+        if (!file)
+            return SDLANG_ERROR_FILE_OPEN;
+
+        long size = -1;
+        if (fseek(file, 0, SEEK_END) == 0)
+            size = ftell(file);
+        if (size < 0 || fseek(file, 0, SEEK_SET) != 0)
+        {
+            fclose(file);
+            return SDLANG_ERROR_FILE_READ;
+        }
+
+        const SdlangAllocator *allocator = &document->_allocator;
+        char *buffer = (char *)allocator->alloc(allocator->context, size ? (size_t)size : 1);
+        const bool read = buffer && fread(buffer, 1, (size_t)size, file) == (size_t)size;
+        fclose(file);
+        if (!read)
+        {
+            if (buffer)
+                allocator->free(allocator->context, buffer);
+            return buffer ? SDLANG_ERROR_FILE_READ : SDLANG_ERROR_OUT_OF_MEMORY;
+        }
+
+        document->_buffer = buffer;
+        document->text.ptr = buffer;
+        document->text.length = (size_t)size;
+        return SDLANG_ERROR_NONE;
+#endif
+    }
+
+    static const size_t _ARENA_ALIGNMENT = 16;
+    static const size_t _ARENA_HEADER = (sizeof(_SdlangArenaBlock) + 15) & ~(size_t)15;
+
+    void *sdlangDocumentAlloc(SdlangDocument *document, size_t size)
+    {
+        size = (size + _ARENA_ALIGNMENT - 1) & ~(_ARENA_ALIGNMENT - 1);
+
+        if (!document->_allocator.alloc) // A document that was zero initialised rather than parsed.
+            document->_allocator = _MALLOC_ALLOCATOR;
+
+        _SdlangArenaBlock *block = document->_arena;
+        if (!block || block->capacity - block->used < size)
+        {
+            // Each block is double the size of the last one, so large documents only need a few of them.
+            size_t capacity = block ? block->capacity * 2 : SDLANG_ARENA_BLOCK_SIZE;
+            if (capacity > 64 * SDLANG_ARENA_BLOCK_SIZE)
+                capacity = 64 * SDLANG_ARENA_BLOCK_SIZE;
+            if (capacity < size + _ARENA_HEADER)
+                capacity = size + _ARENA_HEADER;
+
+            _SdlangArenaBlock *next =
+                (_SdlangArenaBlock *)document->_allocator.alloc(document->_allocator.context, capacity);
+            if (!next)
+                return NULL;
+            next->next = block;
+            next->used = _ARENA_HEADER;
+            next->capacity = capacity;
+            document->_arena = block = next;
+        }
+
+        void *ptr = (char *)block + block->used;
+        block->used += size;
+        return ptr;
+    }
+
+    SdlangCharSlice sdlangDocumentAllocString(SdlangDocument *document, const char *text, size_t length)
+    {
+        char *copy = (char *)sdlangDocumentAlloc(document, length + 1);
+        if (!copy)
+        {
+            SdlangCharSlice empty = {NULL, 0};
+            return empty;
+        }
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+
+        SdlangCharSlice slice = {copy, length};
+        return slice;
+    }
+
+    // Makes an array inside of the document's arena, complete with an stb_ds header so arrlen and friends work.
+    static void *_arenaArray(void *context, const void *items, size_t count, size_t itemSize)
+    {
+        if (!count)
+            return NULL;
+
+        stbds_array_header *header = (stbds_array_header *)sdlangDocumentAlloc(
+            (SdlangDocument *)context, sizeof(stbds_array_header) + count * itemSize);
+        if (!header)
+            return NULL;
+        header->length = count;
+        header->capacity = count;
+        header->hash_table = NULL;
+        header->temp = 0;
+        if (items)
+            memcpy(header + 1, items, count * itemSize);
+        return header + 1;
+    }
+
+    static size_t _escapedLength(const SdlangTag *tag)
+    {
+        size_t length = 0, i;
+        for (i = 0; i < arrlen(tag->values); i++)
+            length += tag->values[i].requiresEscape ? tag->values[i].stringValue.length : 0;
+        for (i = 0; i < arrlen(tag->attributes); i++)
+            length += tag->attributes[i].value.requiresEscape ? tag->attributes[i].value.stringValue.length : 0;
+        for (i = 0; i < arrlen(tag->children); i++)
+            length += _escapedLength(&tag->children[i]);
+        return length;
+    }
+
+    static void _unescapeValue(SdlangValue *value, char **out)
+    {
+        if (!value->requiresEscape)
+            return;
+        const size_t length = sdlangUnescape(value->stringValue, *out);
+        value->stringValue.ptr = *out;
+        value->stringValue.length = length;
+        value->requiresEscape = false;
+        *out += length;
+    }
+
+    static void _unescapeTag(SdlangTag *tag, char **out)
+    {
+        size_t i;
+        for (i = 0; i < arrlen(tag->values); i++)
+            _unescapeValue(&tag->values[i], out);
+        for (i = 0; i < arrlen(tag->attributes); i++)
+            _unescapeValue(&tag->attributes[i].value, out);
+        for (i = 0; i < arrlen(tag->children); i++)
+            _unescapeTag(&tag->children[i], out);
+    }
+
+    // Unescapes everything under `tag` into one allocation, which is big enough since escapes only ever shrink.
+    static bool _unescapeStrings(SdlangDocument *document, SdlangTag *tag)
+    {
+        const size_t length = _escapedLength(tag);
+        if (!length)
+            return true;
+
+        char *out = (char *)sdlangDocumentAlloc(document, length);
+        if (!out)
+            return false;
+        _unescapeTag(tag, &out);
+        return true;
+    }
+
+    static bool _parseDocument(SdlangCharStream stream, SdlangDocument *document, SdlangError *error,
+                               SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice,
+                               const SdlangParseOptions *options)
+    {
+        // Everything lives in the arena, so there's never anything to free early.
+        document->_indexAttributes = options && options->indexAttributes;
+        document->_symbols = options ? options->symbols : NULL;
+        document->_unescapeStrings = options && options->unescapeStrings;
+        document->_deferValues = options && options->deferValues;
+        if (!_buildTree(stream, &document->_allocator, _arenaArray, document, false, NULL, options && options->lazy,
+                        &document->root, error, errorLine, errorSlice, options))
+            return false;
+        if (document->_unescapeStrings && !_unescapeStrings(document, &document->root))
+        {
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            return false;
+        }
+        return true;
+    }
+
+    bool sdlangParseDocument(SdlangCharStream stream, SdlangDocument *document, SdlangError *error,
+                             SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice, const SdlangParseOptions *options)
+    {
+        *document = {};
+        document->_allocator = *_allocatorOrDefault(options ? options->allocator : NULL);
+        document->text.ptr = stream.text;
+        document->text.length = stream.textLength;
+        return _parseDocument(stream, document, error, errorLine, errorSlice, options);
+    }
+
+    bool sdlangParseFile(const char *path, SdlangDocument *document, SdlangError *error, SdlangCharSlice *errorLine,
+                         SdlangCharSlice *errorSlice, const SdlangParseOptions *options)
+    {
+        *document = {};
+        document->_allocator = *_allocatorOrDefault(options ? options->allocator : NULL);
+        document->text.ptr = "";
+
+        *error = _mapFile(path, document);
+        if (*error)
+        {
+            *errorLine = {};
+            *errorSlice = {};
+            return false;
+        }
+
+        SdlangCharStream stream = {document->text.ptr, document->text.length};
+        return _parseDocument(stream, document, error, errorLine, errorSlice, options);
+    }
+
+    bool sdlangDocumentUnescapeStrings(SdlangDocument *document)
+    {
+        document->_unescapeStrings = true;
+        return _unescapeStrings(document, &document->root);
+    }
+
+    SdlangTag *sdlangTagChildren(SdlangDocument *document, SdlangTag *tag, SdlangError *error,
+                                 SdlangCharSlice *errorLine, SdlangCharSlice *errorSlice)
+    {
+        SdlangError ignoredError;
+        SdlangCharSlice ignoredLine, ignoredSlice;
+        error = error ? error : &ignoredError;
+        errorLine = errorLine ? errorLine : &ignoredLine;
+        errorSlice = errorSlice ? errorSlice : &ignoredSlice;
+
+        *error = SDLANG_ERROR_NONE;
+        if (!tag->_unparsedChildren.ptr)
+            return tag->children;
+
+        // Parse the block in place, so errors point into the document's text just as they would have originally.
+        // Its nesting was already checked against maxDepth when it was skipped.
+        const SdlangCharSlice block = tag->_unparsedChildren;
+        const size_t at = (size_t)(block.ptr - document->text.ptr);
+        SdlangCharStream stream = {document->text.ptr, at + block.length, at};
+        SdlangParseOptions options = {};
+        options.maxDepth = SIZE_MAX;
+        options.indexAttributes = document->_indexAttributes;
+        options.symbols = document->_symbols;
+        options.deferValues = document->_deferValues;
+
+        SdlangTag children;
+        if (!_buildTree(stream, &document->_allocator, _arenaArray, document, false, NULL, true, &children, error,
+                        errorLine, errorSlice, &options))
+            return NULL;
+
+        if (document->_unescapeStrings && !_unescapeStrings(document, &children))
+        {
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            return NULL;
+        }
+
+        tag->children = children.children;
+        tag->_unparsedChildren = {};
+        return tag->children;
+    }
+
+    void sdlangDocumentFree(SdlangDocument *document)
+    {
+        _SdlangArenaBlock *block = document->_arena;
+        while (block)
+        {
+            _SdlangArenaBlock *next = block->next;
+            document->_allocator.free(document->_allocator.context, block);
+            block = next;
+        }
+
+#if defined(_WIN32)
+        if (document->_mapping)
+            UnmapViewOfFile(document->_mapping);
+#elif defined(_SDLANG_POSIX)
+        if (document->_mapping)
+            munmap(document->_mapping, document->_mappingLength);
+#endif
+        if (document->_buffer)
+            document->_allocator.free(document->_allocator.context, document->_buffer);
+
+        *document = {};
+    }
+#endif
+
+    // One file or buffer for sdlangParseBatch to parse, along with the outcome.
+    typedef struct SdlangBatchItem
+    {
+        const char *path;        // The file to parse, or NULL to parse `stream` instead.
+        SdlangCharStream stream; // The text to parse when there's no path. It isn't copied, so must outlive the item.
+
+        SdlangDocument document; // Always needs freeing with sdlangDocumentFree, even when parsing failed.
+        bool parsed;
+        SdlangError error; // The rest are only set when parsing failed, the same as sdlangParseFile's.
+        SdlangCharSlice errorLine;
+        SdlangCharSlice errorSlice;
+    } SdlangBatchItem;
+
+    // Parses every item into its own document using up to `threads` threads (0 means one per CPU), returning true
+    // if all of them parsed. Each item is parsed exactly as sdlangParseFile or sdlangParseDocument would.
+    //
+    // Items are handed out largest first, so one big file found late can't hold everything else up, and a thread
+    // that runs out of work steals from the others. A custom allocator in `options` is shared by all of the
+    // threads, so it must be thread safe. `options->index` is ignored, and names are only interned into
+    // `options->symbols` once every item has been parsed.
+    bool sdlangParseBatch(SdlangBatchItem *items, size_t count, size_t threads, const SdlangParseOptions *options = NULL);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // The size of the file at `path`, or 0 if it can't be found out, in which case the parse will report why.
+    static uint64_t _fileSize(const char *path)
+    {
+#if defined(_WIN32)
+        WIN32_FILE_ATTRIBUTE_DATA info;
+        if (!GetFileAttributesExA(path, GetFileExInfoStandard, &info))
+            return 0;
+        return ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+#elif defined(_SDLANG_POSIX)
+        struct stat info;
+        return stat(path, &info) == 0 ? (uint64_t)info.st_size : 0;
+#else
+        (void)path;
+        return 0;
+#endif
+    }
+
+    typedef struct _SdlangBatchJob
+    {
+        uint64_t size;
+        size_t item;
+    } _SdlangBatchJob;
+
+    static int _compareBatchJobs(const void *a, const void *b)
+    {
+        const _SdlangBatchJob *left = (const _SdlangBatchJob *)a, *right = (const _SdlangBatchJob *)b;
+        if (left->size != right->size)
+            return left->size > right->size ? -1 : 1;
+        return left->item < right->item ? -1 : left->item > right->item; // Keeps the order stable.
+    }
+
+    // A worker's share of the items. It takes from the front, largest first, while thieves take from the back.
+    typedef struct _SdlangBatchQueue
+    {
+        _SdlangMutex mutex;
+        size_t *items;
+        size_t front, back;
+    } _SdlangBatchQueue;
+
+    typedef struct _SdlangBatch
+    {
+        SdlangBatchItem *items;
+        _SdlangBatchQueue *queues;
+        size_t queueCount;
+        const SdlangParseOptions *options;
+    } _SdlangBatch;
+
+    typedef struct _SdlangBatchWorker
+    {
+        _SdlangBatch *batch;
+        size_t queue;
+    } _SdlangBatchWorker;
+
+    static bool _popBatchItem(_SdlangBatchQueue *queue, bool steal, size_t *item)
+    {
+        _mutexLock(&queue->mutex);
+        const bool found = queue->front < queue->back;
+        if (found)
+            *item = steal ? queue->items[--queue->back] : queue->items[queue->front++];
+        _mutexUnlock(&queue->mutex);
+        return found;
+    }
+
+    static void _parseBatchItem(SdlangBatchItem *item, const SdlangParseOptions *options)
+    {
+        if (item->path)
+            item->parsed = sdlangParseFile(item->path, &item->document, &item->error, &item->errorLine,
+                                           &item->errorSlice, options);
+        else
+            item->parsed = sdlangParseDocument(item->stream, &item->document, &item->error, &item->errorLine,
+                                               &item->errorSlice, options);
+    }
+
+    static void _parseBatchItems(void *arg)
+    {
+        const _SdlangBatchWorker *worker = (const _SdlangBatchWorker *)arg;
+        _SdlangBatch *batch = worker->batch;
+        size_t item, victim = worker->queue;
+        for (;;)
+        {
+            // Nothing is ever added back, so once every queue has been found empty there's nothing left to do.
+            size_t tried = 0;
+            while (tried < batch->queueCount && !_popBatchItem(&batch->queues[victim], victim != worker->queue, &item))
+            {
+                victim = (victim + 1) % batch->queueCount;
+                tried++;
+            }
+            if (tried == batch->queueCount)
+                return;
+
+            _parseBatchItem(&batch->items[item], batch->options);
+        }
+    }
+
+    bool sdlangParseBatch(SdlangBatchItem *items, size_t count, size_t threads, const SdlangParseOptions *options)
+    {
+        SdlangParseOptions itemOptions = {};
+        if (options)
+            itemOptions = *options;
+        itemOptions.index = NULL;
+        itemOptions.symbols = NULL; // It can't be shared between threads, so names are interned afterwards.
+
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            items[i].document = {};
+            items[i].parsed = false;
+            items[i].error = SDLANG_ERROR_NONE;
+            items[i].errorLine = {};
+            items[i].errorSlice = {};
+        }
+
+        if (threads == 0)
+            threads = _cpuCount();
+#ifndef _SDLANG_THREADS
+        threads = 1;
+#endif
+        if (threads > count)
+            threads = count;
+
+        // Everything the workers share comes out of one allocation: the jobs, the queues, and the item indices
+        // they point into, which are dealt out round robin so that every queue starts with a mix of sizes.
+        const SdlangAllocator *allocator = _allocatorOrDefault(itemOptions.allocator);
+        const size_t bytes = count * sizeof(_SdlangBatchJob) + threads * sizeof(_SdlangBatchQueue) +
+                             threads * sizeof(_SdlangBatchWorker) + threads * sizeof(_SdlangThread) +
+                             count * sizeof(size_t);
+        char *scratch = threads > 1 ? (char *)allocator->alloc(allocator->context, bytes) : NULL;
+        if (!scratch)
+        {
+            // A single thread needs no scheduling, which also makes it the fallback when there's no memory for it.
+            for (i = 0; i < count; i++)
+                _parseBatchItem(&items[i], &itemOptions);
+        }
+        else
+        {
+            _SdlangBatchJob *jobs = (_SdlangBatchJob *)scratch;
+            _SdlangBatchQueue *queues = (_SdlangBatchQueue *)(jobs + count);
+            _SdlangBatchWorker *workers = (_SdlangBatchWorker *)(queues + threads);
+            _SdlangThread *handles = (_SdlangThread *)(workers + threads);
+            size_t *order = (size_t *)(handles + threads);
+
+            for (i = 0; i < count; i++)
+            {
+                jobs[i].size = items[i].path ? _fileSize(items[i].path) : items[i].stream.textLength;
+                jobs[i].item = i;
+            }
+            qsort(jobs, count, sizeof(_SdlangBatchJob), _compareBatchJobs);
+
+            // Queue `q` gets jobs q, q + threads, q + 2 * threads, ... stored back to back.
+            size_t q, at = 0;
+            for (q = 0; q < threads; q++)
+            {
+                _mutexInit(&queues[q].mutex);
+                queues[q].items = order + at;
+                queues[q].front = 0;
+                for (i = q; i < count; i += threads)
+                    order[at++] = jobs[i].item;
+                queues[q].back = (size_t)(order + at - queues[q].items);
+            }
+
+            _SdlangBatch batch = {items, queues, threads, &itemOptions};
+            // This thread works through the first queue. A thread that can't be started doesn't matter, since its
+            // queue is stolen from like any other.
+            for (q = 0; q < threads; q++)
+            {
+                workers[q].batch = &batch;
+                workers[q].queue = q;
+                if (q > 0)
+                    _threadStart(&handles[q], _parseBatchItems, &workers[q]);
+            }
+            _parseBatchItems(&workers[0]);
+            for (q = 1; q < threads; q++)
+                _threadJoin(&handles[q]);
+
+            for (q = 0; q < threads; q++)
+                _mutexDestroy(&queues[q].mutex);
+            allocator->free(allocator->context, scratch);
+        }
+
+        // In item order, so every name gets the same symbol parsing the items one by one would have given it.
+        for (i = 0; options && options->symbols && i < count; i++)
+        {
+            items[i].document._symbols = options->symbols;
+            if (!sdlangTagInternNames(&items[i].document.root, options->symbols))
+            {
+                items[i].parsed = false;
+                items[i].error = SDLANG_ERROR_OUT_OF_MEMORY;
+                items[i].errorLine = {};
+                items[i].errorSlice = {};
+            }
+        }
+
+        bool parsed = true;
+        for (i = 0; i < count; i++)
+            parsed = parsed && items[i].parsed;
+        return parsed;
+    }
+#endif
+
+    // A flat alternative to the SdlangTag tree, meant for large documents and tight loops.
+    //
+    // Every tag is a node in one contiguous array, in document order, with the root at index 0. Nodes refer to
+    // each other by index, and their values and attributes are ranges inside of two shared pools. Since each tag's
+    // descendants directly follow it, `subtreeEnd` can skip straight over them.
+    typedef uint32_t SdlangTapeIndex;
+    const SdlangTapeIndex SDLANG_TAPE_ROOT = 0;
+    const SdlangTapeIndex SDLANG_TAPE_NONE = UINT32_MAX;
+
+    typedef struct SdlangTapeNode
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        SdlangTapeIndex firstChild;  // SDLANG_TAPE_NONE if there are no children.
+        SdlangTapeIndex nextSibling; // SDLANG_TAPE_NONE if this is the last child.
+        SdlangTapeIndex subtreeEnd;  // The index just past this node's last descendant.
+        SdlangTapeIndex firstValue;  // Index into the value pool.
+        SdlangTapeIndex valueCount;
+        SdlangTapeIndex firstAttribute; // Index into the attribute pool.
+        SdlangTapeIndex attributeCount;
+    } SdlangTapeNode;
+
+    typedef struct SdlangTape
+    {
+        SdlangTapeNode *nodes;
+        SdlangValue *values;
+        SdlangAttribute *attributes;
+        size_t nodeCount;
+        size_t valueCount;
+        size_t attributeCount;
+        SdlangAllocator _allocator;
+    } SdlangTape;
+
+    // Parses `stream` straight into a tape, which must always be freed with sdlangTapeFree, even when parsing
+    // failed. Only `options->allocator` is used for the tape's pools, so each pool ends up as a single allocation.
+    bool sdlangParseTape(SdlangCharStream stream, SdlangTape *tape, SdlangError *error, SdlangCharSlice *errorLine,
+                         SdlangCharSlice *errorSlice, const SdlangParseOptions *options = NULL);
+    void sdlangTapeFree(SdlangTape *tape);
+
+    SdlangTapeIndex sdlangTapeFirstChild(const SdlangTape *tape, SdlangTapeIndex node);
+    SdlangTapeIndex sdlangTapeNextSibling(const SdlangTape *tape, SdlangTapeIndex node);
+    const SdlangValue *sdlangTapeValues(const SdlangTape *tape, SdlangTapeIndex node, size_t *count);
+    const SdlangAttribute *sdlangTapeAttributes(const SdlangTape *tape, SdlangTapeIndex node, size_t *count);
+
+    // Flattens the tree under `root` (which becomes the tape's root) into a tape. Returns false if out of memory.
+    bool sdlangTapeFromTag(SdlangTag root, SdlangTape *tape, const SdlangAllocator *allocator = NULL);
+
+    // Builds a tree out of `node` and its descendants, to be freed with sdlangTagFree(*tag, allocator).
+    // Returns false if out of memory.
+    bool sdlangTapeToTag(const SdlangTape *tape, SdlangTapeIndex node, SdlangTag *tag,
+                         const SdlangAllocator *allocator = NULL);
+
+#ifdef SDLANG_IMPLEMENTATION
+    typedef struct _SdlangTapeFrame
+    {
+        SdlangTapeIndex node;
+        SdlangTapeIndex lastChild;
+    } _SdlangTapeFrame;
+
+    typedef struct _SdlangTapeBuilder
+    {
+        _SdlangBuffer nodes;
+        _SdlangBuffer values;
+        _SdlangBuffer attributes;
+        _SdlangBuffer frames; // The root, followed by every tag that's still open.
+        const SdlangAllocator *allocator;
+        SdlangError error;
+    } _SdlangTapeBuilder;
+
+    static SdlangTapeNode *_tapeNode(_SdlangTapeBuilder *builder, SdlangTapeIndex index)
+    {
+        return _SDLANG_SCRATCH(builder->nodes, SdlangTapeNode) + index;
+    }
+
+    // Adds a node as the last child of the innermost open tag, and opens it.
+    static bool _tapeOpen(_SdlangTapeBuilder *builder, SdlangCharSlice nspace, SdlangCharSlice name)
+    {
+        const size_t index = _SDLANG_SCRATCH_COUNT(builder->nodes, SdlangTapeNode);
+        if (index >= SDLANG_TAPE_NONE)
+        {
+            builder->error = SDLANG_ERROR_TAPE_TOO_LARGE;
+            return false;
+        }
+
+        SdlangTapeNode *node = (SdlangTapeNode *)_bufferPush(&builder->nodes, builder->allocator, sizeof(*node));
+        _SdlangTapeFrame *frame =
+            node ? (_SdlangTapeFrame *)_bufferPush(&builder->frames, builder->allocator, sizeof(*frame)) : NULL;
+        if (!frame)
+        {
+            builder->error = SDLANG_ERROR_OUT_OF_MEMORY;
+            return false;
+        }
+
+        node->nspace = nspace;
+        node->name = name;
+        node->firstChild = SDLANG_TAPE_NONE;
+        node->nextSibling = SDLANG_TAPE_NONE;
+        node->subtreeEnd = SDLANG_TAPE_NONE;
+        node->firstValue = 0;
+        node->valueCount = 0;
+        node->firstAttribute = 0;
+        node->attributeCount = 0;
+        frame->node = (SdlangTapeIndex)index;
+        frame->lastChild = SDLANG_TAPE_NONE;
+
+        if (index != SDLANG_TAPE_ROOT)
+        {
+            _SdlangTapeFrame *parent = frame - 1;
+            if (parent->lastChild == SDLANG_TAPE_NONE)
+                _tapeNode(builder, parent->node)->firstChild = (SdlangTapeIndex)index;
+            else
+                _tapeNode(builder, parent->lastChild)->nextSibling = (SdlangTapeIndex)index;
+            parent->lastChild = (SdlangTapeIndex)index;
+        }
+        return true;
+    }
+
+    static void _tapeClose(_SdlangTapeBuilder *builder)
+    {
+        builder->frames.length -= sizeof(_SdlangTapeFrame);
+        const _SdlangTapeFrame *frame = (const _SdlangTapeFrame *)(builder->frames.data + builder->frames.length);
+        _tapeNode(builder, frame->node)->subtreeEnd =
+            (SdlangTapeIndex)_SDLANG_SCRATCH_COUNT(builder->nodes, SdlangTapeNode);
+    }
+
+    // Adds a value or attribute to a node, keeping the node's items next to each other in the pool. Items only ever
+    // go to the innermost open tag, so the only time its range isn't already at the end of the pool is when a tag
+    // has more values after its children's closing brace. The items in between can then only belong to the tag's
+    // descendants, so the tag's range is rotated past them to keep the pool free of gaps. Descendants whose items
+    // were already moved in front of the range by an earlier rotation stay where they are.
+    static bool _tapeAdd(_SdlangTapeBuilder *builder, SdlangTapeIndex index, bool attribute, const void *item)
+    {
+        _SdlangBuffer *pool = attribute ? &builder->attributes : &builder->values;
+        const size_t itemSize = attribute ? sizeof(SdlangAttribute) : sizeof(SdlangValue);
+        SdlangTapeNode *node = _tapeNode(builder, index);
+        SdlangTapeIndex *first = attribute ? &node->firstAttribute : &node->firstValue;
+        const SdlangTapeIndex count = attribute ? node->attributeCount : node->valueCount;
+
+        const size_t end = pool->length / itemSize;
+        if (count && *first + count != end)
+        {
+            const SdlangTapeIndex after = *first + count; // Only items from here on move down.
+            char *moved = (char *)_bufferPush(pool, builder->allocator, count * itemSize);
+            if (!moved)
+                goto outOfMemory;
+            memcpy(moved, pool->data + *first * itemSize, count * itemSize);
+            memmove(pool->data + *first * itemSize, pool->data + (*first + count) * itemSize,
+                    (end - *first) * itemSize);
+            pool->length -= count * itemSize;
+            *first = (SdlangTapeIndex)(end - count);
+
+            SdlangTapeNode *descendant = node + 1;
+            SdlangTapeNode *last = _SDLANG_SCRATCH(builder->nodes, SdlangTapeNode) +
+                                   _SDLANG_SCRATCH_COUNT(builder->nodes, SdlangTapeNode);
+            for (; descendant < last; descendant++)
+            {
+                if (attribute && descendant->attributeCount && descendant->firstAttribute >= after)
+                    descendant->firstAttribute -= count;
+                else if (!attribute && descendant->valueCount && descendant->firstValue >= after)
+                    descendant->firstValue -= count;
+            }
+        }
+
+        {
+            void *slot = _bufferPush(pool, builder->allocator, itemSize);
+            if (!slot)
+                goto outOfMemory;
+            memcpy(slot, item, itemSize);
+
+            node = _tapeNode(builder, index);
+            if (attribute)
+            {
+                if (!node->attributeCount++)
+                    node->firstAttribute = (SdlangTapeIndex)end;
+            }
+            else if (!node->valueCount++)
+                node->firstValue = (SdlangTapeIndex)end;
+            return true;
+        }
+
+    outOfMemory:
+        builder->error = SDLANG_ERROR_OUT_OF_MEMORY;
+        return false;
+    }
+
+    static SdlangTapeIndex _tapeCurrent(const _SdlangTapeBuilder *builder)
+    {
+        return ((const _SdlangTapeFrame *)(builder->frames.data + builder->frames.length))[-1].node;
+    }
+
+    static SdlangEventAction _tapeTagStart(SdlangCharSlice nspace, SdlangCharSlice name, void *userData)
+    {
+        return _tapeOpen((_SdlangTapeBuilder *)userData, nspace, name) ? SDLANG_EVENT_CONTINUE : SDLANG_EVENT_STOP;
+    }
+
+    static SdlangEventAction _tapeValue(SdlangValue value, void *userData)
+    {
+        _SdlangTapeBuilder *builder = (_SdlangTapeBuilder *)userData;
+        return _tapeAdd(builder, _tapeCurrent(builder), false, &value) ? SDLANG_EVENT_CONTINUE : SDLANG_EVENT_STOP;
+    }
+
+    static SdlangEventAction _tapeAttribute(SdlangCharSlice nspace, SdlangCharSlice name, SdlangValue value,
+                                            void *userData)
+    {
+        _SdlangTapeBuilder *builder = (_SdlangTapeBuilder *)userData;
+        SdlangAttribute attrib;
+        attrib.nspace = nspace;
+        attrib.name = name;
+        attrib.value = value;
+        return _tapeAdd(builder, _tapeCurrent(builder), true, &attrib) ? SDLANG_EVENT_CONTINUE : SDLANG_EVENT_STOP;
+    }
+
+    static SdlangEventAction _tapeTagEnd(void *userData)
+    {
+        _tapeClose((_SdlangTapeBuilder *)userData);
+        return SDLANG_EVENT_CONTINUE;
+    }
+
+    // Hands the builder's pools over to the tape, trimmed down to size.
+    static void _tapeFinish(_SdlangTapeBuilder *builder, SdlangTape *tape)
+    {
+        _SdlangBuffer *pools[] = {&builder->nodes, &builder->values, &builder->attributes};
+        size_t i;
+        for (i = 0; i < 3; i++)
+        {
+            _SdlangBuffer *pool = pools[i];
+            if (pool->length && pool->length < pool->capacity)
+            {
+                char *trimmed = (char *)builder->allocator->realloc(builder->allocator->context, pool->data,
+                                                                    pool->length);
+                if (trimmed)
+                    pool->data = trimmed;
+            }
+        }
+
+        tape->nodes = _SDLANG_SCRATCH(builder->nodes, SdlangTapeNode);
+        tape->nodeCount = _SDLANG_SCRATCH_COUNT(builder->nodes, SdlangTapeNode);
+        tape->values = _SDLANG_SCRATCH(builder->values, SdlangValue);
+        tape->valueCount = _SDLANG_SCRATCH_COUNT(builder->values, SdlangValue);
+        tape->attributes = _SDLANG_SCRATCH(builder->attributes, SdlangAttribute);
+        tape->attributeCount = _SDLANG_SCRATCH_COUNT(builder->attributes, SdlangAttribute);
+        _bufferFree(&builder->frames, builder->allocator);
+    }
+
+    static const SdlangEvents _TAPE_EVENTS = {_tapeTagStart, _tapeValue, _tapeAttribute, NULL, NULL, _tapeTagEnd};
+
+    bool sdlangParseTape(SdlangCharStream stream, SdlangTape *tape, SdlangError *error, SdlangCharSlice *errorLine,
+                         SdlangCharSlice *errorSlice, const SdlangParseOptions *options)
+    {
+        *tape = {};
+        tape->_allocator = *_allocatorOrDefault(options ? options->allocator : NULL);
+
+        _SdlangTapeBuilder builder = {};
+        builder.allocator = &tape->_allocator;
+
+        bool parsed = false;
+        if (_tapeOpen(&builder, SdlangCharSlice(), SdlangCharSlice()))
+        {
+            SdlangEvents events = _TAPE_EVENTS;
+            events.userData = &builder;
+            parsed = sdlangParseEvents(stream, &events, error, errorLine, errorSlice, options);
+        }
+
+        if (builder.error)
+        {
+            *error = builder.error;
+            *errorLine = {};
+            *errorSlice = {};
+        }
+
+        // Close off whatever is still open, so the tape is well formed even when parsing failed.
+        while (builder.frames.length)
+            _tapeClose(&builder);
+        _tapeFinish(&builder, tape);
+        return parsed;
+    }
+
+    void sdlangTapeFree(SdlangTape *tape)
+    {
+        void *pools[] = {tape->nodes, tape->values, tape->attributes};
+        size_t i;
+        for (i = 0; i < 3; i++)
+        {
+            if (pools[i])
+                tape->_allocator.free(tape->_allocator.context, pools[i]);
+        }
+        *tape = {};
+    }
+
+    SdlangTapeIndex sdlangTapeFirstChild(const SdlangTape *tape, SdlangTapeIndex node)
+    {
+        return tape->nodes[node].firstChild;
+    }
+
+    SdlangTapeIndex sdlangTapeNextSibling(const SdlangTape *tape, SdlangTapeIndex node)
+    {
+        return tape->nodes[node].nextSibling;
+    }
+
+    const SdlangValue *sdlangTapeValues(const SdlangTape *tape, SdlangTapeIndex node, size_t *count)
+    {
+        *count = tape->nodes[node].valueCount;
+        return tape->values + tape->nodes[node].firstValue;
+    }
+
+    const SdlangAttribute *sdlangTapeAttributes(const SdlangTape *tape, SdlangTapeIndex node, size_t *count)
+    {
+        *count = tape->nodes[node].attributeCount;
+        return tape->attributes + tape->nodes[node].firstAttribute;
+    }
+
+    bool sdlangTapeFromTag(SdlangTag root, SdlangTape *tape, const SdlangAllocator *allocator)
+    {
+        *tape = {};
+        tape->_allocator = *_allocatorOrDefault(allocator);
+
+        _SdlangTapeBuilder builder = {};
+        builder.allocator = &tape->_allocator;
+
+        // Walk the tree depth first without recursing. `path` holds the tag currently being visited at each level,
+        // alongside the frames that _tapeOpen keeps.
+        _SdlangBuffer path = {};
+        const SdlangTag *tag = &root;
+        bool ok = true;
+        while (ok)
+        {
+            if (tag)
+            {
+                // Entering a tag: add it along with all of its items, then move onto its first child.
+                ok = _tapeOpen(&builder, tag->nspace, tag->name);
+                size_t i;
+                for (i = 0; ok && i < (size_t)arrlen(tag->values); i++)
+                    ok = _tapeAdd(&builder, _tapeCurrent(&builder), false, &tag->values[i]);
+                for (i = 0; ok && i < (size_t)arrlen(tag->attributes); i++)
+                    ok = _tapeAdd(&builder, _tapeCurrent(&builder), true, &tag->attributes[i]);
+
+                const SdlangTag **slot =
+                    ok ? (const SdlangTag **)_bufferPush(&path, builder.allocator, sizeof(tag)) : NULL;
+                if (!slot)
+                {
+                    ok = false;
+                    break;
+                }
+                *slot = tag;
+                tag = arrlen(tag->children) ? &tag->children[0] : NULL;
+                continue;
+            }
+
+            // Leaving a tag: move onto its next sibling, if it has one.
+            const SdlangTag *done = ((const SdlangTag **)(path.data + path.length))[-1];
+            path.length -= sizeof(tag);
+            _tapeClose(&builder);
+            if (!path.length)
+                break;
+
+            const SdlangTag *parent = ((const SdlangTag **)(path.data + path.length))[-1];
+            if (done + 1 < parent->children + arrlen(parent->children))
+                tag = done + 1;
+        }
+
+        while (builder.frames.length)
+            _tapeClose(&builder);
+        _bufferFree(&path, builder.allocator);
+        _tapeFinish(&builder, tape);
+        return ok;
+    }
+
+    bool sdlangTapeToTag(const SdlangTape *tape, SdlangTapeIndex node, SdlangTag *tag,
+                         const SdlangAllocator *allocator)
+    {
+        const SdlangAllocator *scratch = _allocatorOrDefault(allocator);
+        _SdlangArrayFunc makeArray = allocator ? _allocatorArray : _heapArray;
+        const SdlangTapeIndex begin = node, end = tape->nodes[node].subtreeEnd;
+
+        // Since descendants always come after their parent, going backwards means every child is built before
+        // the tag that holds it.
+        SdlangTag *built = (SdlangTag *)scratch->alloc(scratch->context, (end - begin) * sizeof(SdlangTag));
+        if (!built)
+            return false;
+
+        _SdlangBuffer children = {};
+        SdlangTapeIndex i = end;
+        while (i-- > begin)
+        {
+            const SdlangTapeNode *from = &tape->nodes[i];
+            SdlangTag *to = &built[i - begin];
+            *to = {};
+            to->nspace = from->nspace;
+            to->name = from->name;
+
+            bool ok = true;
+            SdlangTapeIndex child;
+            children.length = 0;
+            for (child = from->firstChild; ok && child != SDLANG_TAPE_NONE; child = tape->nodes[child].nextSibling)
+            {
+                SdlangTag *slot = (SdlangTag *)_bufferPush(&children, scratch, sizeof(SdlangTag));
+                if (slot)
+                    *slot = built[child - begin];
+                ok = slot != NULL;
+            }
+
+            if (ok)
+            {
+                to->values = (SdlangValue *)makeArray((void *)allocator, tape->values + from->firstValue,
+                                                      from->valueCount, sizeof(SdlangValue));
+                to->attributes = (SdlangAttribute *)makeArray(
+                    (void *)allocator, tape->attributes + from->firstAttribute, from->attributeCount,
+                    sizeof(SdlangAttribute));
+                to->children = (SdlangTag *)makeArray((void *)allocator, children.data,
+                                                      _SDLANG_SCRATCH_COUNT(children, SdlangTag), sizeof(SdlangTag));
+                ok = (to->values || !from->valueCount) && (to->attributes || !from->attributeCount) &&
+                     (to->children || !children.length);
+            }
+
+            if (!ok)
+            {
+                // Everything built so far is a forest of finished subtrees that nothing owns yet.
+                _freeArray(to->values, allocator);
+                _freeArray(to->attributes, allocator);
+                _freeArray(to->children, allocator);
+                for (child = i + 1; child < end; child = tape->nodes[child].subtreeEnd)
+                    sdlangTagFree(built[child - begin], allocator);
+
+                _bufferFree(&children, scratch);
+                scratch->free(scratch->context, built);
+                *tag = {};
+                return false;
+            }
+        }
+
+        _bufferFree(&children, scratch);
+        *tag = built[0];
+        scratch->free(scratch->context, built);
+        return true;
+    }
+#endif
+
+    // Returns the first attribute of `tag` called `name`, which can be qualified as "namespace:name", or NULL if
+    // there isn't one. An unqualified name only matches attributes without a namespace.
+    SdlangAttribute *sdlangTagGetAttribute(SdlangTag tag, const char *name);
+
+    // Returns the first attribute of `tag` in namespace `nspace` (empty for none) called `name`, or NULL if there
+    // isn't one. Uses the tag's attribute index when it has one, and otherwise scans its attributes.
+    SdlangAttribute *sdlangTagFindAttribute(const SdlangTag *tag, SdlangCharSlice nspace, SdlangCharSlice name);
+
+    // Builds (or rebuilds) a hash index over `tag`'s attributes, making sdlangTagFindAttribute and
+    // sdlangTagGetAttribute take constant time rather than scanning. `allocator` must be the one the tree was made
+    // with, as the index is freed along with the tag by sdlangTagFree. Tags from a document should be indexed by
+    // parsing with the `indexAttributes` option instead. Returns false if out of memory.
+    //
+    // Adding attributes afterwards makes lookups fall back to scanning until the tag is indexed again, while
+    // renaming or removing them requires indexing it again.
+    bool sdlangTagIndexAttributes(SdlangTag *tag, const SdlangAllocator *allocator = NULL);
+
+    bool sdlangCharStreamFromValue(SdlangValue value, SdlangCharStream *stream);
+
+    // Returns the next piece of the stream's text with its escape sequences resolved: either a run of plain text, or
+    // what a single escape stands for. Line continuations are skipped over entirely.
+    bool sdlangCharStreamEscapeNext(SdlangCharStream *stream, SdlangCharSlice *slice);
+
+    // Returns a newly allocated copy of the stream's text with all escape sequences resolved, which must be freed
+    // with `allocator` (or free() if it's NULL).
+    SdlangCharSlice sdlangCharStreamEscapeFull(SdlangCharStream stream, const SdlangAllocator *allocator = NULL);
+
+#ifdef SDLANG_IMPLEMENTATION
+    SdlangCharSlice sdlangCharStreamEscapeFull(SdlangCharStream stream, const SdlangAllocator *allocator)
+    {
+        allocator = _allocatorOrDefault(allocator);
+        const SdlangCharSlice str = {stream.text + stream.cursor, stream.textLength - stream.cursor};
+        const size_t length = sdlangUnescapedLength(str);
+        char *buffer = (char *)allocator->alloc(allocator->context, length + 1);
+        if (!buffer)
+        {
+            SdlangCharSlice empty = {NULL, 0};
+            return empty;
+        }
+
+        sdlangUnescape(str, buffer);
+        buffer[length] = '\0';
+        SdlangCharSlice slice = {buffer, length};
+        return slice;
+    }
+
+    bool sdlangCharStreamEscapeNext(SdlangCharStream *stream, SdlangCharSlice *slice)
+    {
+        static const SdlangCharSlice _t = {"\t", 1};
+        static const SdlangCharSlice _n = {"\n", 1};
+        static const SdlangCharSlice _r = {"\r", 1};
+
+        while (!sdlangCharStreamEof(stream))
+        {
+            const char *text = stream->text, *end = text + stream->textLength;
+            if (sdlangCharStreamPeek(stream) != '\\')
+            {
+                const char *found = _findAny3(text + stream->cursor, end, '\\', '\\', '\\');
+                slice->ptr = text + stream->cursor;
+                slice->length = (size_t)(found - slice->ptr);
+                stream->cursor = (size_t)(found - text);
+                return true;
+            }
+
+            stream->cursor++;
+            if (sdlangCharStreamEof(stream))
+                return false;
+
+            switch (sdlangCharStreamEat(stream))
+            {
+            case 't':
+                *slice = _t;
+                return true;
+            case 'n':
+                *slice = _n;
+                return true;
+            case 'r':
+                *slice = _r;
+                return true;
+            case '\r':
+                if (!sdlangCharStreamEof(stream) && sdlangCharStreamPeek(stream) == '\n')
+                    stream->cursor++;
+                // fallthrough
+            case '\n':
+                stream->cursor = (size_t)(_scanSpaces(text + stream->cursor, end) - text);
+                continue;
+            default: // The escaped character itself, straight out of the text.
+                slice->ptr = text + stream->cursor - 1;
+                slice->length = 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool sdlangCharStreamFromValue(SdlangValue value, SdlangCharStream *stream)
+    {
+        if (value.type != SDLANG_VALUE_TYPE_STRING)
+            return false;
+
+        stream->text = value.stringValue.ptr;
+        stream->textLength = value.stringValue.length;
+        stream->cursor = 0;
+        return true;
+    }
+
+    SdlangAttribute *sdlangTagGetAttribute(SdlangTag tag, const char *name)
+    {
+        SdlangCharSlice nspace = {NULL, 0};
+        SdlangCharSlice local = {name, strlen(name)};
+        const char *colon = strchr(name, ':');
+        if (colon)
+        {
+            nspace.ptr = name;
+            nspace.length = (size_t)(colon - name);
+            local.ptr = colon + 1;
+            local.length -= nspace.length + 1;
+        }
+        return sdlangTagFindAttribute(&tag, nspace, local);
+    }
+
+    SdlangAttribute *sdlangTagFindAttribute(const SdlangTag *tag, SdlangCharSlice nspace, SdlangCharSlice name)
+    {
+        const size_t count = arrlen(tag->attributes);
+        const uint32_t *index = tag->_attributeIndex;
+        size_t i;
+
+        if (index && index[0] == count)
+        {
+            const size_t slots = arrlen(index) - 1;
+            size_t slot = _hashAttribute(nspace, name) & (slots - 1);
+            for (;; slot = (slot + 1) & (slots - 1))
+            {
+                const uint32_t at = index[slot + 1];
+                if (!at)
+                    return NULL;
+
+                SdlangAttribute *attrib = &tag->attributes[at - 1];
+                if (_sliceEqual(attrib->name, name) && _sliceEqual(attrib->nspace, nspace))
+                    return attrib;
+            }
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            SdlangAttribute *attrib = &tag->attributes[i];
+            if (_sliceEqual(attrib->name, name) && _sliceEqual(attrib->nspace, nspace))
+                return attrib;
+        }
+        return NULL;
+    }
+
+    bool sdlangTagIndexAttributes(SdlangTag *tag, const SdlangAllocator *allocator)
+    {
+        uint32_t *old = tag->_attributeIndex;
+        if (!tag->attributes)
+        {
+            _freeArray(old, allocator);
+            tag->_attributeIndex = NULL;
+            return true;
+        }
+        if (!_buildAttributeIndex(tag, allocator ? _allocatorArray : _heapArray, (void *)allocator))
+            return false;
+        _freeArray(old, allocator);
+        return true;
+    }
+#endif
+
+    // A compiled path query, for finding tags in a tree without hand written loops. A query is a list of steps
+    // separated by `/`, each matching the name of a tag one level below the last, where `//` matches at any depth
+    // below it instead. A step is a name (optionally namespaced, as `ns:name`) or `*` for any tag, followed by any
+    // number of predicates on the tag's attributes: `[@port]` for having one, and `[@port=80]` or `[name="x"]` (the
+    // `@` being optional) for having one with that value, written the same way as in a document. For example:
+    //
+    //     server/listen[@port]      Every `listen` tag with a `port` attribute directly inside of a top level `server`.
+    //     */route[name="x"]         Every `route` named "x" one level down.
+    //     //cache                   Every `cache` tag, at any depth.
+    //
+    // Queries are compiled once and can then be run any number of times, by any number of threads at once.
+    typedef struct _SdlangQueryPredicate
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        bool hasValue;
+        SdlangValue value;
+        SdlangCharSlice unescaped; // A string value's text with its escapes resolved, for unescaped documents.
+    } _SdlangQueryPredicate;
+
+    typedef struct _SdlangQueryStep
+    {
+        SdlangCharSlice nspace;
+        SdlangCharSlice name;
+        bool any;        // For `*`.
+        bool descendant; // For a step after `//`.
+        size_t firstPredicate;
+        size_t predicateCount;
+    } _SdlangQueryStep;
+
+    typedef struct SdlangQuery
+    {
+        _SdlangQueryStep *_steps;
+        size_t _stepCount;
+        _SdlangQueryPredicate *_predicates;
+        const SdlangAllocator *_allocator; // What the steps, predicates, and copy of the text were allocated with.
+    } SdlangQuery;
+
+    const SdlangError SDLANG_ERROR_QUERY_EXPECTED_STEP = "Expected a tag name or '*' in the query.";
+    const SdlangError SDLANG_ERROR_QUERY_EXPECTED_ATTRIBUTE = "Expected an attribute name in the query's predicate.";
+    const SdlangError SDLANG_ERROR_QUERY_EXPECTED_BRACKET = "Expected a ']' to end the query's predicate.";
+    const SdlangError SDLANG_ERROR_QUERY_TOO_MANY_STEPS = "The query has more than 64 steps.";
+
+    // Compiles `text` into `query`, which must be freed with sdlangQueryFree. On failure `errorSlice` points at where
+    // in `text` things went wrong, and there's nothing to free.
+    bool sdlangQueryCompile(const char *text, SdlangQuery *query, SdlangError *error = NULL,
+                            SdlangCharSlice *errorSlice = NULL, const SdlangAllocator *allocator = NULL);
+    void sdlangQueryFree(SdlangQuery *query);
+
+#ifndef SDLANG_QUERY_MAX_DEPTH
+#define SDLANG_QUERY_MAX_DEPTH 64
+#endif
+
+    typedef struct _SdlangQueryFrame
+    {
+        SdlangTag *children;
+        size_t count;
+        size_t next;
+        uint64_t steps; // The steps the children can match, as bits.
+    } _SdlangQueryFrame;
+
+    // Walks a tree for a query's matches, in document order, without allocating anything. The tree mustn't change
+    // while it's being walked, and in a lazy document only children that have already been parsed are seen.
+    typedef struct SdlangQueryIterator
+    {
+        const SdlangQuery *query;
+
+        // Set to SDLANG_ERROR_MAX_DEPTH_EXCEEDED if a `//` step had to look deeper than SDLANG_QUERY_MAX_DEPTH levels,
+        // in which case any matches down there were missed.
+        SdlangError error;
+
+        size_t _depth;
+        _SdlangQueryFrame _frames[SDLANG_QUERY_MAX_DEPTH];
+    } SdlangQueryIterator;
+
+    // Starts looking for matches of `query` among the descendants of `root`.
+    void sdlangQueryBegin(SdlangQueryIterator *iterator, const SdlangQuery *query, SdlangTag *root);
+
+    // Returns the next match, or NULL once there are no more.
+    SdlangTag *sdlangQueryNext(SdlangQueryIterator *iterator);
+
+    // Returns the first match of `query` among the descendants of `root`, or NULL if there isn't one.
+    SdlangTag *sdlangQueryFirst(const SdlangQuery *query, SdlangTag *root);
+
+#ifdef SDLANG_IMPLEMENTATION
+    // Parses a predicate's attribute name and value, with the cursor just past its `[`.
+    static SdlangError _compilePredicate(SdlangParser *parser, _SdlangQueryPredicate *predicate)
+    {
+        if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '@')
+            parser->stream.cursor++;
+        if (!_identifierWithNamespace(parser, &predicate->nspace, &predicate->name))
+            return SDLANG_ERROR_QUERY_EXPECTED_ATTRIBUTE;
+
+        predicate->hasValue = false;
+        if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '=')
+        {
+            // Values are read by the tokenizer itself, so they're written exactly as they would be in a document.
+            parser->stream.cursor++;
+            SdlangError error = SDLANG_ERROR_NONE;
+            SdlangCharSlice errorLine;
+            bool found = false;
+            if (!sdlangCharStreamEof(&parser->stream))
+            {
+                if (_isIdentifierChar(sdlangCharStreamPeek(&parser->stream)))
+                    found = _identifierWithNamespace(parser, &parser->front.nspace, &parser->front.name) &&
+                            _keyword(parser);
+                else
+                    found = _value(parser, &error, &errorLine);
+            }
+            if (error)
+                return error;
+            if (!found)
+                return SDLANG_ERROR_EXPECTED_VALUE;
+
+            predicate->hasValue = true;
+            predicate->value = _nextValue(&parser->front);
+        }
+
+        if (sdlangCharStreamEof(&parser->stream) || sdlangCharStreamPeek(&parser->stream) != ']')
+            return SDLANG_ERROR_QUERY_EXPECTED_BRACKET;
+        parser->stream.cursor++;
+        return SDLANG_ERROR_NONE;
+    }
+
+    // Parses the query in `parser`, counting its steps and predicates, and filling them in too if `query` has room
+    // for them, in which case `unescaped` must have room for the text of every string value in the query.
+    static SdlangError _compileQuery(SdlangParser *parser, SdlangQuery *query, size_t *predicateCount,
+                                     char *unescaped = NULL)
+    {
+        query->_stepCount = 0;
+        *predicateCount = 0;
+
+        // A leading `/` changes nothing, since steps always start from the root anyway.
+        if (parser->stream.textLength && parser->stream.text[0] == '/' &&
+            (parser->stream.textLength == 1 || parser->stream.text[1] != '/'))
+            parser->stream.cursor++;
+
+        for (;;)
+        {
+            _SdlangQueryStep step = {};
+            if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '/')
+            {
+                if (parser->stream.cursor + 1 == parser->stream.textLength ||
+                    parser->stream.text[parser->stream.cursor + 1] != '/')
+                    return SDLANG_ERROR_QUERY_EXPECTED_STEP;
+                step.descendant = true;
+                parser->stream.cursor += 2;
+            }
+
+            if (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '*')
+            {
+                step.any = true;
+                parser->stream.cursor++;
+            }
+            else if (!_identifierWithNamespace(parser, &step.nspace, &step.name))
+                return SDLANG_ERROR_QUERY_EXPECTED_STEP;
+
+            step.firstPredicate = *predicateCount;
+            while (!sdlangCharStreamEof(&parser->stream) && sdlangCharStreamPeek(&parser->stream) == '[')
+            {
+                parser->stream.cursor++;
+                _SdlangQueryPredicate predicate;
+                const SdlangError error = _compilePredicate(parser, &predicate);
+                if (error)
+                    return error;
+                if (query->_predicates)
+                {
+                    SdlangValue value = predicate.value;
+                    if (predicate.hasValue && value.type == SDLANG_VALUE_TYPE_STRING)
+                        _unescapeValue(&value, &unescaped);
+                    predicate.unescaped = value.stringValue;
+                    query->_predicates[*predicateCount] = predicate;
+                }
+                ++*predicateCount;
+            }
+            step.predicateCount = *predicateCount - step.firstPredicate;
+
+            if (query->_stepCount == 64)
+                return SDLANG_ERROR_QUERY_TOO_MANY_STEPS;
+            if (query->_steps)
+                query->_steps[query->_stepCount] = step;
+            query->_stepCount++;
+
+            if (sdlangCharStreamEof(&parser->stream))
+                return SDLANG_ERROR_NONE;
+            if (sdlangCharStreamPeek(&parser->stream) != '/')
+                return SDLANG_ERROR_UNEXPECTED_CHARACTER;
+            if (parser->stream.cursor + 1 < parser->stream.textLength &&
+                parser->stream.text[parser->stream.cursor + 1] != '/')
+                parser->stream.cursor++; // A `//` is left for the next step to see.
+        }
+    }
+
+    bool sdlangQueryCompile(const char *text, SdlangQuery *query, SdlangError *error, SdlangCharSlice *errorSlice,
+                            const SdlangAllocator *allocator)
+    {
+        SdlangError ignoredError;
+        SdlangCharSlice ignoredSlice;
+        error = error ? error : &ignoredError;
+        errorSlice = errorSlice ? errorSlice : &ignoredSlice;
+        *query = {};
+        *errorSlice = {};
+
+        // The first pass only counts, so everything fits into one allocation alongside a copy of the text for the
+        // second pass's slices to point into, and room for its string values to be unescaped (which never makes them
+        // any longer).
+        SdlangParser parser = {};
+        parser.stream.text = text;
+        parser.stream.textLength = strlen(text);
+        size_t predicateCount;
+        *error = _compileQuery(&parser, query, &predicateCount);
+        if (*error)
+        {
+            errorSlice->ptr = text + parser.stream.cursor;
+            errorSlice->length = parser.stream.cursor < parser.stream.textLength;
+            return false;
+        }
+
+        allocator = _allocatorOrDefault(allocator);
+        const size_t stepBytes = query->_stepCount * sizeof(_SdlangQueryStep);
+        const size_t predicateBytes = predicateCount * sizeof(_SdlangQueryPredicate);
+        char *memory =
+            (char *)allocator->alloc(allocator->context, stepBytes + predicateBytes + parser.stream.textLength * 2 + 1);
+        if (!memory)
+        {
+            *query = {};
+            *error = SDLANG_ERROR_OUT_OF_MEMORY;
+            return false;
+        }
+
+        // Predicates go first, since their values have the strictest alignment.
+        query->_predicates = (_SdlangQueryPredicate *)memory;
+        query->_steps = (_SdlangQueryStep *)(memory + predicateBytes);
+        query->_allocator = allocator;
+        char *copy = memory + stepBytes + predicateBytes;
+        memcpy(copy, text, parser.stream.textLength + 1);
+
+        parser = {};
+        parser.stream.text = copy;
+        parser.stream.textLength = strlen(copy);
+        *error = _compileQuery(&parser, query, &predicateCount, copy + parser.stream.textLength + 1);
+        assert(!*error);
+        return true;
+    }
+
+    void sdlangQueryFree(SdlangQuery *query)
+    {
+        if (query->_allocator)
+            query->_allocator->free(query->_allocator->context, query->_predicates);
+        *query = {};
+    }
+
+    static bool _queryValueEqual(const SdlangValue *value, const SdlangValue *wanted, SdlangCharSlice unescaped)
+    {
+        const SdlangValue v = _decoded(value);
+        if (v.type != wanted->type)
+            return false;
+
+        switch (v.type)
+        {
+        case SDLANG_VALUE_TYPE_STRING:
+            // Escapes are compared as written, unless the document's strings have been unescaped.
+            return _sliceEqual(v.stringValue, v.requiresEscape ? wanted->stringValue : unescaped);
+        case SDLANG_VALUE_TYPE_INTEGER:
+            return v.intValue == wanted->intValue;
+        case SDLANG_VALUE_TYPE_FLOATING:
+            return v.floatValue == wanted->floatValue;
+        case SDLANG_VALUE_TYPE_BOOLEAN:
+            return v.boolValue == wanted->boolValue;
+        case SDLANG_VALUE_TYPE_DATE:
+            return v.dateValue.year == wanted->dateValue.year && v.dateValue.month == wanted->dateValue.month &&
+                   v.dateValue.day == wanted->dateValue.day;
+        case SDLANG_VALUE_TYPE_DATETIME:
+            return v.dateTimeValue.date.year == wanted->dateTimeValue.date.year &&
+                   v.dateTimeValue.date.month == wanted->dateTimeValue.date.month &&
+                   v.dateTimeValue.date.day == wanted->dateTimeValue.date.day &&
+                   v.dateTimeValue.time.hours == wanted->dateTimeValue.time.hours &&
+                   v.dateTimeValue.time.minutes == wanted->dateTimeValue.time.minutes &&
+                   v.dateTimeValue.time.seconds == wanted->dateTimeValue.time.seconds &&
+                   v.dateTimeValue.time.milliseconds == wanted->dateTimeValue.time.milliseconds;
+        case SDLANG_VALUE_TYPE_TIMESPAN:
+            return v.timeSpanValue.isNegative == wanted->timeSpanValue.isNegative &&
+                   v.timeSpanValue.days == wanted->timeSpanValue.days &&
+                   v.timeSpanValue.hours == wanted->timeSpanValue.hours &&
+                   v.timeSpanValue.minutes == wanted->timeSpanValue.minutes &&
+                   v.timeSpanValue.seconds == wanted->timeSpanValue.seconds &&
+                   v.timeSpanValue.milliseconds == wanted->timeSpanValue.milliseconds;
+        default:
+            return true; // Null.
+        }
+    }
+
+    static bool _queryStepMatches(const SdlangQuery *query, const _SdlangQueryStep *step, const SdlangTag *tag)
+    {
+        if (!step->any && !(_sliceEqual(tag->name, step->name) && _sliceEqual(tag->nspace, step->nspace)))
+            return false;
+
+        size_t i;
+        for (i = 0; i < step->predicateCount; i++)
+        {
+            const _SdlangQueryPredicate *predicate = &query->_predicates[step->firstPredicate + i];
+            const SdlangAttribute *attrib = sdlangTagFindAttribute(tag, predicate->nspace, predicate->name);
+            if (!attrib ||
+                (predicate->hasValue && !_queryValueEqual(&attrib->value, &predicate->value, predicate->unescaped)))
+                return false;
+        }
+        return true;
+    }
+
+    void sdlangQueryBegin(SdlangQueryIterator *iterator, const SdlangQuery *query, SdlangTag *root)
+    {
+        iterator->query = query;
+        iterator->error = SDLANG_ERROR_NONE;
+        iterator->_depth = 0;
+        if (!query->_stepCount || !arrlen(root->children))
+            return;
+
+        _SdlangQueryFrame *frame = &iterator->_frames[iterator->_depth++];
+        frame->children = root->children;
+        frame->count = arrlen(root->children);
+        frame->next = 0;
+        frame->steps = 1;
+    }
+
+    SdlangTag *sdlangQueryNext(SdlangQueryIterator *iterator)
+    {
+        const SdlangQuery *query = iterator->query;
+
+        // Every step a tag's siblings could match is tracked at once, so each tag is looked at only once no matter
+        // how many ways a `//` could reach it.
+        while (iterator->_depth)
+        {
+            _SdlangQueryFrame *frame = &iterator->_frames[iterator->_depth - 1];
+            if (frame->next == frame->count)
+            {
+                iterator->_depth--;
+                continue;
+            }
+
+            SdlangTag *tag = &frame->children[frame->next++];
+            uint64_t childSteps = 0;
+            bool matched = false;
+            size_t i;
+            for (i = 0; i < query->_stepCount; i++)
+            {
+                const uint64_t bit = (uint64_t)1 << i;
+                if (!(frame->steps & bit))
+                    continue;
+
+                const _SdlangQueryStep *step = &query->_steps[i];
+                if (step->descendant)
+                    childSteps |= bit; // It can still match further down.
+                if (_queryStepMatches(query, step, tag))
+                {
+                    if (i + 1 == query->_stepCount)
+                        matched = true;
+                    else
+                        childSteps |= bit << 1;
+                }
+            }
+
+            if (childSteps && arrlen(tag->children))
+            {
+                if (iterator->_depth == SDLANG_QUERY_MAX_DEPTH)
+                    iterator->error = SDLANG_ERROR_MAX_DEPTH_EXCEEDED;
+                else
+                {
+                    _SdlangQueryFrame *child = &iterator->_frames[iterator->_depth++];
+                    child->children = tag->children;
+                    child->count = arrlen(tag->children);
+                    child->next = 0;
+                    child->steps = childSteps;
+                }
+            }
+            if (matched)
+                return tag;
+        }
+        return NULL;
+    }
+
+    SdlangTag *sdlangQueryFirst(const SdlangQuery *query, SdlangTag *root)
+    {
+        SdlangQueryIterator iterator;
+        sdlangQueryBegin(&iterator, query, root);
+        return sdlangQueryNext(&iterator);
+    }
+#endif
+
+    typedef const char *(*SdlangEmitterFunc)(const SdlangCharSlice slice, void *userData);
+
+    const SdlangError SDLANG_ERROR_EMIT_WRITE = "Could not write the emitted text.";
+    const SdlangError SDLANG_ERROR_EMIT_TRUNCATED = "The emitted text doesn't fit into the buffer.";
+
+    // How much output sdlangEmitBuffered collects before handing it to the emitter function.
+#ifndef SDLANG_EMIT_BLOCK_SIZE
+#define SDLANG_EMIT_BLOCK_SIZE (64 * 1024)
+#endif
+
+    // Growable memory for sdlangMemoryEmitter to append to. Start it zeroed, optionally with an allocator. `data` is
+    // kept null terminated, and must be freed with the allocator (or free() if it's NULL).
+    typedef struct SdlangEmitMemory
+    {
+        char *data;
+        size_t length;
+        size_t capacity;
+        const SdlangAllocator *allocator;
+    } SdlangEmitMemory;
+
+#define SDLANG_EMIT_NO_INDENT (-1)
+
+    // How emitted text is laid out. Zeroed options, or NULL, give the default: children indented by four spaces, a
+    // space after every name, value, and attribute, and tags ending with \n.
+    typedef struct SdlangEmitOptions
+    {
+        // Everything on one line and as small as it gets, for when only a machine will read it: tags end with `;`,
+        // nothing is indented, and the only spaces are the ones between values and attributes. The options below are
+        // ignored.
+        bool compact;
+
+        // How many `indentChar`s each level of children is indented by. 0 means 4, and SDLANG_EMIT_NO_INDENT none.
+        int indentWidth;
+        char indentChar; // 0 means a space.
+
+        // Leave out the space after the last name, value, or attribute of a tag.
+        bool trimSpaces;
+
+        bool crlf; // End tags with \r\n rather than \n.
+
+        // End tags with `;` rather than a new line, which puts everything on one line, and so leaves it unindented.
+        // The parser reads a `;` just like a new line.
+        bool semicolons;
+    } SdlangEmitOptions;
+
+    // Calls `emitter` with each fragment of the output as it's produced, many of which are a single character.
+    const char *sdlangEmit(SdlangTag tag, SdlangEmitterFunc emitter, void *userData, bool isRoot = true,
+                           int level = -1, const SdlangEmitOptions *options = NULL);
+
+    // Like sdlangEmit, but collects the output into a block of SDLANG_EMIT_BLOCK_SIZE bytes from `allocator` first,
+    // so `emitter` is only called whenever the block fills up and once more at the end.
+    const char *sdlangEmitBuffered(SdlangTag tag, SdlangEmitterFunc emitter, void *userData,
+                                   const SdlangAllocator *allocator = NULL, const SdlangEmitOptions *options = NULL);
+
+    // Works out how long the emitted text of `tag` is, not counting a null terminator, without writing it anywhere.
+    const char *sdlangEmitSize(SdlangTag tag, size_t *size, const SdlangEmitOptions *options = NULL);
+
+    // Emits `tag` into `buffer`, followed by a null terminator, without allocating anything. If it doesn't all fit
+    // then as much as does is written, still terminated, and SDLANG_ERROR_EMIT_TRUNCATED is returned. Either way
+    // `*length` is set to the full length of the text (as sdlangEmitSize gives), so a big enough buffer is one more.
+    const char *sdlangEmitToBuffer(SdlangTag tag, char *buffer, size_t capacity, size_t *length = NULL,
+                                   const SdlangEmitOptions *options = NULL);
+
+    // Emits `tag` into a newly allocated, null terminated string, which must be freed with `allocator` (or free() if
+    // it's NULL). The size is worked out first, so the string is allocated exactly once. On failure `*output` is NULL.
+    const char *sdlangEmitToString(SdlangTag tag, char **output, const SdlangAllocator *allocator = NULL,
+                                   const SdlangEmitOptions *options = NULL);
+
+    // Buffered emits to a stdio stream, or to a file descriptor with write(). Neither is flushed or closed.
+    const char *sdlangEmitToFile(SdlangTag tag, FILE *file, const SdlangAllocator *allocator = NULL,
+                                 const SdlangEmitOptions *options = NULL);
+    const char *sdlangEmitToFd(SdlangTag tag, int fd, const SdlangAllocator *allocator = NULL,
+                               const SdlangEmitOptions *options = NULL);
+
+    // Emits to a file descriptor with writev(), pointing straight at long strings in the tree rather than copying
+    // them anywhere. Everything else is gathered into a block in between, since a vector per name or space costs more
+    // than copying it. Falls back to sdlangEmitToFd where there's no writev().
+    const char *sdlangEmitToFdVectored(SdlangTag tag, int fd, const SdlangAllocator *allocator = NULL,
+                                       const SdlangEmitOptions *options = NULL);
+
+#ifndef SDLANG_PARALLEL_MIN_EMIT
+#define SDLANG_PARALLEL_MIN_EMIT (16 * 1024)
+#endif
+
+    // Emits `tag` using up to `threads` threads (0 means one per CPU), with output that's exactly the same as a
+    // serial emit's.
+    //
+    // The tree is split into pieces of about the same size, counting tags, values, and attributes, and going inside
+    // of any tag that's too large to be a single piece. Each thread gets a run of pieces with at least
+    // SDLANG_PARALLEL_MIN_EMIT of those in it (16K unless you define it yourself), which it emits into a buffer of
+    // its own that's sized exactly beforehand. The buffers are handed to `emitter` in order once they're all done,
+    // one call each, so the whole output is in memory at once. If emitting fails, `emitter` isn't called at all.
+    // `allocator` is only used by the calling thread.
+    const char *sdlangEmitParallel(SdlangTag tag, size_t threads, SdlangEmitterFunc emitter, void *userData,
+                                   const SdlangAllocator *allocator = NULL, const SdlangEmitOptions *options = NULL);
+
+    // The same, but with every thread writing its part straight into one string, as sdlangEmitToString would return.
+    const char *sdlangEmitToStringParallel(SdlangTag tag, size_t threads, char **output,
+                                           const SdlangAllocator *allocator = NULL,
+                                           const SdlangEmitOptions *options = NULL);
+
+    // Ready made emitter functions, for any of the above. Their `userData` is a FILE*, a file descriptor passed as
+    // (void *)(intptr_t)fd, or an SdlangEmitMemory* respectively.
+    const char *sdlangFileEmitter(const SdlangCharSlice slice, void *file);
+    const char *sdlangFdEmitter(const SdlangCharSlice slice, void *fd);
+    const char *sdlangMemoryEmitter(const SdlangCharSlice slice, void *memory);
+
+#ifdef SDLANG_IMPLEMENTATION
+
+// _SDLANG_EMIT_SLICE is for text owned by the tree, which lives for as long as the emit does, and so can be
+// pointed at rather than copied.
+#ifdef SDLANG_EMIT_NO_BRANCH
+#define _SDLANG_EMIT_RETURN(...) error = _emitWrite(out, __VA_ARGS__)
+#define _SDLANG_EMIT_SLICE(slice) error = _emitReference(out, slice)
+#else
+#define _SDLANG_EMIT_RETURN(...)                                                                                       \
+    if ((error = _emitWrite(out, __VA_ARGS__)))                                                                        \
+    return error
+#define _SDLANG_EMIT_SLICE(slice)                                                                                      \
+    if ((error = _emitReference(out, slice)))                                                                          \
+    return error
+#endif
+
+#ifdef _SDLANG_POSIX
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define _SDLANG_EMIT_VECTORS IOV_MAX
+#else
+#define _SDLANG_EMIT_VECTORS 1024
+#endif
+// Shorter slices than this are cheaper to copy than to give a vector of their own.
+#define _SDLANG_EMIT_REFERENCE_MIN 256
+#endif
+
+// How much indentation is kept ready to write. Anything deeper is written a run at a time.
+#define _SDLANG_EMIT_INDENT_RUN 128
+
+    // SdlangEmitOptions worked out into what gets written where.
+    typedef struct _SdlangEmitLayout
+    {
+        SdlangCharSlice newline; // What ends a tag.
+        SdlangCharSlice open;    // What opens a block of children, along with the space before it, if any.
+        bool trimSpaces;         // Spaces go between things, rather than after every one of them.
+        bool endRoot;            // Whether the root ends with a newline of its own.
+        size_t indentWidth;
+        char indent[_SDLANG_EMIT_INDENT_RUN];
+    } _SdlangEmitLayout;
+
+    static void _emitLayout(_SdlangEmitLayout *layout, const SdlangEmitOptions *options)
+    {
+        static const SdlangEmitOptions defaults = {};
+        static const SdlangCharSlice newlines[] = {{"\n", 1}, {"\r\n", 2}, {";", 1}};
+        // A brace straight after a name or value reads just fine, so only compact output leaves the space out.
+        static const SdlangCharSlice opens[] = {{"{\n", 2}, {"{\r\n", 3}, {"{;", 2},
+                                                {" {\n", 3}, {" {\r\n", 4}, {" {;", 3}};
+        if (!options)
+            options = &defaults;
+
+        const bool semicolons = options->compact || options->semicolons;
+        const bool trimSpaces = options->compact || options->trimSpaces;
+        const size_t newline = semicolons ? 2 : options->crlf ? 1 : 0;
+        layout->newline = newlines[newline];
+        layout->open = opens[newline + (trimSpaces && !options->compact ? 3 : 0)];
+        layout->trimSpaces = trimSpaces;
+        layout->endRoot = !semicolons;
+
+        layout->indentWidth = 0;
+        if (!semicolons && options->indentWidth != SDLANG_EMIT_NO_INDENT)
+            layout->indentWidth = options->indentWidth > 0 ? (size_t)options->indentWidth : 4;
+        if (layout->indentWidth)
+            memset(layout->indent, options->indentChar ? options->indentChar : ' ', _SDLANG_EMIT_INDENT_RUN);
+    }
+
+    // Where the emitter's output goes. Fragments are copied into `block`, which is handed to `emitter` whenever it
+    // fills up. Without a block every fragment goes straight to `emitter`. Without an emitter the block is the output
+    // itself, and `length` keeps counting past `capacity` once it's full. With neither, it only counts.
+    //
+    // With `vectors` the output is gathered for writev() to `fd` instead. Fragments are still copied into `block`, but
+    // long slices of the tree are given vectors of their own, in between the runs of copied ones.
+    typedef struct _SdlangEmitBuffer
+    {
+        SdlangEmitterFunc emitter;
+        void *userData;
+        char *block;
+        size_t length;
+        size_t capacity;
+        const _SdlangEmitLayout *layout;
+#ifdef _SDLANG_POSIX
+        struct iovec *vectors;
+        int vectorCount;
+        int fd;
+        size_t copied; // Where the run of copied fragments that isn't in `vectors` yet starts.
+#endif
+    } _SdlangEmitBuffer;
+
+    // An emit buffer with everything else, including the fields only vectored output uses, zeroed.
+    static _SdlangEmitBuffer _emitBuffer(SdlangEmitterFunc emitter, void *userData, char *block, size_t capacity,
+                                         const _SdlangEmitLayout *layout)
+    {
+        _SdlangEmitBuffer out = {};
+        out.emitter = emitter;
+        out.userData = userData;
+        out.block = block;
+        out.capacity = capacity;
+        out.layout = layout;
+        return out;
+    }
+
+#ifdef _SDLANG_POSIX
+    static inline void _emitVector(_SdlangEmitBuffer *out, const char *ptr, size_t length)
+    {
+        out->vectors[out->vectorCount].iov_base = (void *)ptr;
+        out->vectors[out->vectorCount].iov_len = length;
+        out->vectorCount++;
+    }
+
+    static void _emitEndRun(_SdlangEmitBuffer *out)
+    {
+        if (out->length > out->copied)
+            _emitVector(out, out->block + out->copied, out->length - out->copied);
+        out->copied = out->length;
+    }
+
+    static const char *_emitWritev(_SdlangEmitBuffer *out)
+    {
+        _emitEndRun(out);
+        struct iovec *vectors = out->vectors;
+        int count = out->vectorCount;
+        out->vectorCount = 0;
+        out->length = 0;
+        out->copied = 0;
+
+        while (count)
+        {
+            ssize_t written = writev(out->fd, vectors, count);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return SDLANG_ERROR_EMIT_WRITE;
+
+            // Skip past whatever was written, which may end part way through a slice.
+            for (; count && (size_t)written >= vectors->iov_len; vectors++, count--)
+                written -= (ssize_t)vectors->iov_len;
+            if (count)
+            {
+                vectors->iov_base = (char *)vectors->iov_base + written;
+                vectors->iov_len -= (size_t)written;
+            }
+        }
+        return NULL;
+    }
+
+    // Points a vector at `slice` itself, after one for the run of copied fragments before it. A third is always kept
+    // free for the run that follows.
+    static const char *_emitVectorReference(_SdlangEmitBuffer *out, SdlangCharSlice slice)
+    {
+        const char *error;
+        if (out->vectorCount + 3 > _SDLANG_EMIT_VECTORS && (error = _emitWritev(out)))
+            return error;
+        _emitEndRun(out);
+        _emitVector(out, slice.ptr, slice.length);
+        return NULL;
+    }
+#endif
+
+    static const char *_emitFlush(_SdlangEmitBuffer *out)
+    {
+        if (!out->length)
+            return NULL;
+        const SdlangCharSlice slice = {out->block, out->length};
+        out->length = 0;
+        return out->emitter(slice, out->userData);
+    }
+
+    static const char *_emitOverflow(_SdlangEmitBuffer *out, SdlangCharSlice slice)
+    {
+#ifdef _SDLANG_POSIX
+        if (out->vectors) // Only ever small fragments get here, since long ones are referenced.
+        {
+            const char *error = _emitWritev(out);
+            if (error)
+                return error;
+        }
+        else
+#endif
+        if (!out->emitter)
+        {
+            if (out->length < out->capacity)
+                memcpy(out->block + out->length, slice.ptr, out->capacity - out->length);
+            out->length += slice.length;
+            return NULL;
+        }
+        else
+        {
+            const char *error = _emitFlush(out);
+            if (error)
+                return error;
+            if (slice.length >= out->capacity) // Too big to be worth copying.
+                return out->emitter(slice, out->userData);
+        }
+
+        memcpy(out->block + out->length, slice.ptr, slice.length);
+        out->length += slice.length;
+        return NULL;
+    }
+
+    static inline const char *_emitWrite(_SdlangEmitBuffer *out, SdlangCharSlice slice)
+    {
+        if (out->length + slice.length > out->capacity)
+            return _emitOverflow(out, slice);
+        if (out->block && slice.length)
+            memcpy(out->block + out->length, slice.ptr, slice.length);
+        out->length += slice.length;
+        return NULL;
+    }
+
+    static inline const char *_emitReference(_SdlangEmitBuffer *out, SdlangCharSlice slice)
+    {
+#ifdef _SDLANG_POSIX
+        if (out->vectors && slice.length >= _SDLANG_EMIT_REFERENCE_MIN)
+            return _emitVectorReference(out, slice);
+#endif
+        return _emitWrite(out, slice);
+    }
+
+    // Value formatting.
+    //
+    // Every value is written into a small buffer in a single pass, and then handed to the emitter as one slice.
+    // Integers are written two digits at a time from a lookup table. Floats are written with Grisu2 (Loitsch,
+    // "Printing Floating-Point Numbers Quickly and Accurately with Integers"), whose digits always parse back to the
+    // same double. In the rare cases where Grisu2 isn't the shortest, a trailing digit is dropped for as long as the
+    // shorter number still parses back to the same double, which the parser's own conversion checks.
+
+#define _SDLANG_FORMAT_BUFFER_SIZE 96
+
+    static const char _DIGIT_PAIRS[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                       "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                       "8081828384858687888990919293949596979899";
+
+    // Writes `value` with at least `minDigits` digits, padding it with leading zeroes. Returns the length written.
+    static size_t _formatUnsigned(char *out, uint64_t value, int minDigits)
+    {
+        char digits[20];
+        char *const end = digits + sizeof(digits);
+        char *p = end;
+        while (value >= 100)
+        {
+            p -= 2;
+            memcpy(p, _DIGIT_PAIRS + (value % 100) * 2, 2);
+            value /= 100;
+        }
+        if (value >= 10)
+        {
+            p -= 2;
+            memcpy(p, _DIGIT_PAIRS + value * 2, 2);
+        }
+        else
+            *--p = (char)('0' + value);
+        while (end - p < minDigits)
+            *--p = '0';
+
+        memcpy(out, p, (size_t)(end - p));
+        return (size_t)(end - p);
+    }
+
+    static size_t _formatInteger(char *out, int64_t value)
+    {
+        if (value >= 0)
+            return _formatUnsigned(out, (uint64_t)value, 1);
+        *out = '-';
+        return 1 + _formatUnsigned(out + 1, 0 - (uint64_t)value, 1);
+    }
+
+    // A floating point number as f * 2^e, with a full 64-bit significand.
+    typedef struct _SdlangDiyFp
+    {
+        uint64_t f;
+        int e;
+    } _SdlangDiyFp;
+
+    typedef struct _SdlangCachedPower
+    {
+        uint64_t f;
+        int e;
+        int k; // The power of ten that f * 2^e approximates.
+    } _SdlangCachedPower;
+
+    // 10^k rounded to 64 bits, for every eighth k from -300 to 324.
+    static const _SdlangCachedPower _CACHED_POWERS[] = {
+        {0xAB70FE17C79AC6CAULL, -1060, -300},
+        {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+        {0xBE5691EF416BD60CULL, -1007, -284},
+        {0x8DD01FAD907FFC3CULL, -980, -276},
+        {0xD3515C2831559A83ULL, -954, -268},
+        {0x9D71AC8FADA6C9B5ULL, -927, -260},
+        {0xEA9C227723EE8BCBULL, -901, -252},
+        {0xAECC49914078536DULL, -874, -244},
+        {0x823C12795DB6CE57ULL, -847, -236},
+        {0xC21094364DFB5637ULL, -821, -228},
+        {0x9096EA6F3848984FULL, -794, -220},
+        {0xD77485CB25823AC7ULL, -768, -212},
+        {0xA086CFCD97BF97F4ULL, -741, -204},
+        {0xEF340A98172AACE5ULL, -715, -196},
+        {0xB23867FB2A35B28EULL, -688, -188},
+        {0x84C8D4DFD2C63F3BULL, -661, -180},
+        {0xC5DD44271AD3CDBAULL, -635, -172},
+        {0x936B9FCEBB25C996ULL, -608, -164},
+        {0xDBAC6C247D62A584ULL, -582, -156},
+        {0xA3AB66580D5FDAF6ULL, -555, -148},
+        {0xF3E2F893DEC3F126ULL, -529, -140},
+        {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+        {0x87625F056C7C4A8BULL, -475, -124},
+        {0xC9BCFF6034C13053ULL, -449, -116},
+        {0x964E858C91BA2655ULL, -422, -108},
+        {0xDFF9772470297EBDULL, -396, -100},
+        {0xA6DFBD9FB8E5B88FULL, -369, -92},
+        {0xF8A95FCF88747D94ULL, -343, -84},
+        {0xB94470938FA89BCFULL, -316, -76},
+        {0x8A08F0F8BF0F156BULL, -289, -68},
+        {0xCDB02555653131B6ULL, -263, -60},
+        {0x993FE2C6D07B7FACULL, -236, -52},
+        {0xE45C10C42A2B3B06ULL, -210, -44},
+        {0xAA242499697392D3ULL, -183, -36},
+        {0xFD87B5F28300CA0EULL, -157, -28},
+        {0xBCE5086492111AEBULL, -130, -20},
+        {0x8CBCCC096F5088CCULL, -103, -12},
+        {0xD1B71758E219652CULL, -77, -4},
+        {0x9C40000000000000ULL, -50, 4},
+        {0xE8D4A51000000000ULL, -24, 12},
+        {0xAD78EBC5AC620000ULL, 3, 20},
+        {0x813F3978F8940984ULL, 30, 28},
+        {0xC097CE7BC90715B3ULL, 56, 36},
+        {0x8F7E32CE7BEA5C70ULL, 83, 44},
+        {0xD5D238A4ABE98068ULL, 109, 52},
+        {0x9F4F2726179A2245ULL, 136, 60},
+        {0xED63A231D4C4FB27ULL, 162, 68},
+        {0xB0DE65388CC8ADA8ULL, 189, 76},
+        {0x83C7088E1AAB65DBULL, 216, 84},
+        {0xC45D1DF942711D9AULL, 242, 92},
+        {0x924D692CA61BE758ULL, 269, 100},
+        {0xDA01EE641A708DEAULL, 295, 108},
+        {0xA26DA3999AEF774AULL, 322, 116},
+        {0xF209787BB47D6B85ULL, 348, 124},
+        {0xB454E4A179DD1877ULL, 375, 132},
+        {0x865B86925B9BC5C2ULL, 402, 140},
+        {0xC83553C5C8965D3DULL, 428, 148},
+        {0x952AB45CFA97A0B3ULL, 455, 156},
+        {0xDE469FBD99A05FE3ULL, 481, 164},
+        {0xA59BC234DB398C25ULL, 508, 172},
+        {0xF6C69A72A3989F5CULL, 534, 180},
+        {0xB7DCBF5354E9BECEULL, 561, 188},
+        {0x88FCF317F22241E2ULL, 588, 196},
+        {0xCC20CE9BD35C78A5ULL, 614, 204},
+        {0x98165AF37B2153DFULL, 641, 212},
+        {0xE2A0B5DC971F303AULL, 667, 220},
+        {0xA8D9D1535CE3B396ULL, 694, 228},
+        {0xFB9B7CD9A4A7443CULL, 720, 236},
+        {0xBB764C4CA7A44410ULL, 747, 244},
+        {0x8BAB8EEFB6409C1AULL, 774, 252},
+        {0xD01FEF10A657842CULL, 800, 260},
+        {0x9B10A4E5E9913129ULL, 827, 268},
+        {0xE7109BFBA19C0C9DULL, 853, 276},
+        {0xAC2820D9623BF429ULL, 880, 284},
+        {0x80444B5E7AA7CF85ULL, 907, 292},
+        {0xBF21E44003ACDD2DULL, 933, 300},
+        {0x8E679C2F5E44FF8FULL, 960, 308},
+        {0xD433179D9C8CB841ULL, 986, 316},
+        {0x9E19DB92B4E31BA9ULL, 1013, 324},
+    };
+
+    static inline _SdlangDiyFp _diyMultiply(_SdlangDiyFp x, _SdlangDiyFp y)
+    {
+        uint64_t high;
+        const uint64_t low = _mul128(x.f, y.f, &high);
+        const _SdlangDiyFp product = {high + (low >> 63), x.e + y.e + 64}; // Rounded to the nearest.
+        return product;
+    }
+
+    static inline _SdlangDiyFp _diyNormalize(_SdlangDiyFp x)
+    {
+        const int shift = _clz64(x.f);
+        x.f <<= shift;
+        x.e -= shift;
+        return x;
+    }
+
+    // Moves the last digit closer to `w` for as long as it stays within the bounds. `distance` is how far the top
+    // bound is from `w`, `delta` is the width of the bounds, `rest` is how far the digits are below the top bound,
+    // and `ten` is the size of one step of the last digit, all scaled alike.
+    static void _grisuRound(char *digits, int length, uint64_t distance, uint64_t delta, uint64_t rest, uint64_t ten)
+    {
+        while (rest < distance && delta - rest >= ten &&
+               (rest + ten < distance || distance - rest > rest + ten - distance))
+        {
+            digits[length - 1]--;
+            rest += ten;
+        }
+    }
+
+    // Writes the digits of the shortest number between `low` and `high` (which share an exponent between -60 and
+    // -32), as close to `w` as possible. The number is the digits times 10^exponent; returns how many there are.
+    static int _grisuDigits(char *digits, int *exponent, _SdlangDiyFp low, _SdlangDiyFp w, _SdlangDiyFp high)
+    {
+        uint64_t delta = high.f - low.f;
+        uint64_t distance = high.f - w.f;
+        const int shift = -high.e;
+        const uint64_t one = 1ULL << shift;
+        uint32_t integral = (uint32_t)(high.f >> shift);
+        uint64_t fraction = high.f & (one - 1);
+        int length = 0;
+
+        uint32_t power = 1;
+        int powerDigits = 1;
+        while (power <= integral / 10)
+        {
+            power *= 10;
+            powerDigits++;
+        }
+
+        while (powerDigits > 0)
+        {
+            digits[length++] = (char)('0' + integral / power);
+            integral %= power;
+            powerDigits--;
+
+            const uint64_t rest = ((uint64_t)integral << shift) + fraction;
+            if (rest <= delta)
+            {
+                *exponent += powerDigits;
+                _grisuRound(digits, length, distance, delta, rest, (uint64_t)power << shift);
+                return length;
+            }
+            power /= 10;
+        }
+
+        for (;;)
+        {
+            fraction *= 10;
+            digits[length++] = (char)('0' + (fraction >> shift));
+            fraction &= one - 1;
+            delta *= 10;
+            distance *= 10;
+            (*exponent)--;
+            if (fraction <= delta)
+                break;
+        }
+        _grisuRound(digits, length, distance, delta, fraction, one);
+        return length;
+    }
+
+    // Finds the shortest digits that parse back to `value`, which must be positive and finite. The number is
+    // `*mantissa` times 10^`*exponent`.
+    static void _shortestDecimal(double value, uint64_t *mantissa, int *exponent)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        const uint64_t fraction = bits & ((1ULL << 52) - 1);
+        const int biased = (int)(bits >> 52);
+
+        // The value, and the bounds half way to the doubles either side of it. The one below is closer when the
+        // value is the first of its binade.
+        _SdlangDiyFp v = {fraction, 1 - 1075};
+        if (biased)
+        {
+            v.f |= 1ULL << 52;
+            v.e = biased - 1075;
+        }
+        _SdlangDiyFp low = {2 * v.f - 1, v.e - 1};
+        if (!fraction && biased > 1)
+        {
+            low.f = 4 * v.f - 1;
+            low.e = v.e - 2;
+        }
+        _SdlangDiyFp high = _diyNormalize({2 * v.f + 1, v.e - 1});
+        low.f <<= low.e - high.e;
+        low.e = high.e;
+        v = _diyNormalize(v);
+
+        // Scale them all by a cached power of ten that brings the exponent into [-60, -32], narrowing the bounds by
+        // the most the scaling could be off by.
+        const int target = -60 - high.e - 1;
+        const int k = (target * 78913) / (1 << 18) + (target > 0);
+        const _SdlangCachedPower cached = _CACHED_POWERS[(300 + k + 7) / 8];
+        const _SdlangDiyFp power = {cached.f, cached.e};
+        low = _diyMultiply(low, power);
+        high = _diyMultiply(high, power);
+        low.f++;
+        high.f--;
+
+        char digits[20];
+        *exponent = -cached.k;
+        const int length = _grisuDigits(digits, exponent, low, _diyMultiply(v, power), high);
+        *mantissa = 0;
+        for (int i = 0; i < length; i++)
+            *mantissa = *mantissa * 10 + (uint64_t)(digits[i] - '0');
+
+        while (*mantissa >= 10)
+        {
+            const uint64_t shorter = *mantissa / 10;
+            const bool roundUp = *mantissa % 10 >= 5;
+            double parsed;
+            if (_decimalToDouble(roundUp ? shorter + 1 : shorter, *exponent + 1, false, false, &parsed) &&
+                parsed == value)
+                *mantissa = roundUp ? shorter + 1 : shorter;
+            else if (_decimalToDouble(roundUp ? shorter : shorter + 1, *exponent + 1, false, false, &parsed) &&
+                     parsed == value)
+                *mantissa = roundUp ? shorter : shorter + 1;
+            else
+                break;
+            (*exponent)++;
+        }
+        while (*mantissa % 10 == 0)
+        {
+            *mantissa /= 10;
+            (*exponent)++;
+        }
+    }
+
+    // Writes `value` so it always reads back as the same float: plain decimals when they're short enough, and
+    // scientific notation otherwise. Infinities are written as 1e999, which is what they parse back from. `value`
+    // mustn't be NaN, which has no way to be written.
+    static size_t _formatFloat(char *out, double value)
+    {
+        char *p = out;
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        if (bits >> 63)
+        {
+            *p++ = '-';
+            value = -value;
+        }
+        if (value == 0)
+        {
+            memcpy(p, "0.0", 3);
+            return (size_t)(p + 3 - out);
+        }
+        if ((bits & 0x7FF0000000000000ULL) == 0x7FF0000000000000ULL)
+        {
+            memcpy(p, "1e999", 5);
+            return (size_t)(p + 5 - out);
+        }
+
+        uint64_t mantissa;
+        int exponent;
+        _shortestDecimal(value, &mantissa, &exponent);
+        char digits[20];
+        const int length = (int)_formatUnsigned(digits, mantissa, 1);
+        const int point = length + exponent; // Where the decimal point goes, counting from the first digit.
+
+        if (exponent >= 0 && point <= 15) // 1500.0
+        {
+            memcpy(p, digits, (size_t)length);
+            p += length;
+            memset(p, '0', (size_t)exponent);
+            p += exponent;
+            memcpy(p, ".0", 2);
+            p += 2;
+        }
+        else if (point > 0 && point <= 15) // 1.5
+        {
+            memcpy(p, digits, (size_t)point);
+            p += point;
+            *p++ = '.';
+            memcpy(p, digits + point, (size_t)(length - point));
+            p += length - point;
+        }
+        else if (point > -4 && point <= 0) // 0.0015
+        {
+            memcpy(p, "0.", 2);
+            p += 2;
+            memset(p, '0', (size_t)-point);
+            p += -point;
+            memcpy(p, digits, (size_t)length);
+            p += length;
+        }
+        else // 1.5e-7
+        {
+            *p++ = digits[0];
+            if (length > 1)
+            {
+                *p++ = '.';
+                memcpy(p, digits + 1, (size_t)(length - 1));
+                p += length - 1;
+            }
+            *p++ = 'e';
+            p += _formatInteger(p, point - 1);
+        }
+        return (size_t)(p - out);
+    }
+
+    static size_t _formatDate(char *out, SdlangDate date)
+    {
+        size_t length = _formatInteger(out, date.year);
+        out[length++] = '/';
+        length += _formatUnsigned(out + length, (uint8_t)date.month, 2);
+        out[length++] = '/';
+        length += _formatUnsigned(out + length, (uint8_t)date.day, 2);
+        return length;
+    }
+
+    // Writes HH:MM:SS, and the fraction if there is one. The parser reads the fraction's digits as they are, so it's
+    // written as the same digits, padded to milliseconds.
+    static size_t _formatClock(char *out, SdlangTimeSpan time)
+    {
+        size_t length = _formatUnsigned(out, (uint8_t)time.hours, 2);
+        out[length++] = ':';
+        length += _formatUnsigned(out + length, (uint8_t)time.minutes, 2);
+        out[length++] = ':';
+        length += _formatUnsigned(out + length, (uint8_t)time.seconds, 2);
+        if (time.milliseconds)
+        {
+            out[length++] = '.';
+            length += _formatUnsigned(out + length, (uint64_t)time.milliseconds, 3);
+        }
+        return length;
+    }
+
+    static size_t _formatTimeSpan(char *out, SdlangTimeSpan span)
+    {
+        size_t length = 0;
+        if (span.isNegative)
+            out[length++] = '-';
+        if (span.days)
+        {
+            length += _formatUnsigned(out + length, (uint64_t)span.days, 1);
+            out[length++] = 'd';
+            out[length++] = ':';
+        }
+        return length + _formatClock(out + length, span);
+    }
+
+    static const char *_emitValue(const SdlangValue *v, _SdlangEmitBuffer *out)
+    {
+        const char *error = NULL;
+        char buffer[_SDLANG_FORMAT_BUFFER_SIZE];
+        SdlangCharSlice slice;
         slice.ptr = buffer;
-        switch (v.type)
+        if (v->type & SDLANG_VALUE_TYPE_DEFERRED) // Its text is already valid, exactly as it was written.
+            return _emitReference(out, v->deferredText);
+
+        switch (v->type)
         {
         case SDLANG_VALUE_TYPE_BOOLEAN:
-            return v.boolValue ? emitter({"true", 4}, userData) : emitter({"false", 5}, userData);
+            return v->boolValue ? _emitWrite(out, {"true", 4}) : _emitWrite(out, {"false", 5});
         case SDLANG_VALUE_TYPE_DATE:
-            slice.length = sprintf(buffer, "%d", (int)v.dateValue.year);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({"/", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateValue.month);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({"/", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateValue.day);
-            _SDLANG_EMIT_RETURN(slice);
-            return error;
+            slice.length = _formatDate(buffer, v->dateValue);
+            return _emitWrite(out, slice);
         case SDLANG_VALUE_TYPE_TIMESPAN:
-            slice.length = sprintf(buffer, "%d", (int)v.timeSpanValue.days);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({"d:", 2});
-            slice.length = sprintf(buffer, "%d", (int)v.timeSpanValue.hours);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({":", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.timeSpanValue.minutes);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({":", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.timeSpanValue.seconds);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({".", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.timeSpanValue.milliseconds);
-            _SDLANG_EMIT_RETURN(slice);
-            return error;
+            slice.length = _formatTimeSpan(buffer, v->timeSpanValue);
+            return _emitWrite(out, slice);
         case SDLANG_VALUE_TYPE_DATETIME:
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.date.year);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({"/", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.date.month);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({"/", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.date.day);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({" ", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.time.hours);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({":", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.time.minutes);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({":", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.time.seconds);
-            _SDLANG_EMIT_RETURN(slice);
-            _SDLANG_EMIT_RETURN({".", 1});
-            slice.length = sprintf(buffer, "%d", (int)v.dateTimeValue.time.milliseconds);
-            _SDLANG_EMIT_RETURN(slice);
-            return error;
+            slice.length = _formatDate(buffer, v->dateTimeValue.date);
+            buffer[slice.length++] = ' ';
+            slice.length += _formatClock(buffer + slice.length, v->dateTimeValue.time);
+            return _emitWrite(out, slice);
         case SDLANG_VALUE_TYPE_FLOATING:
-            slice.length = sprintf(buffer, "%lf", v.floatValue);
-            return emitter(slice, userData);
+            if (v->floatValue != v->floatValue)
+                return "Can't emit a NaN float.";
+            slice.length = _formatFloat(buffer, (double)v->floatValue);
+            return _emitWrite(out, slice);
         case SDLANG_VALUE_TYPE_INTEGER:
-            slice.length = sprintf(buffer, "%lld", v.intValue);
-            return emitter(slice, userData);
+            slice.length = _formatInteger(buffer, v->intValue);
+            return _emitWrite(out, slice);
         case SDLANG_VALUE_TYPE_NULL:
-            return emitter({"null", 4}, userData);
+            return _emitWrite(out, {"null", 4});
         case SDLANG_VALUE_TYPE_STRING:
             // TODO: Not WYSIWYG strings
             _SDLANG_EMIT_RETURN({"`", 1});
-            _SDLANG_EMIT_RETURN(v.stringValue);
-            return emitter({"`", 1}, userData);
+            _SDLANG_EMIT_SLICE(v->stringValue);
+            return _emitWrite(out, {"`", 1});
 
         default:
             assert(0);
@@ -1248,90 +6283,546 @@ extern "C"
         return NULL;
     }
 
-    const char *sdlangEmit(SdlangTag tag, SdlangEmitterFunc emitter, void *userData, bool isRoot, int level)
+    // Everything of a tag up to its children: the indentation, name, values, attributes, and opening brace.
+    static const char *_emitIndent(_SdlangEmitBuffer *out, int level)
     {
         const char *error = NULL;
-        size_t i;
-
-        if (level > 0)
+        size_t left = level > 0 ? (size_t)level * out->layout->indentWidth : 0;
+        while (left)
         {
-            for (i = 0; i < level; i++)
-            {
-                char buffer[5] = "    ";
-                SdlangCharSlice slice = {buffer, 4};
-                _SDLANG_EMIT_RETURN(slice);
-            }
+            const SdlangCharSlice run = {out->layout->indent,
+                                         left < _SDLANG_EMIT_INDENT_RUN ? left : _SDLANG_EMIT_INDENT_RUN};
+            _SDLANG_EMIT_RETURN(run);
+            left -= run.length;
         }
+        return error;
+    }
+
+    static const char *_emitTagStart(_SdlangEmitBuffer *out, const SdlangTag *tag, bool isRoot, int level)
+    {
+        const char *error = NULL;
+        const bool trimSpaces = out->layout->trimSpaces;
+        bool separate = !isRoot; // Whether the next value or attribute needs a space before it.
+        size_t i;
+
+        if ((error = _emitIndent(out, level)))
+            return error;
 
         if (!isRoot)
         {
-            if (!tag.name.length)
+            if (!tag->name.length)
                 return "Expected non-root tag to have a name.";
 
-            if (tag.nspace.length)
+            if (tag->nspace.length)
             {
-                _SDLANG_EMIT_RETURN(tag.nspace);
+                _SDLANG_EMIT_SLICE(tag->nspace);
                 _SDLANG_EMIT_RETURN({":", 1});
             }
-            _SDLANG_EMIT_RETURN(tag.name);
-            _SDLANG_EMIT_RETURN({" ", 1});
+            _SDLANG_EMIT_SLICE(tag->name);
+            if (!trimSpaces)
+                _SDLANG_EMIT_RETURN({" ", 1});
         }
 
-        if (tag.values)
+        if (tag->values)
         {
-            for (i = 0; i < arrlen(tag.values); i++)
+            for (i = 0; i < arrlen(tag->values); i++)
             {
-                if ((error = _emitValue(tag.values[i], emitter, userData)))
+                if (trimSpaces && separate)
+                    _SDLANG_EMIT_RETURN({" ", 1});
+                if ((error = _emitValue(&tag->values[i], out)))
                     return error;
-                _SDLANG_EMIT_RETURN({" ", 1});
+                if (!trimSpaces)
+                    _SDLANG_EMIT_RETURN({" ", 1});
+                separate = true;
             }
         }
 
-        if (tag.attributes)
+        if (tag->attributes)
         {
-            for (i = 0; i < arrlen(tag.attributes); i++)
+            for (i = 0; i < arrlen(tag->attributes); i++)
             {
-                SdlangAttribute attrib = tag.attributes[i];
+                SdlangAttribute attrib = tag->attributes[i];
 
+                if (trimSpaces && separate)
+                    _SDLANG_EMIT_RETURN({" ", 1});
                 if (attrib.nspace.length)
                 {
-                    _SDLANG_EMIT_RETURN(attrib.nspace);
+                    _SDLANG_EMIT_SLICE(attrib.nspace);
                     _SDLANG_EMIT_RETURN({":", 1});
                 }
-                _SDLANG_EMIT_RETURN(attrib.name);
+                _SDLANG_EMIT_SLICE(attrib.name);
                 _SDLANG_EMIT_RETURN({"=", 1});
-                if ((error = _emitValue(tag.attributes[i].value, emitter, userData)))
+                if ((error = _emitValue(&tag->attributes[i].value, out)))
                     return error;
-                _SDLANG_EMIT_RETURN({" ", 1});
+                if (!trimSpaces)
+                    _SDLANG_EMIT_RETURN({" ", 1});
+                separate = true;
             }
         }
 
-        if (tag.children)
+        if (tag->children && !isRoot)
+            _SDLANG_EMIT_RETURN(out->layout->open);
+        return error;
+    }
+
+    // Everything of a tag after its children.
+    static const char *_emitTagEnd(_SdlangEmitBuffer *out, const SdlangTag *tag, bool isRoot, int level)
+    {
+        const char *error = NULL;
+
+        if (tag->children && !isRoot)
         {
-            if (!isRoot)
-                _SDLANG_EMIT_RETURN({"{\n", 2});
-            for (i = 0; i < arrlen(tag.children); i++)
-            {
-                if ((error = sdlangEmit(tag.children[i], emitter, userData, false, level + 1)))
-                    return error;
-            }
-            if (!isRoot)
+            if ((error = _emitIndent(out, level)))
+                return error;
+            _SDLANG_EMIT_RETURN({"}", 1});
+        }
+
+        if (!isRoot || out->layout->endRoot)
+            _SDLANG_EMIT_RETURN(out->layout->newline);
+
+        return error;
+    }
+
+    static const char *_emitTag(_SdlangEmitBuffer *out, const SdlangTag *tag, bool isRoot, int level)
+    {
+        const char *error = _emitTagStart(out, tag, isRoot, level);
+        size_t i;
+        if (error)
+            return error;
+        for (i = 0; i < arrlen(tag->children); i++)
+        {
+            if ((error = _emitTag(out, &tag->children[i], false, level + 1)))
+                return error;
+        }
+        return _emitTagEnd(out, tag, isRoot, level);
+    }
+
+    const char *sdlangEmit(SdlangTag tag, SdlangEmitterFunc emitter, void *userData, bool isRoot, int level,
+                           const SdlangEmitOptions *options)
+    {
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        _SdlangEmitBuffer out = _emitBuffer(emitter, userData, NULL, 0, &layout);
+        return _emitTag(&out, &tag, isRoot, level);
+    }
+
+    const char *sdlangEmitBuffered(SdlangTag tag, SdlangEmitterFunc emitter, void *userData,
+                                   const SdlangAllocator *allocator, const SdlangEmitOptions *options)
+    {
+        allocator = _allocatorOrDefault(allocator);
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        _SdlangEmitBuffer out = _emitBuffer(emitter, userData, NULL, SDLANG_EMIT_BLOCK_SIZE, &layout);
+        out.block = (char *)allocator->alloc(allocator->context, SDLANG_EMIT_BLOCK_SIZE);
+        if (!out.block)
+            return SDLANG_ERROR_OUT_OF_MEMORY;
+
+        const char *error = _emitTag(&out, &tag, true, -1);
+        if (!error)
+            error = _emitFlush(&out);
+        allocator->free(allocator->context, out.block);
+        return error;
+    }
+
+    const char *sdlangEmitSize(SdlangTag tag, size_t *size, const SdlangEmitOptions *options)
+    {
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        _SdlangEmitBuffer out = _emitBuffer(NULL, NULL, NULL, SIZE_MAX, &layout);
+        const char *error = _emitTag(&out, &tag, true, -1);
+        *size = out.length;
+        return error;
+    }
+
+    const char *sdlangEmitToBuffer(SdlangTag tag, char *buffer, size_t capacity, size_t *length,
+                                   const SdlangEmitOptions *options)
+    {
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        // The last byte is kept for the terminator.
+        _SdlangEmitBuffer out = _emitBuffer(NULL, NULL, buffer, capacity ? capacity - 1 : 0, &layout);
+        const char *error = _emitTag(&out, &tag, true, -1);
+        if (capacity)
+            buffer[out.length < out.capacity ? out.length : out.capacity] = '\0';
+        if (length)
+            *length = out.length;
+        return error ? error : (out.length >= capacity ? SDLANG_ERROR_EMIT_TRUNCATED : NULL);
+    }
+
+    const char *sdlangEmitToString(SdlangTag tag, char **output, const SdlangAllocator *allocator,
+                                   const SdlangEmitOptions *options)
+    {
+        *output = NULL;
+        size_t size;
+        const char *error = sdlangEmitSize(tag, &size, options);
+        if (error)
+            return error;
+
+        allocator = _allocatorOrDefault(allocator);
+        char *buffer = (char *)allocator->alloc(allocator->context, size + 1);
+        if (!buffer)
+            return SDLANG_ERROR_OUT_OF_MEMORY;
+        if ((error = sdlangEmitToBuffer(tag, buffer, size + 1, NULL, options)))
+        {
+            allocator->free(allocator->context, buffer);
+            return error;
+        }
+        *output = buffer;
+        return NULL;
+    }
+
+    const char *sdlangEmitToFile(SdlangTag tag, FILE *file, const SdlangAllocator *allocator,
+                                 const SdlangEmitOptions *options)
+    {
+        return sdlangEmitBuffered(tag, sdlangFileEmitter, file, allocator, options);
+    }
+
+    const char *sdlangEmitToFd(SdlangTag tag, int fd, const SdlangAllocator *allocator,
+                               const SdlangEmitOptions *options)
+    {
+        return sdlangEmitBuffered(tag, sdlangFdEmitter, (void *)(intptr_t)fd, allocator, options);
+    }
+
+    const char *sdlangEmitToFdVectored(SdlangTag tag, int fd, const SdlangAllocator *allocator,
+                                       const SdlangEmitOptions *options)
+    {
+#ifdef _SDLANG_POSIX
+        allocator = _allocatorOrDefault(allocator);
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        _SdlangEmitBuffer out = {};
+        out.layout = &layout;
+        out.fd = fd;
+        out.vectors = (struct iovec *)allocator->alloc(
+            allocator->context, _SDLANG_EMIT_VECTORS * sizeof(struct iovec) + SDLANG_EMIT_BLOCK_SIZE);
+        if (!out.vectors)
+            return SDLANG_ERROR_OUT_OF_MEMORY;
+        out.block = (char *)(out.vectors + _SDLANG_EMIT_VECTORS);
+        out.capacity = SDLANG_EMIT_BLOCK_SIZE;
+
+        const char *error = _emitTag(&out, &tag, true, -1);
+        if (!error)
+            error = _emitWritev(&out);
+        allocator->free(allocator->context, out.vectors);
+        return error;
+#else
+        return sdlangEmitToFd(tag, fd, allocator, options);
+#endif
+    }
+
+    const char *sdlangFileEmitter(const SdlangCharSlice slice, void *file)
+    {
+        return fwrite(slice.ptr, 1, slice.length, (FILE *)file) == slice.length ? NULL : SDLANG_ERROR_EMIT_WRITE;
+    }
+
+    const char *sdlangFdEmitter(const SdlangCharSlice slice, void *fd)
+    {
+        const char *p = slice.ptr;
+        size_t left = slice.length;
+        while (left)
+        {
+#if defined(_SDLANG_POSIX)
+            const ssize_t written = write((int)(intptr_t)fd, p, left);
+            if (written < 0 && errno == EINTR)
+                continue;
+#elif defined(_WIN32)
+            const int written = _write((int)(intptr_t)fd, p, left > 0x40000000 ? 0x40000000 : (unsigned)left);
+#else
+            const int written = -1;
+#endif
+            if (written <= 0)
+                return SDLANG_ERROR_EMIT_WRITE;
+            p += written;
+            left -= (size_t)written;
+        }
+        return NULL;
+    }
+
+    const char *sdlangMemoryEmitter(const SdlangCharSlice slice, void *memory)
+    {
+        SdlangEmitMemory *info = (SdlangEmitMemory *)memory;
+        if (info->length + slice.length >= info->capacity)
+        {
+            size_t capacity = info->capacity ? info->capacity * 2 : 128;
+            while (info->length + slice.length >= capacity)
+                capacity *= 2;
+
+            const SdlangAllocator *allocator = _allocatorOrDefault(info->allocator);
+            char *grown = (char *)allocator->realloc(allocator->context, info->data, capacity);
+            if (!grown)
+                return SDLANG_ERROR_OUT_OF_MEMORY;
+            info->data = grown;
+            info->capacity = capacity;
+        }
+
+        memcpy(info->data + info->length, slice.ptr, slice.length);
+        info->length += slice.length;
+        info->data[info->length] = '\0';
+        return NULL;
+    }
+
+    // A piece of the tree for a parallel emit: a whole tag, or just the start or the end of one whose children are
+    // pieces of their own.
+    enum
+    {
+        _SDLANG_PIECE_TAG,
+        _SDLANG_PIECE_START,
+        _SDLANG_PIECE_END
+    };
+
+    typedef struct _SdlangEmitPiece
+    {
+        const SdlangTag *tag;
+        int level;
+        uint8_t kind;
+        bool isRoot;
+        size_t weight;
+    } _SdlangEmitPiece;
+
+    // A run of pieces for one thread, and where its output goes.
+    typedef struct _SdlangEmitPart
+    {
+        const _SdlangEmitPiece *pieces;
+        size_t count;
+        char *output;
+        size_t size;
+        const _SdlangEmitLayout *layout;
+        const char *error;
+    } _SdlangEmitPart;
+
+    static size_t _emitWeight(const SdlangTag *tag)
+    {
+        size_t weight = 1 + arrlen(tag->values) + arrlen(tag->attributes), i;
+        for (i = 0; i < arrlen(tag->children); i++)
+            weight += _emitWeight(&tag->children[i]);
+        return weight;
+    }
+
+    // Adds the pieces for `tag` and its children to `pieces`, in a single pass over them, and sets `*weight` to theirs.
+    // A tag is split into a start, its children's pieces, and an end unless it weighs no more than `target`.
+    static bool _emitPiecesOf(_SdlangBuffer *pieces, const SdlangAllocator *allocator, const SdlangTag *tag,
+                              bool isRoot, int level, size_t target, size_t *weight)
+    {
+        const size_t at = pieces->length;
+        _SdlangEmitPiece *piece = (_SdlangEmitPiece *)_bufferPush(pieces, allocator, sizeof(_SdlangEmitPiece));
+        if (!piece)
+            return false;
+        *weight = 1 + arrlen(tag->values) + arrlen(tag->attributes);
+        *piece = {tag, level, _SDLANG_PIECE_START, isRoot, *weight};
+        size_t i;
+        for (i = 0; i < arrlen(tag->children); i++)
+        {
+            size_t childWeight;
+            if (!_emitPiecesOf(pieces, allocator, &tag->children[i], false, level + 1, target, &childWeight))
+                return false;
+            *weight += childWeight;
+        }
+
+        if ((*weight <= target && !isRoot) || !arrlen(tag->children))
+        {
+            // Small enough to emit whole, so its children's pieces aren't needed after all.
+            pieces->length = at + sizeof(_SdlangEmitPiece);
+            piece = (_SdlangEmitPiece *)(pieces->data + at);
+            piece->kind = _SDLANG_PIECE_TAG;
+            piece->weight = *weight;
+            return true;
+        }
+
+        if (!(piece = (_SdlangEmitPiece *)_bufferPush(pieces, allocator, sizeof(_SdlangEmitPiece))))
+            return false;
+        *piece = {tag, level, _SDLANG_PIECE_END, isRoot, 1};
+        return true;
+    }
+
+    static const char *_emitPieces(_SdlangEmitBuffer *out, const _SdlangEmitPiece *pieces, size_t count)
+    {
+        const char *error = NULL;
+        size_t i;
+        for (i = 0; i < count && !error; i++)
+        {
+            const _SdlangEmitPiece *piece = &pieces[i];
+            if (piece->kind == _SDLANG_PIECE_START)
+                error = _emitTagStart(out, piece->tag, piece->isRoot, piece->level);
+            else if (piece->kind == _SDLANG_PIECE_END)
+                error = _emitTagEnd(out, piece->tag, piece->isRoot, piece->level);
+            else
+                error = _emitTag(out, piece->tag, piece->isRoot, piece->level);
+        }
+        return error;
+    }
+
+    static void _sizePart(void *arg)
+    {
+        _SdlangEmitPart *part = (_SdlangEmitPart *)arg;
+        _SdlangEmitBuffer out = _emitBuffer(NULL, NULL, NULL, SIZE_MAX, part->layout);
+        part->error = _emitPieces(&out, part->pieces, part->count);
+        part->size = out.length;
+    }
+
+    static void _writePart(void *arg)
+    {
+        _SdlangEmitPart *part = (_SdlangEmitPart *)arg;
+        _SdlangEmitBuffer out = _emitBuffer(NULL, NULL, part->output, part->size, part->layout);
+        part->error = _emitPieces(&out, part->pieces, part->count);
+    }
+
+    // Runs func on every part, each on a thread of its own besides the first, which runs on this one. Returns the
+    // first part's error, in document order.
+    static const char *_runParts(_SdlangEmitPart *parts, size_t count, _SdlangThread *workers, void (*func)(void *))
+    {
+        size_t i;
+        for (i = 1; i < count; i++)
+        {
+            if (!_threadStart(&workers[i], func, &parts[i]))
+                func(&parts[i]);
+        }
+        func(&parts[0]);
+        for (i = 1; i < count; i++)
+            _threadJoin(&workers[i]);
+
+        for (i = 0; i < count; i++)
+        {
+            if (parts[i].error)
+                return parts[i].error;
+        }
+        return NULL;
+    }
+
+    // Splits the tree into parts and sizes them all. Returns how many parts there are, or 0 if it's not worth
+    // splitting (or there isn't the memory to), in which case the caller emits serially. On success `*memory` holds
+    // the pieces, parts, and threads, and must be freed.
+    static size_t _emitSplit(const SdlangTag *tag, size_t threads, const SdlangAllocator *allocator,
+                             const _SdlangEmitLayout *layout, void **memory, _SdlangEmitPart **partsOut,
+                             _SdlangThread **workersOut, const char **error)
+    {
+        const size_t total = _emitWeight(tag);
+        size_t count = total / SDLANG_PARALLEL_MIN_EMIT, i;
+        if (!threads)
+            threads = _cpuCount();
+        if (count > threads)
+            count = threads;
+#ifndef _SDLANG_THREADS
+        count = 1;
+#endif
+        if (count < 2)
+            return 0;
+
+        // Several pieces to a part, so they can be shared out evenly.
+        _SdlangBuffer pieces = {};
+        size_t rootWeight;
+        if (!_emitPiecesOf(&pieces, allocator, tag, true, -1, total / (count * 8), &rootWeight))
+        {
+            _bufferFree(&pieces, allocator);
+            return 0;
+        }
+        const size_t pieceCount = _SDLANG_SCRATCH_COUNT(pieces, _SdlangEmitPiece);
+        const _SdlangEmitPiece *piece = _SDLANG_SCRATCH(pieces, _SdlangEmitPiece);
+
+        _SdlangEmitPart *parts = (_SdlangEmitPart *)allocator->alloc(
+            allocator->context, count * (sizeof(_SdlangEmitPart) + sizeof(_SdlangThread)));
+        if (!parts)
+        {
+            _bufferFree(&pieces, allocator);
+            return 0;
+        }
+
+        size_t at = 0, weight = 0;
+        for (i = 0; i < count; i++)
+        {
+            parts[i] = {};
+            parts[i].layout = layout;
+            parts[i].pieces = piece + at;
+            const size_t until = i + 1 < count ? total / count * (i + 1) : SIZE_MAX;
+            for (; at < pieceCount && weight < until; at++)
+                weight += piece[at].weight;
+            parts[i].count = (size_t)(piece + at - parts[i].pieces);
+        }
+
+        _SdlangThread *workers = (_SdlangThread *)(parts + count);
+        *error = _runParts(parts, count, workers, _sizePart);
+        *memory = pieces.data;
+        *partsOut = parts;
+        *workersOut = workers;
+        return count;
+    }
+
+    const char *sdlangEmitParallel(SdlangTag tag, size_t threads, SdlangEmitterFunc emitter, void *userData,
+                                   const SdlangAllocator *allocator, const SdlangEmitOptions *options)
+    {
+        allocator = _allocatorOrDefault(allocator);
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        void *pieces;
+        _SdlangEmitPart *parts;
+        _SdlangThread *workers;
+        const char *error = NULL;
+        const size_t count = _emitSplit(&tag, threads, allocator, &layout, &pieces, &parts, &workers, &error);
+        if (!count)
+            return sdlangEmitBuffered(tag, emitter, userData, allocator, options);
+
+        size_t i;
+        for (i = 0; i < count && !error; i++)
+        {
+            if (parts[i].size && !(parts[i].output = (char *)allocator->alloc(allocator->context, parts[i].size)))
+                error = SDLANG_ERROR_OUT_OF_MEMORY;
+        }
+        if (!error)
+            error = _runParts(parts, count, workers, _writePart);
+        for (i = 0; i < count && !error; i++)
+        {
+            const SdlangCharSlice slice = {parts[i].output, parts[i].size};
+            if (slice.length)
+                error = emitter(slice, userData);
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            if (parts[i].output)
+                allocator->free(allocator->context, parts[i].output);
+        }
+        allocator->free(allocator->context, parts);
+        allocator->free(allocator->context, pieces);
+        return error;
+    }
+
+    const char *sdlangEmitToStringParallel(SdlangTag tag, size_t threads, char **output,
+                                           const SdlangAllocator *allocator, const SdlangEmitOptions *options)
+    {
+        allocator = _allocatorOrDefault(allocator);
+        _SdlangEmitLayout layout;
+        _emitLayout(&layout, options);
+        *output = NULL;
+        void *pieces;
+        _SdlangEmitPart *parts;
+        _SdlangThread *workers;
+        const char *error = NULL;
+        const size_t count = _emitSplit(&tag, threads, allocator, &layout, &pieces, &parts, &workers, &error);
+        if (!count)
+            return sdlangEmitToString(tag, output, allocator, options);
+
+        size_t total = 0, i;
+        for (i = 0; i < count; i++)
+            total += parts[i].size;
+        char *string = error ? NULL : (char *)allocator->alloc(allocator->context, total + 1);
+        if (!error && !string)
+            error = SDLANG_ERROR_OUT_OF_MEMORY;
+
+        if (!error)
+        {
+            for (i = 0, total = 0; i < count; i++)
             {
-                if (level > 0)
-                {
-                    for (i = 0; i < level; i++)
-                    {
-                        char buffer[5] = "    ";
-                        SdlangCharSlice slice = {buffer, 4};
-                        _SDLANG_EMIT_RETURN(slice);
-                    }
-                }
-                _SDLANG_EMIT_RETURN({"}", 1});
+                parts[i].output = string + total;
+                total += parts[i].size;
             }
+            string[total] = '\0';
+            if (!(error = _runParts(parts, count, workers, _writePart)))
+                *output = string;
+            else
+                allocator->free(allocator->context, string);
         }
 
-        _SDLANG_EMIT_RETURN({"\n", 1});
-
+        allocator->free(allocator->context, parts);
+        allocator->free(allocator->context, pieces);
         return error;
     }
 
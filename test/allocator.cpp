@@ -0,0 +1,224 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <cstdlib>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+// Counts live allocations, and can be told to start failing after a number of them.
+struct CountingAllocator
+{
+	long live = 0;
+	long total = 0;
+	long failAfter = -1;
+};
+
+static void* countingAlloc(void* context, size_t size)
+{
+	CountingAllocator* counter = static_cast<CountingAllocator*>(context);
+	if (counter->failAfter >= 0 && counter->total >= counter->failAfter)
+		return NULL;
+	counter->live++;
+	counter->total++;
+	return malloc(size);
+}
+
+static void* countingRealloc(void* context, void* ptr, size_t size)
+{
+	if (!ptr)
+		return countingAlloc(context, size);
+
+	CountingAllocator* counter = static_cast<CountingAllocator*>(context);
+	if (counter->failAfter >= 0 && counter->total >= counter->failAfter)
+		return NULL;
+	counter->total++;
+	return realloc(ptr, size);
+}
+
+static void countingFree(void* context, void* ptr)
+{
+	static_cast<CountingAllocator*>(context)->live--;
+	free(ptr);
+}
+
+static SdlangAllocator makeAllocator(CountingAllocator* counter)
+{
+	SdlangAllocator allocator = { countingAlloc, countingRealloc, countingFree, counter };
+	return allocator;
+}
+
+static const std::string CODE =
+	"server \"main\" port=8080 {\n"
+	"    listen 80 443\n"
+	"    route \"/\" handler=`index` {\n"
+	"        cache on\n"
+	"    }\n"
+	"}\n"
+	"client\n";
+
+TEST(Allocator, ParseCharStream)
+{
+	CountingAllocator counter;
+	SdlangAllocator allocator = makeAllocator(&counter);
+	SdlangParseOptions options = {};
+	options.allocator = &allocator;
+
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	SdlangTag root = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options));
+	EXPECT_GT(counter.live, 0);
+
+	ASSERT_EQ(arrlen(root.children), 2);
+	const SdlangTag server = root.children[0];
+	EXPECT_EQ(toStr(server.name), "server");
+	EXPECT_EQ(arrlen(server.values), 1);
+	EXPECT_EQ(server.attributes[0].value.intValue, 8080);
+	ASSERT_EQ(arrlen(server.children), 2);
+	EXPECT_EQ(arrlen(server.children[0].values), 2);
+	EXPECT_EQ(server.children[1].children[0].values[0].boolValue, true);
+
+	// Parsing again adds onto the existing root.
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options));
+	EXPECT_EQ(arrlen(root.children), 4);
+
+	sdlangTagFree(root, &allocator);
+	EXPECT_EQ(counter.live, 0);
+}
+
+TEST(Allocator, Document)
+{
+	CountingAllocator counter;
+	SdlangAllocator allocator = makeAllocator(&counter);
+	SdlangParseOptions options = {};
+	options.allocator = &allocator;
+
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options));
+	EXPECT_GT(counter.live, 0);
+	sdlangDocumentAllocString(&doc, "text", 4);
+	sdlangDocumentFree(&doc);
+	EXPECT_EQ(counter.live, 0);
+}
+
+TEST(Allocator, PushParser)
+{
+	CountingAllocator counter;
+	SdlangAllocator allocator = makeAllocator(&counter);
+
+	SdlangPushParser parser;
+	sdlangPushParserInit(
+		&parser, [](const SdlangToken*, void*) -> const char* { return NULL; }, NULL, &allocator);
+
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	for (size_t i = 0; i < CODE.length(); i += 5)
+		ASSERT_TRUE(sdlangPushParserFeed(&parser, CODE.c_str() + i, std::min<size_t>(5, CODE.length() - i), &error, &errorLine, &errorSlice));
+	ASSERT_TRUE(sdlangPushParserFinish(&parser, &error, &errorLine, &errorSlice));
+	EXPECT_GT(counter.total, 0);
+	sdlangPushParserFree(&parser);
+	EXPECT_EQ(counter.live, 0);
+}
+
+TEST(Allocator, EscapeAndEmit)
+{
+	CountingAllocator counter;
+	SdlangAllocator allocator = makeAllocator(&counter);
+
+	SdlangCharStream stream = { "a\\tb", 4 };
+	SdlangCharSlice escaped = sdlangCharStreamEscapeFull(stream, &allocator);
+	EXPECT_EQ(toStr(escaped), "a\tb");
+	EXPECT_EQ(counter.live, 1);
+	allocator.free(allocator.context, (void*)escaped.ptr);
+
+	SdlangTag root = {}, child = {};
+	child.name = SDLANG_CHAR_SLICE("tag");
+	arrput(root.children, child);
+
+	char* output;
+	counter.total = 0;
+	EXPECT_EQ(sdlangEmitToString(root, &output, &allocator), nullptr);
+	EXPECT_EQ(std::string(output), "tag \n\n");
+	EXPECT_EQ(counter.live, 1);
+	EXPECT_EQ(counter.total, 1); // Sized up front, so there's never a realloc.
+	allocator.free(allocator.context, output);
+	EXPECT_EQ(counter.live, 0);
+	arrfree(root.children);
+}
+
+TEST(Allocator, OutOfMemory)
+{
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	// Fail every allocation in turn, making sure nothing leaks or crashes along the way.
+	for (long failAfter = 0;; failAfter++)
+	{
+		CountingAllocator counter;
+		counter.failAfter = failAfter;
+		SdlangAllocator allocator = makeAllocator(&counter);
+		SdlangParseOptions options = {};
+		options.allocator = &allocator;
+
+		SdlangTag root = {};
+		const bool parsed = sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options);
+		if (!parsed)
+			EXPECT_STREQ(error, SDLANG_ERROR_OUT_OF_MEMORY);
+		sdlangTagFree(root, &allocator);
+		EXPECT_EQ(counter.live, 0);
+
+		SdlangDocument doc;
+		counter.total = 0;
+		if (!sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options))
+			EXPECT_STREQ(error, SDLANG_ERROR_OUT_OF_MEMORY);
+		sdlangDocumentFree(&doc);
+		EXPECT_EQ(counter.live, 0);
+
+		if (parsed)
+			break;
+	}
+}
+
+TEST(Allocator, TapeOutOfMemory)
+{
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag tree = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &tree, &error, &errorLine, &errorSlice));
+
+	for (long failAfter = 0;; failAfter++)
+	{
+		CountingAllocator counter;
+		counter.failAfter = failAfter;
+		SdlangAllocator allocator = makeAllocator(&counter);
+		SdlangParseOptions options = {};
+		options.allocator = &allocator;
+
+		SdlangTape tape;
+		const bool parsed = sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice, &options);
+		if (!parsed)
+			EXPECT_STREQ(error, SDLANG_ERROR_OUT_OF_MEMORY);
+
+		SdlangTag back = {};
+		counter.total = 0;
+		const bool converted = parsed && sdlangTapeToTag(&tape, SDLANG_TAPE_ROOT, &back, &allocator);
+		sdlangTagFree(back, &allocator);
+		sdlangTapeFree(&tape);
+
+		counter.total = 0;
+		const bool flattened = sdlangTapeFromTag(tree, &tape, &allocator);
+		sdlangTapeFree(&tape);
+		EXPECT_EQ(counter.live, 0);
+
+		if (parsed && converted && flattened)
+			break;
+	}
+	sdlangTagFree(tree);
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// from emit
+std::string emit(SdlangTag root);
+
+// Documents of very different sizes, so that the largest first ordering actually reorders them.
+static std::string document(size_t index)
+{
+	std::string code;
+	for (size_t i = 0; i < (index * 37) % 200 + 1; i++)
+		code += "tag" + std::to_string(index) + " " + std::to_string(i) + " name=\"n" + std::to_string(i) + "\" {\n    child\n}\n";
+	return code;
+}
+
+TEST(Batch, MatchesSerial)
+{
+	// Every other item is a file rather than a buffer.
+	std::vector<std::string> codes, paths;
+	std::vector<SdlangBatchItem> items(40);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		codes.push_back(document(i));
+		paths.push_back(testing::TempDir() + "sdlang_batch_" + std::to_string(i) + ".sdl");
+		if (i % 2)
+		{
+			FILE* file = fopen(paths[i].c_str(), "wb");
+			ASSERT_NE(file, nullptr);
+			fwrite(codes[i].data(), 1, codes[i].size(), file);
+			fclose(file);
+			items[i].path = paths[i].c_str();
+		}
+		else
+		{
+			items[i].path = NULL;
+			items[i].stream = { codes[i].c_str(), codes[i].length() };
+		}
+	}
+
+	for (size_t threads : { 0, 1, 3, 64 })
+	{
+		ASSERT_TRUE(sdlangParseBatch(items.data(), items.size(), threads));
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			SdlangCharStream stream = { codes[i].c_str(), codes[i].length() };
+			SdlangTag root = {};
+			SdlangError error;
+			SdlangCharSlice errorLine, errorSlice;
+			ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice));
+
+			EXPECT_TRUE(items[i].parsed);
+			EXPECT_EQ(items[i].error, SDLANG_ERROR_NONE);
+			EXPECT_EQ(emit(items[i].document.root), emit(root)) << "item " << i << " with " << threads << " threads";
+			sdlangTagFree(root);
+			sdlangDocumentFree(&items[i].document);
+		}
+	}
+
+	for (const std::string& path : paths)
+		remove(path.c_str());
+}
+
+TEST(Batch, Errors)
+{
+	const std::string good = "tag 1\n", bad = "tag 1\ntag = 2\n";
+	const std::string missing = testing::TempDir() + "sdlang_batch_i_dont_exist.sdl";
+	SdlangBatchItem items[4] = {};
+	items[0].stream = { good.c_str(), good.length() };
+	items[1].stream = { bad.c_str(), bad.length() };
+	items[2].path = missing.c_str();
+	items[3].stream = { good.c_str(), good.length() };
+
+	EXPECT_FALSE(sdlangParseBatch(items, 4, 2));
+
+	// One bad item doesn't stop the others.
+	EXPECT_TRUE(items[0].parsed);
+	EXPECT_EQ(arrlen(items[0].document.root.children), 1);
+	EXPECT_TRUE(items[3].parsed);
+
+	SdlangTag serial = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangCharStream stream = { bad.c_str(), bad.length() };
+	ASSERT_FALSE(sdlangParseCharStream(stream, &serial, &error, &errorLine, &errorSlice));
+	sdlangTagFree(serial);
+	EXPECT_FALSE(items[1].parsed);
+	EXPECT_STREQ(items[1].error, error);
+	EXPECT_EQ(items[1].errorLine.ptr, errorLine.ptr);
+
+	EXPECT_FALSE(items[2].parsed);
+	EXPECT_STREQ(items[2].error, SDLANG_ERROR_FILE_OPEN);
+
+	for (SdlangBatchItem& item : items)
+		sdlangDocumentFree(&item.document);
+}
+
+TEST(Batch, Empty)
+{
+	EXPECT_TRUE(sdlangParseBatch(NULL, 0, 0));
+
+	SdlangBatchItem item = {};
+	EXPECT_TRUE(sdlangParseBatch(&item, 1, 4));
+	EXPECT_EQ(arrlen(item.document.root.children), 0);
+	sdlangDocumentFree(&item.document);
+}
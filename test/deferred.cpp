@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static const std::string CODE = "tag 7 -9223372036854775808 0x7F 0b101 1.5 -2.5E-3 1.0D "
+                                "3.14159265358979323846264338327950288419716939937510 2021/08/30 "
+                                "2021/08/30 18:00:00.125 -365d:12:34:56.789 12:34:56 \"text\" true null "
+                                "at=2021/08/30 18:00:00 big=123456789012345678L\n";
+
+static SdlangTag parse(const std::string& code, bool deferValues)
+{
+	SdlangParseOptions options = {};
+	options.deferValues = deferValues;
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangTag root = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options));
+	return root;
+}
+
+static void expectSameValue(const SdlangValue& deferred, const SdlangValue& eager)
+{
+	ASSERT_EQ(deferred.type & ~SDLANG_VALUE_TYPE_DEFERRED, eager.type);
+	int64_t i;
+	long double f;
+	SdlangDate d;
+	SdlangDateTime dt;
+	SdlangTimeSpan t;
+	switch (eager.type)
+	{
+	case SDLANG_VALUE_TYPE_INTEGER:
+		ASSERT_TRUE(sdlangValueAsInt(&deferred, &i));
+		EXPECT_EQ(i, eager.intValue);
+		EXPECT_FALSE(sdlangValueAsFloat(&deferred, &f));
+		break;
+	case SDLANG_VALUE_TYPE_FLOATING:
+		ASSERT_TRUE(sdlangValueAsFloat(&deferred, &f));
+		EXPECT_EQ(f, eager.floatValue);
+		EXPECT_FALSE(sdlangValueAsInt(&deferred, &i));
+		break;
+	case SDLANG_VALUE_TYPE_DATE:
+		ASSERT_TRUE(sdlangValueAsDate(&deferred, &d));
+		EXPECT_EQ(d.year, eager.dateValue.year);
+		EXPECT_EQ(d.month, eager.dateValue.month);
+		EXPECT_EQ(d.day, eager.dateValue.day);
+		break;
+	case SDLANG_VALUE_TYPE_DATETIME:
+		ASSERT_TRUE(sdlangValueAsDateTime(&deferred, &dt));
+		EXPECT_EQ(dt.date.year, eager.dateTimeValue.date.year);
+		EXPECT_EQ(dt.date.day, eager.dateTimeValue.date.day);
+		EXPECT_EQ(dt.time.hours, eager.dateTimeValue.time.hours);
+		EXPECT_EQ(dt.time.seconds, eager.dateTimeValue.time.seconds);
+		EXPECT_EQ(dt.time.milliseconds, eager.dateTimeValue.time.milliseconds);
+		EXPECT_FALSE(sdlangValueAsDate(&deferred, &d));
+		break;
+	case SDLANG_VALUE_TYPE_TIMESPAN:
+		ASSERT_TRUE(sdlangValueAsTimeSpan(&deferred, &t));
+		EXPECT_EQ(t.isNegative, eager.timeSpanValue.isNegative);
+		EXPECT_EQ(t.days, eager.timeSpanValue.days);
+		EXPECT_EQ(t.hours, eager.timeSpanValue.hours);
+		EXPECT_EQ(t.minutes, eager.timeSpanValue.minutes);
+		EXPECT_EQ(t.milliseconds, eager.timeSpanValue.milliseconds);
+		break;
+	default:
+		// Nothing else is ever deferred.
+		EXPECT_EQ(deferred.type, eager.type);
+		EXPECT_FALSE(sdlangValueAsInt(&deferred, &i));
+		break;
+	}
+}
+
+TEST(Deferred, MatchesEager)
+{
+	SdlangTag deferred = parse(CODE, true), eager = parse(CODE, false);
+	ASSERT_EQ(arrlen(deferred.children), 1);
+	const SdlangTag tag = deferred.children[0], eagerTag = eager.children[0];
+	ASSERT_EQ(arrlen(tag.values), arrlen(eagerTag.values));
+	ASSERT_EQ(arrlen(tag.attributes), 2);
+
+	EXPECT_EQ(tag.values[0].type, SDLANG_VALUE_TYPE_INTEGER | SDLANG_VALUE_TYPE_DEFERRED);
+	EXPECT_EQ(toStr(tag.values[0].deferredText), "7");
+	EXPECT_EQ(toStr(tag.values[9].deferredText), "2021/08/30 18:00:00.125");
+	EXPECT_EQ(toStr(tag.attributes[0].value.deferredText), "2021/08/30 18:00:00");
+	EXPECT_EQ(toStr(tag.values[12].stringValue), "text");
+	for (ptrdiff_t i = 0; i < arrlen(tag.values); i++)
+		expectSameValue(tag.values[i], eagerTag.values[i]);
+	for (ptrdiff_t i = 0; i < arrlen(tag.attributes); i++)
+		expectSameValue(tag.attributes[i].value, eagerTag.attributes[i].value);
+
+	// Decoding in place leaves a value that can be read directly.
+	for (ptrdiff_t i = 0; i < arrlen(tag.values); i++)
+	{
+		sdlangValueDecode(&tag.values[i]);
+		EXPECT_FALSE(tag.values[i].type & SDLANG_VALUE_TYPE_DEFERRED);
+		expectSameValue(tag.values[i], eagerTag.values[i]);
+	}
+	EXPECT_EQ(tag.values[2].intValue, 0x7F);
+	EXPECT_EQ((double)tag.values[5].floatValue, -2.5e-3);
+
+	sdlangTagFree(deferred);
+	sdlangTagFree(eager);
+}
+
+TEST(Deferred, ErrorsAreStillFound)
+{
+	const std::pair<const char*, SdlangError> cases[] = {
+		{ "tag 9223372036854775808", SDLANG_ERROR_INTEGER_OVERFLOW },
+		{ "tag 2021/8/30", SDLANG_ERROR_EXPECTED_TWO_DIGITS },
+		{ "tag 1.2.3", SDLANG_ERROR_UNEXPECTED_DOT },
+		{ "tag 1d:2", SDLANG_ERROR_EXPECTED_TWO_DIGITS },
+	};
+	for (const auto& c : cases)
+	{
+		SdlangParseOptions options = {};
+		options.deferValues = true;
+		SdlangCharStream stream = { c.first, strlen(c.first) };
+		SdlangTag root = {};
+		SdlangError error;
+		SdlangCharSlice errorLine, errorSlice;
+		EXPECT_FALSE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options)) << c.first;
+		EXPECT_STREQ(error, c.second) << c.first;
+		sdlangTagFree(root);
+	}
+}
+
+TEST(Deferred, EmitsOriginalText)
+{
+	const std::string code = "tag 0x10 1.50 2021/08/30 18:00:00 -1d:02:03:04.5 n=1.0D\n";
+	SdlangTag root = parse(code, true);
+	char* output;
+	ASSERT_EQ(sdlangEmitToString(root, &output), nullptr);
+	EXPECT_EQ(std::string(output), "tag 0x10 1.50 2021/08/30 18:00:00 -1d:02:03:04.5 n=1.0D \n\n");
+	free(output);
+	sdlangTagFree(root);
+}
+
+TEST(Deferred, LazyChildren)
+{
+	// Children parsed later by sdlangTagChildren are deferred just like the tags parsed up front.
+	const std::string code = "parent 1.5 {\n    child 2.5 at=2021/08/30\n}\n";
+	SdlangParseOptions options = {};
+	options.deferValues = true;
+	options.lazy = true;
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options));
+
+	SdlangTag* parent = &doc.root.children[0];
+	EXPECT_EQ(parent->values[0].type, SDLANG_VALUE_TYPE_FLOATING | SDLANG_VALUE_TYPE_DEFERRED);
+	SdlangTag* children = sdlangTagChildren(&doc, parent, &error);
+	ASSERT_NE(children, nullptr) << error;
+	EXPECT_EQ(children[0].values[0].type, SDLANG_VALUE_TYPE_FLOATING | SDLANG_VALUE_TYPE_DEFERRED);
+	EXPECT_EQ(children[0].attributes[0].value.type, SDLANG_VALUE_TYPE_DATE | SDLANG_VALUE_TYPE_DEFERRED);
+
+	long double f;
+	ASSERT_TRUE(sdlangValueAsFloat(&children[0].values[0], &f));
+	EXPECT_EQ((double)f, 2.5);
+	sdlangDocumentFree(&doc);
+}
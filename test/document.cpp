@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <cstdio>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static std::string writeFile(const std::string& name, const std::string& contents)
+{
+	const std::string path = testing::TempDir() + name;
+	FILE* file = fopen(path.c_str(), "wb");
+	EXPECT_NE(file, nullptr);
+	fwrite(contents.data(), 1, contents.size(), file);
+	fclose(file);
+	return path;
+}
+
+TEST(Document, ParseFile)
+{
+	const std::string path = writeFile("sdlang_parse_file.sdl", "server \"main\" port=8080 {\n    listen 80\n}\n");
+
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseFile(path.c_str(), &doc, &error, &errorLine, &errorSlice));
+	remove(path.c_str()); // The mapping must keep working regardless.
+
+	ASSERT_EQ(arrlen(doc.root.children), 1);
+	const SdlangTag server = doc.root.children[0];
+	EXPECT_EQ(toStr(server.name), "server");
+	EXPECT_EQ(toStr(server.values[0].stringValue), "main");
+	EXPECT_EQ(server.attributes[0].value.intValue, 8080);
+	EXPECT_EQ(server.children[0].values[0].intValue, 80);
+	EXPECT_EQ(doc.text.length, 42);
+	EXPECT_GE(server.name.ptr, doc.text.ptr);
+	EXPECT_LT(server.name.ptr, doc.text.ptr + doc.text.length);
+
+	sdlangDocumentFree(&doc);
+	EXPECT_EQ(doc.root.children, nullptr);
+}
+
+TEST(Document, EmptyFile)
+{
+	const std::string path = writeFile("sdlang_empty_file.sdl", "");
+
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_TRUE(sdlangParseFile(path.c_str(), &doc, &error, &errorLine, &errorSlice));
+	EXPECT_EQ(arrlen(doc.root.children), 0);
+	EXPECT_EQ(doc.text.length, 0);
+	sdlangDocumentFree(&doc);
+	remove(path.c_str());
+}
+
+TEST(Document, MissingFile)
+{
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	const std::string path = testing::TempDir() + "sdlang_i_dont_exist.sdl";
+	EXPECT_FALSE(sdlangParseFile(path.c_str(), &doc, &error, &errorLine, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_FILE_OPEN);
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Document, ParseErrorPointsIntoFile)
+{
+	const std::string path = writeFile("sdlang_bad_file.sdl", "good 1\nbad {\n");
+
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_FALSE(sdlangParseFile(path.c_str(), &doc, &error, &errorLine, &errorSlice));
+	EXPECT_NE(error, nullptr);
+	EXPECT_GE(errorLine.ptr, doc.text.ptr);
+	EXPECT_LE(errorLine.ptr + errorLine.length, doc.text.ptr + doc.text.length);
+	EXPECT_EQ(arrlen(doc.root.children), 1); // Fully parsed tags are kept.
+	sdlangDocumentFree(&doc);
+	remove(path.c_str());
+}
+
+TEST(Document, ParseDocumentMatchesHeapTree)
+{
+	std::string code;
+	for (int i = 0; i < 2000; i++)
+		code += "tag " + std::to_string(i) + " \"v\" a=" + std::to_string(i * 2) + " {\n    child on\n    child off\n}\n";
+
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice));
+
+	SdlangTag heap = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &heap, &error, &errorLine, &errorSlice));
+
+	ASSERT_EQ(arrlen(doc.root.children), arrlen(heap.children));
+	for (int i = 0; i < arrlen(heap.children); i++)
+	{
+		const SdlangTag a = doc.root.children[i], b = heap.children[i];
+		EXPECT_EQ(toStr(a.name), toStr(b.name));
+		ASSERT_EQ(arrlen(a.values), 2);
+		EXPECT_EQ(a.values[0].intValue, b.values[0].intValue);
+		ASSERT_EQ(arrlen(a.attributes), 1);
+		EXPECT_EQ(a.attributes[0].value.intValue, b.attributes[0].value.intValue);
+		ASSERT_EQ(arrlen(a.children), 2);
+		EXPECT_EQ(a.children[1].values[0].boolValue, false);
+		EXPECT_EQ(arrcap(a.children), 2); // Exactly sized.
+	}
+
+	sdlangTagFree(heap);
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Document, AllocString)
+{
+	SdlangCharStream stream = { "tag", 3 };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice));
+
+	std::string name = "renamed";
+	doc.root.children[0].name = sdlangDocumentAllocString(&doc, name.c_str(), name.length());
+	name[0] = 'X';
+	EXPECT_EQ(toStr(doc.root.children[0].name), "renamed");
+	EXPECT_EQ(doc.root.children[0].name.ptr[7], '\0');
+
+	// Bigger than a block, and lots of small ones, all stay intact and aligned.
+	std::string big(SDLANG_ARENA_BLOCK_SIZE * 3, 'b');
+	SdlangCharSlice bigSlice = sdlangDocumentAllocString(&doc, big.c_str(), big.length());
+	for (int i = 0; i < 10000; i++)
+	{
+		void* ptr = sdlangDocumentAlloc(&doc, 1 + i % 40);
+		EXPECT_EQ((uintptr_t)ptr % 16, 0);
+	}
+	EXPECT_EQ(toStr(bigSlice), big);
+	EXPECT_EQ(toStr(doc.root.children[0].name), "renamed");
+
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Document, ParseDocumentError)
+{
+	const std::string code = "good 1 {\n    child\n}\nbad {\n    inner 2\n    partial {\n";
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_FALSE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice));
+	ASSERT_EQ(arrlen(doc.root.children), 1);
+	EXPECT_EQ(toStr(doc.root.children[0].name), "good");
+	EXPECT_EQ(arrlen(doc.root.children[0].children), 1);
+	sdlangDocumentFree(&doc);
+}
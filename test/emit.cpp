@@ -1,10 +1,26 @@
 #include <gtest/gtest.h>
 #include <stb_ds.h>
 #include <libsdlang.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
 #include <vector>
 
 // from parser_basic
 std::string toStr(SdlangCharSlice slice);
+// from parser_ast
+SdlangTag parse(const std::string& code);
+
+// Emits `root` as text with the default layout, which is how tests compare whole trees.
+std::string emit(SdlangTag root)
+{
+	char* output;
+	EXPECT_EQ(sdlangEmitToString(root, &output), nullptr);
+	std::string text = output ? output : "";
+	free(output);
+	return text;
+}
 
 TEST(Emit, TagWithValue)
 {
@@ -70,4 +86,546 @@ TEST(Emit, TagWithChildren)
 	sdlangEmitToString(root, &slice);
 	EXPECT_EQ(std::string(slice), "people {\n    Bradley \n    Andy \n}\n\n");
 	free(slice);
-}
\ No newline at end of file
+}
+// Emits a tag holding `value`, checks the text, and parses it back.
+static SdlangValue roundTrip(SdlangValue value, std::string* text = nullptr)
+{
+	SdlangTag root = {}, child = {};
+	child.name = SDLANG_CHAR_SLICE("value");
+	arrput(child.values, value);
+	arrput(root.children, child);
+
+	char* output;
+	EXPECT_EQ(sdlangEmitToString(root, &output), nullptr);
+	const std::string emitted(output);
+	free(output);
+	arrfree(child.values);
+	arrfree(root.children);
+
+	SdlangCharStream stream = { emitted.c_str(), emitted.length() };
+	SdlangTag parsed = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_TRUE(sdlangParseCharStream(stream, &parsed, &error, &errorLine, &errorSlice)) << emitted;
+	SdlangValue back = {};
+	if (arrlen(parsed.children) == 1 && arrlen(parsed.children[0].values) == 1)
+		back = parsed.children[0].values[0];
+	sdlangTagFree(parsed);
+
+	if (text)
+		*text = emitted.substr(6, emitted.length() - 6 - 3); // Without "value " and " \n\n".
+	return back;
+}
+
+static std::string emitFloat(double number)
+{
+	SdlangValue value = {};
+	value.type = SDLANG_VALUE_TYPE_FLOATING;
+	value.floatValue = number;
+	std::string text;
+	roundTrip(value, &text);
+	return text;
+}
+
+TEST(Emit, Floats)
+{
+	EXPECT_EQ(emitFloat(0.0), "0.0");
+	EXPECT_EQ(emitFloat(-0.0), "-0.0");
+	EXPECT_EQ(emitFloat(1.0), "1.0");
+	EXPECT_EQ(emitFloat(1500.0), "1500.0");
+	EXPECT_EQ(emitFloat(-2.5), "-2.5");
+	EXPECT_EQ(emitFloat(0.1), "0.1");
+	EXPECT_EQ(emitFloat(0.0015), "0.0015");
+	EXPECT_EQ(emitFloat(1.5e-7), "1.5e-7");
+	EXPECT_EQ(emitFloat(1e15), "1e15");
+	EXPECT_EQ(emitFloat(123456789012345.0), "123456789012345.0");
+	EXPECT_EQ(emitFloat(1e300), "1e300");
+	EXPECT_EQ(emitFloat(5e-324), "5e-324");
+	EXPECT_EQ(emitFloat(1.7976931348623157e308), "1.7976931348623157e308");
+	EXPECT_EQ(emitFloat(0.30000000000000004), "0.30000000000000004");
+	EXPECT_EQ(emitFloat(HUGE_VAL), "1e999");
+	EXPECT_EQ(emitFloat(-HUGE_VAL), "-1e999");
+
+	SdlangTag root = {}, child = {};
+	SdlangValue nan = {};
+	nan.type = SDLANG_VALUE_TYPE_FLOATING;
+	nan.floatValue = NAN;
+	child.name = SDLANG_CHAR_SLICE("value");
+	arrput(child.values, nan);
+	arrput(root.children, child);
+	char* output;
+	EXPECT_NE(sdlangEmitToString(root, &output), nullptr);
+	free(output);
+	arrfree(child.values);
+	arrfree(root.children);
+}
+
+// How many significant digits the shortest decimal that reads back as `number` has.
+static int shortestLength(double number)
+{
+	char text[40];
+	for (int precision = 1; precision < 17; precision++)
+	{
+		snprintf(text, sizeof(text), "%.*e", precision - 1, number);
+		if (strtod(text, NULL) == number)
+			return precision;
+	}
+	return 17;
+}
+
+static int significantDigits(const std::string& text)
+{
+	std::string digits;
+	for (char ch : text.substr(0, text.find('e')))
+	{
+		if (ch >= '0' && ch <= '9')
+			digits += ch;
+	}
+	digits.erase(0, digits.find_first_not_of('0'));
+	digits.erase(digits.find_last_not_of('0') + 1);
+	return (int)digits.length();
+}
+
+TEST(Emit, FloatsRoundTrip)
+{
+	std::mt19937_64 random(1234);
+	for (int i = 0; i < 100000; i++)
+	{
+		// Any finite bit pattern, and then some shorter decimals too.
+		uint64_t bits = random();
+		double number;
+		memcpy(&number, &bits, sizeof(number));
+		if (i % 2)
+			number = (double)(random() % 1000000) / 1000;
+		if (!std::isfinite(number))
+			continue;
+
+		SdlangValue value = {};
+		value.type = SDLANG_VALUE_TYPE_FLOATING;
+		value.floatValue = number;
+		std::string text;
+		const SdlangValue back = roundTrip(value, &text);
+		ASSERT_EQ(back.type, SDLANG_VALUE_TYPE_FLOATING) << text;
+		const double parsed = (double)back.floatValue;
+		ASSERT_EQ(memcmp(&parsed, &number, sizeof(number)), 0) << text;
+		ASSERT_EQ(significantDigits(text), shortestLength(number)) << text;
+	}
+}
+
+TEST(Emit, IntegersRoundTrip)
+{
+	std::mt19937_64 random(4321);
+	std::vector<int64_t> numbers = { 0, 1, -1, 9, 10, 99, 100, -100, INT64_MAX, INT64_MIN };
+	for (int i = 0; i < 10000; i++)
+		numbers.push_back((int64_t)(random() >> (random() % 64)) * (i % 2 ? -1 : 1));
+
+	for (int64_t number : numbers)
+	{
+		SdlangValue value = {};
+		value.type = SDLANG_VALUE_TYPE_INTEGER;
+		value.intValue = number;
+		std::string text;
+		const SdlangValue back = roundTrip(value, &text);
+		ASSERT_EQ(text, std::to_string(number));
+		ASSERT_EQ(back.type, SDLANG_VALUE_TYPE_INTEGER);
+		ASSERT_EQ(back.intValue, number);
+	}
+}
+
+TEST(Emit, DatesAndTimes)
+{
+	SdlangValue value = {};
+	std::string text;
+
+	value.type = SDLANG_VALUE_TYPE_DATE;
+	value.dateValue = { 2024, 3, 7 };
+	SdlangValue back = roundTrip(value, &text);
+	EXPECT_EQ(text, "2024/03/07");
+	ASSERT_EQ(back.type, SDLANG_VALUE_TYPE_DATE);
+	EXPECT_EQ(back.dateValue.year, 2024);
+	EXPECT_EQ(back.dateValue.month, 3);
+	EXPECT_EQ(back.dateValue.day, 7);
+
+	value.type = SDLANG_VALUE_TYPE_DATETIME;
+	value.dateTimeValue.date = { -44, 12, 25 };
+	value.dateTimeValue.time = {};
+	value.dateTimeValue.time.hours = 9;
+	value.dateTimeValue.time.minutes = 5;
+	value.dateTimeValue.time.seconds = 0;
+	value.dateTimeValue.time.milliseconds = 42;
+	back = roundTrip(value, &text);
+	EXPECT_EQ(text, "-44/12/25 09:05:00.042");
+	ASSERT_EQ(back.type, SDLANG_VALUE_TYPE_DATETIME);
+	EXPECT_EQ(back.dateTimeValue.date.year, -44);
+	EXPECT_EQ(back.dateTimeValue.time.hours, 9);
+	EXPECT_EQ(back.dateTimeValue.time.minutes, 5);
+	EXPECT_EQ(back.dateTimeValue.time.milliseconds, 42);
+
+	value.dateTimeValue.time.milliseconds = 0;
+	roundTrip(value, &text);
+	EXPECT_EQ(text, "-44/12/25 09:05:00");
+
+	value.type = SDLANG_VALUE_TYPE_TIMESPAN;
+	value.timeSpanValue = {};
+	value.timeSpanValue.hours = 1;
+	value.timeSpanValue.minutes = 2;
+	value.timeSpanValue.seconds = 3;
+	back = roundTrip(value, &text);
+	EXPECT_EQ(text, "01:02:03");
+	ASSERT_EQ(back.type, SDLANG_VALUE_TYPE_TIMESPAN);
+	EXPECT_EQ(back.timeSpanValue.hours, 1);
+	EXPECT_EQ(back.timeSpanValue.seconds, 3);
+
+	value.timeSpanValue.days = 12;
+	value.timeSpanValue.milliseconds = 500;
+	value.timeSpanValue.isNegative = true;
+	back = roundTrip(value, &text);
+	EXPECT_EQ(text, "-12d:01:02:03.500");
+	EXPECT_EQ(back.timeSpanValue.days, 12);
+	EXPECT_EQ(back.timeSpanValue.milliseconds, 500);
+	EXPECT_TRUE(back.timeSpanValue.isNegative);
+}
+
+// Enough tags for the output to span several blocks.
+static SdlangTag bigTree(std::string* expected)
+{
+	SdlangTag root = {};
+	SdlangValue value = {};
+	value.type = SDLANG_VALUE_TYPE_STRING;
+	value.stringValue = SDLANG_CHAR_SLICE("some text");
+	for (int i = 0; i < 20000; i++)
+	{
+		SdlangTag child = {};
+		child.name = SDLANG_CHAR_SLICE("entry");
+		arrput(child.values, value);
+		arrput(root.children, child);
+		*expected += "entry `some text` \n";
+	}
+	*expected += "\n";
+	return root;
+}
+
+static void freeTree(SdlangTag root)
+{
+	for (int i = 0; i < arrlen(root.children); i++)
+		arrfree(root.children[i].values);
+	arrfree(root.children);
+}
+
+TEST(Emit, Buffered)
+{
+	std::string expected;
+	SdlangTag root = bigTree(&expected);
+	ASSERT_GT(expected.length(), 2 * SDLANG_EMIT_BLOCK_SIZE);
+
+	struct Calls
+	{
+		std::string output;
+		size_t count = 0;
+	} calls;
+	auto append = [](const SdlangCharSlice slice, void* userData) -> const char* {
+		Calls* calls = (Calls*)userData;
+		calls->output += toStr(slice);
+		calls->count++;
+		return NULL;
+	};
+
+	EXPECT_EQ(sdlangEmitBuffered(root, append, &calls), nullptr);
+	EXPECT_EQ(calls.output, expected);
+	EXPECT_EQ(calls.count, (expected.length() + SDLANG_EMIT_BLOCK_SIZE - 1) / SDLANG_EMIT_BLOCK_SIZE);
+
+	// The same through the unbuffered path, one fragment at a time.
+	calls = Calls();
+	EXPECT_EQ(sdlangEmit(root, append, &calls), nullptr);
+	EXPECT_EQ(calls.output, expected);
+	EXPECT_GT(calls.count, arrlen(root.children) * 4);
+
+	char* output;
+	EXPECT_EQ(sdlangEmitToString(root, &output), nullptr);
+	EXPECT_EQ(std::string(output), expected);
+	free(output);
+
+	SdlangEmitMemory memory = {};
+	EXPECT_EQ(sdlangEmitBuffered(root, sdlangMemoryEmitter, &memory), nullptr);
+	EXPECT_EQ(std::string(memory.data), expected);
+	EXPECT_EQ(memory.length, expected.length());
+	free(memory.data);
+	freeTree(root);
+}
+
+TEST(Emit, FileAndFd)
+{
+	std::string expected;
+	SdlangTag root = bigTree(&expected);
+
+	FILE* file = tmpfile();
+	ASSERT_NE(file, nullptr);
+	EXPECT_EQ(sdlangEmitToFile(root, file), nullptr);
+	EXPECT_STREQ(sdlangEmitToFd(root, -1), SDLANG_ERROR_EMIT_WRITE);
+	fflush(file);
+	EXPECT_EQ(sdlangEmitToFd(root, fileno(file)), nullptr);
+
+	std::string written(2 * expected.length(), '\0');
+	rewind(file);
+	EXPECT_EQ(fread(&written[0], 1, written.length(), file), written.length());
+	EXPECT_EQ(written, expected + expected);
+	fclose(file);
+	freeTree(root);
+}
+
+TEST(Emit, SinkErrorStopsEmitting)
+{
+	std::string expected;
+	SdlangTag root = bigTree(&expected);
+
+	size_t calls = 0;
+	auto failing = [](const SdlangCharSlice, void* userData) -> const char* {
+		++*(size_t*)userData;
+		return "Disk full.";
+	};
+	EXPECT_STREQ(sdlangEmitBuffered(root, failing, &calls), "Disk full.");
+	EXPECT_EQ(calls, 1u);
+	freeTree(root);
+}
+
+TEST(Emit, FdVectored)
+{
+	// Long strings are written from where they are, so have enough of them to need several writev() calls.
+	std::string code;
+	for (int i = 0; i < 3000; i++)
+		code += "ns:server \"web\" 8080 1.5 2024/03/07 12:30:00 net:port=80 enabled=true {\n"
+		        "    route `/` null cache=off `" + std::string(300, 'a' + i % 26) + "`\n"
+		        "}\n";
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangTag root = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice)) << error << toStr(errorSlice);
+
+	char* expected;
+	ASSERT_EQ(sdlangEmitToString(root, &expected), nullptr);
+
+	FILE* file = tmpfile();
+	ASSERT_NE(file, nullptr);
+	EXPECT_EQ(sdlangEmitToFdVectored(root, fileno(file)), nullptr);
+	EXPECT_STREQ(sdlangEmitToFdVectored(root, -1), SDLANG_ERROR_EMIT_WRITE);
+
+	std::string written(strlen(expected) + 1, '\0');
+	rewind(file);
+	EXPECT_EQ(fread(&written[0], 1, written.length(), file), written.length() - 1);
+	written.pop_back();
+	EXPECT_EQ(written, std::string(expected));
+
+	fclose(file);
+	free(expected);
+	sdlangTagFree(root);
+}
+
+TEST(Emit, SizeAndBuffer)
+{
+	std::string expected;
+	SdlangTag root = bigTree(&expected);
+
+	size_t size = 0;
+	EXPECT_EQ(sdlangEmitSize(root, &size), nullptr);
+	EXPECT_EQ(size, expected.length());
+
+	std::string buffer(size + 1, 'x');
+	size_t length = 0;
+	EXPECT_EQ(sdlangEmitToBuffer(root, &buffer[0], buffer.length(), &length), nullptr);
+	EXPECT_EQ(length, size);
+	EXPECT_EQ(std::string(buffer.c_str()), expected);
+
+	// One byte short of room for the terminator.
+	buffer.assign(size, 'x');
+	EXPECT_STREQ(sdlangEmitToBuffer(root, &buffer[0], buffer.length(), &length), SDLANG_ERROR_EMIT_TRUNCATED);
+	EXPECT_EQ(length, size);
+	EXPECT_EQ(std::string(buffer.c_str()), expected.substr(0, size - 1));
+
+	char small[10];
+	EXPECT_STREQ(sdlangEmitToBuffer(root, small, sizeof(small), &length), SDLANG_ERROR_EMIT_TRUNCATED);
+	EXPECT_EQ(std::string(small), expected.substr(0, 9));
+	EXPECT_STREQ(sdlangEmitToBuffer(root, NULL, 0, &length), SDLANG_ERROR_EMIT_TRUNCATED);
+	EXPECT_EQ(length, size);
+
+	SdlangTag unnamed = {};
+	arrput(root.children, unnamed);
+	EXPECT_NE(sdlangEmitSize(root, &size), nullptr);
+	char* output;
+	EXPECT_NE(sdlangEmitToString(root, &output), nullptr);
+	EXPECT_EQ(output, nullptr);
+	freeTree(root);
+}
+
+// Checks a parallel emit against a serial one, for a range of thread counts.
+static void expectParallelMatches(const std::string& code)
+{
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangTag root = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice)) << error << toStr(errorSlice);
+
+	char* expected;
+	ASSERT_EQ(sdlangEmitToString(root, &expected), nullptr);
+	for (size_t threads : { 0, 1, 2, 3, 4, 8 })
+	{
+		char* output;
+		ASSERT_EQ(sdlangEmitToStringParallel(root, threads, &output), nullptr);
+		EXPECT_STREQ(output, expected) << threads << " threads";
+		free(output);
+
+		SdlangEmitMemory memory = {};
+		ASSERT_EQ(sdlangEmitParallel(root, threads, sdlangMemoryEmitter, &memory), nullptr);
+		EXPECT_STREQ(memory.data, expected) << threads << " threads";
+		free(memory.data);
+	}
+	free(expected);
+	sdlangTagFree(root);
+}
+
+TEST(Emit, ParallelMatchesSerial)
+{
+	std::string entries;
+	for (int i = 0; i < 20000; i++)
+		entries += "server \"web\" port=8080 {\n"
+		           "    route `/` cache=off {\n"
+		           "        header `accept`\n"
+		           "    }\n"
+		           "}\n";
+
+	// Lots of small tags at the top, then everything inside a couple of tags, which have to be split up.
+	expectParallelMatches(entries);
+	expectParallelMatches("outer 1 {\ninner {\n" + entries + "}\nlast\n}\n");
+	expectParallelMatches("small\n");
+}
+
+TEST(Emit, ParallelErrors)
+{
+	std::string expected;
+	SdlangTag root = bigTree(&expected);
+	SdlangTag unnamed = {};
+	arrins(root.children, arrlen(root.children) / 2, unnamed);
+
+	size_t size;
+	const char* serial = sdlangEmitSize(root, &size);
+	ASSERT_NE(serial, nullptr);
+	char* output;
+	EXPECT_STREQ(sdlangEmitToStringParallel(root, 4, &output), serial);
+	EXPECT_EQ(output, nullptr);
+
+	// Nothing reaches the emitter when it fails.
+	size_t calls = 0;
+	auto counting = [](const SdlangCharSlice, void* userData) -> const char* {
+		++*(size_t*)userData;
+		return NULL;
+	};
+	EXPECT_STREQ(sdlangEmitParallel(root, 4, counting, &calls), serial);
+	EXPECT_EQ(calls, 0u);
+	arrdel(root.children, arrlen(root.children) / 2);
+
+	auto failing = [](const SdlangCharSlice, void*) -> const char* { return "Disk full."; };
+	EXPECT_STREQ(sdlangEmitParallel(root, 4, failing, NULL), "Disk full.");
+	freeTree(root);
+}
+
+TEST(Emit, Options)
+{
+	const std::string code = "a 1 x=on {\nb `s` {\nc\n}\n}\nd 2 3\n";
+	SdlangTag root = parse(code);
+	const auto layout = [&](const SdlangEmitOptions& options) {
+		char* output;
+		EXPECT_EQ(sdlangEmitToString(root, &output, NULL, &options), nullptr);
+		std::string text = output;
+		free(output);
+
+		size_t size;
+		EXPECT_EQ(sdlangEmitSize(root, &size, &options), nullptr);
+		EXPECT_EQ(size, text.length());
+		return text;
+	};
+
+	SdlangEmitOptions options = {};
+	EXPECT_EQ(layout(options), "a 1 x=true {\n    b `s` {\n        c \n    }\n}\nd 2 3 \n\n");
+
+	options.trimSpaces = true;
+	EXPECT_EQ(layout(options), "a 1 x=true {\n    b `s` {\n        c\n    }\n}\nd 2 3\n\n");
+	options.indentWidth = 1;
+	options.indentChar = '\t';
+	options.crlf = true;
+	EXPECT_EQ(layout(options), "a 1 x=true {\r\n\tb `s` {\r\n\t\tc\r\n\t}\r\n}\r\nd 2 3\r\n\r\n");
+	options.indentWidth = SDLANG_EMIT_NO_INDENT;
+	options.crlf = false;
+	EXPECT_EQ(layout(options), "a 1 x=true {\nb `s` {\nc\n}\n}\nd 2 3\n\n");
+	options = {};
+	options.semicolons = true;
+	EXPECT_EQ(layout(options), "a 1 x=true {;b `s` {;c ;};};d 2 3 ;");
+	options = {};
+	options.compact = true;
+	options.indentWidth = 8; // Ignored.
+	const std::string compact = layout(options);
+	EXPECT_EQ(compact, "a 1 x=true{;b `s`{;c;};};d 2 3;");
+
+	// Compact text parses back into the same tree.
+	char *expected, *output;
+	ASSERT_EQ(sdlangEmitToString(root, &expected), nullptr);
+	SdlangTag back = parse(compact);
+	ASSERT_EQ(sdlangEmitToString(back, &output), nullptr);
+	EXPECT_STREQ(output, expected);
+	free(output);
+	free(expected);
+	sdlangTagFree(back);
+	sdlangTagFree(root);
+}
+
+TEST(Emit, OptionsDeepIndent)
+{
+	// Deeper than the run of indentation kept ready, so it's written in more than one piece.
+	std::string code, expected;
+	const int depth = 50;
+	for (int i = 0; i < depth; i++)
+	{
+		code += "a {\n";
+		expected += std::string(i * 3, ' ') + "a {\n";
+	}
+	code += "b\n";
+	expected += std::string(depth * 3, ' ') + "b\n";
+	for (int i = depth - 1; i >= 0; i--)
+	{
+		code += "}\n";
+		expected += std::string(i * 3, ' ') + "}\n";
+	}
+	expected += "\n";
+
+	SdlangTag root = parse(code);
+	SdlangEmitOptions options = {};
+	options.indentWidth = 3;
+	options.trimSpaces = true;
+	std::string calls;
+	const auto append = [](const SdlangCharSlice slice, void* userData) -> const char* {
+		*(std::string*)userData += toStr(slice);
+		return NULL;
+	};
+	EXPECT_EQ(sdlangEmit(root, append, &calls, true, -1, &options), nullptr);
+	EXPECT_EQ(calls, expected);
+	sdlangTagFree(root);
+}
+
+TEST(Emit, OptionsParallel)
+{
+	std::string code;
+	for (int i = 0; i < 20000; i++)
+		code += "server port=8080 {\n    route `/` {\n        header `accept`\n    }\n}\n";
+	SdlangTag root = parse(code);
+
+	SdlangEmitOptions options = {};
+	options.compact = true;
+	char *expected, *output;
+	ASSERT_EQ(sdlangEmitToString(root, &expected, NULL, &options), nullptr);
+	ASSERT_EQ(sdlangEmitToStringParallel(root, 4, &output, NULL, &options), nullptr);
+	EXPECT_STREQ(output, expected);
+	EXPECT_LT(strlen(output), code.length() * 3 / 4);
+	free(output);
+	free(expected);
+	sdlangTagFree(root);
+}
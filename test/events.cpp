@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+struct Recorder
+{
+	std::string log;
+	std::string skipTag;
+	bool skipChildren = false;
+	std::string stopAt;
+};
+
+static SdlangEventAction recordTagStart(SdlangCharSlice nspace, SdlangCharSlice name, void* userData)
+{
+	Recorder* r = static_cast<Recorder*>(userData);
+	r->log += "<" + (nspace.length ? toStr(nspace) + ":" : "") + toStr(name);
+	if (toStr(name) == r->stopAt)
+		return SDLANG_EVENT_STOP;
+	return toStr(name) == r->skipTag ? SDLANG_EVENT_SKIP : SDLANG_EVENT_CONTINUE;
+}
+
+static SdlangEventAction recordValue(SdlangValue value, void* userData)
+{
+	Recorder* r = static_cast<Recorder*>(userData);
+	if (value.type == SDLANG_VALUE_TYPE_INTEGER)
+		r->log += " " + std::to_string(value.intValue);
+	else if (value.type == SDLANG_VALUE_TYPE_STRING)
+		r->log += " '" + toStr(value.stringValue) + "'";
+	else
+		r->log += " ?";
+	return SDLANG_EVENT_CONTINUE;
+}
+
+static SdlangEventAction recordAttribute(SdlangCharSlice nspace, SdlangCharSlice name, SdlangValue value, void* userData)
+{
+	Recorder* r = static_cast<Recorder*>(userData);
+	r->log += " " + (nspace.length ? toStr(nspace) + ":" : "") + toStr(name) + "=";
+	if (value.type == SDLANG_VALUE_TYPE_INTEGER)
+		r->log += std::to_string(value.intValue);
+	return SDLANG_EVENT_CONTINUE;
+}
+
+static SdlangEventAction recordChildrenStart(void* userData)
+{
+	Recorder* r = static_cast<Recorder*>(userData);
+	r->log += " {";
+	return r->skipChildren ? SDLANG_EVENT_SKIP : SDLANG_EVENT_CONTINUE;
+}
+
+static SdlangEventAction recordChildrenEnd(void* userData)
+{
+	static_cast<Recorder*>(userData)->log += " }";
+	return SDLANG_EVENT_CONTINUE;
+}
+
+static SdlangEventAction recordTagEnd(void* userData)
+{
+	static_cast<Recorder*>(userData)->log += ">";
+	return SDLANG_EVENT_CONTINUE;
+}
+
+static bool record(const std::string& code, Recorder& recorder, SdlangError* error)
+{
+	SdlangEvents events = { recordTagStart, recordValue, recordAttribute, recordChildrenStart, recordChildrenEnd, recordTagEnd, &recorder };
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangCharSlice errorLine, errorSlice;
+	return sdlangParseEvents(stream, &events, error, &errorLine, &errorSlice);
+}
+
+static const std::string CODE =
+	"a 1 \"two\" x=3 {\n"
+	"    b 4 {\n"
+	"        c\n"
+	"    }\n"
+	"    ns:d y=5\n"
+	"} 6\n"
+	"e\n";
+
+TEST(Events, Order)
+{
+	Recorder recorder;
+	SdlangError error;
+	ASSERT_TRUE(record(CODE, recorder, &error));
+	EXPECT_EQ(recorder.log, "<a 1 'two' x=3 {<b 4 {<c> }><ns:d y=5> } 6><e>");
+}
+
+TEST(Events, SkipTag)
+{
+	Recorder recorder;
+	recorder.skipTag = "b";
+	SdlangError error;
+	ASSERT_TRUE(record(CODE, recorder, &error));
+	EXPECT_EQ(recorder.log, "<a 1 'two' x=3 {<b<ns:d y=5> } 6><e>");
+
+	recorder = {};
+	recorder.skipTag = "a";
+	ASSERT_TRUE(record(CODE, recorder, &error));
+	EXPECT_EQ(recorder.log, "<a<e>");
+}
+
+TEST(Events, SkipChildren)
+{
+	Recorder recorder;
+	recorder.skipChildren = true;
+	SdlangError error;
+	ASSERT_TRUE(record(CODE, recorder, &error));
+	EXPECT_EQ(recorder.log, "<a 1 'two' x=3 { } 6><e>");
+}
+
+TEST(Events, Stop)
+{
+	Recorder recorder;
+	recorder.stopAt = "c";
+	SdlangError error;
+	EXPECT_FALSE(record(CODE, recorder, &error));
+	EXPECT_STREQ(error, SDLANG_ERROR_STOPPED);
+	EXPECT_EQ(recorder.log, "<a 1 'two' x=3 {<b 4 {<c");
+}
+
+TEST(Events, NullCallbacks)
+{
+	SdlangEvents events = {};
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_TRUE(sdlangParseEvents(stream, &events, &error, &errorLine, &errorSlice));
+}
+
+TEST(Events, StructuralErrorsStillReported)
+{
+	Recorder recorder;
+	recorder.skipTag = "a";
+	SdlangError error;
+	EXPECT_FALSE(record("a {\n    b {\n    }\n", recorder, &error));
+	EXPECT_STREQ(error, SDLANG_ERROR_EXPECTED_END_BRACE);
+	EXPECT_FALSE(record("}\n", recorder, &error));
+	EXPECT_STREQ(error, SDLANG_ERROR_UNEXPECTED_CHARACTER);
+}
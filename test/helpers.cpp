@@ -63,4 +63,111 @@ TEST(Helpers, StringEscaperFull)
 	SdlangCharSlice slice = sdlangCharStreamEscapeFull(stream);
 	EXPECT_EQ(toStr(slice), "abc123\ndoe\tray");
 	free((void*)slice.ptr);
-}
\ No newline at end of file
+}
+
+TEST(Helpers, GetLine)
+{
+	const std::string code = "first\nsecond line\n";
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	EXPECT_EQ(toStr(sdlangCharStreamGetLine(&stream, 0)), "first");
+	EXPECT_EQ(toStr(sdlangCharStreamGetLine(&stream, 5)), "first"); // On the new line itself.
+	EXPECT_EQ(toStr(sdlangCharStreamGetLine(&stream, 9)), "second line");
+	EXPECT_EQ(toStr(sdlangCharStreamGetLine(&stream, code.length())), "");
+	EXPECT_EQ(toStr(sdlangCharStreamGetLine(&stream, 100)), "");
+}
+
+TEST(Helpers, GetAttributeIsExact)
+{
+	std::string code = "hello total=1 to=2 xml:to=3";
+	SdlangTag tag = parse(code);
+	SdlangAttribute* attrib = sdlangTagGetAttribute(tag.children[0], "to");
+	ASSERT_NE(attrib, nullptr);
+	EXPECT_EQ(attrib->value.intValue, 2);
+	attrib = sdlangTagGetAttribute(tag.children[0], "xml:to");
+	ASSERT_NE(attrib, nullptr);
+	EXPECT_EQ(attrib->value.intValue, 3);
+	EXPECT_EQ(sdlangTagGetAttribute(tag.children[0], "t"), nullptr);
+	EXPECT_EQ(sdlangTagGetAttribute(tag.children[0], "totals"), nullptr);
+	EXPECT_EQ(sdlangTagGetAttribute(tag.children[0], "xml:total"), nullptr);
+	sdlangTagFree(tag);
+}
+
+// Identifiers can't contain digits, so numbers get spelled out in letters instead.
+static std::string letters(int i)
+{
+	std::string name;
+	do
+		name += (char)('a' + i % 26);
+	while ((i /= 26) > 0);
+	return name;
+}
+
+TEST(Helpers, AttributeIndex)
+{
+	std::string code = "config";
+	for (int i = 0; i < 100; i++)
+		code += " key" + letters(i) + "=" + std::to_string(i) + " ns:key" + letters(i) + "=" + std::to_string(-i);
+	code += " key" + letters(7) + "=700 small=true";
+
+	SdlangParseOptions options = {};
+	options.indexAttributes = true;
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag root = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options));
+	SdlangTag* tag = &root.children[0];
+	ASSERT_NE(tag->_attributeIndex, nullptr);
+
+	const SdlangCharSlice none = {}, ns = SDLANG_CHAR_SLICE("ns");
+	for (int i = 0; i < 100; i++)
+	{
+		const std::string name = "key" + letters(i);
+		const SdlangCharSlice slice = { name.c_str(), name.size() };
+		SdlangAttribute* attrib = sdlangTagFindAttribute(tag, none, slice);
+		ASSERT_NE(attrib, nullptr);
+		EXPECT_EQ(attrib->value.intValue, i); // The first of duplicates wins, same as without an index.
+		attrib = sdlangTagFindAttribute(tag, ns, slice);
+		ASSERT_NE(attrib, nullptr);
+		EXPECT_EQ(attrib->value.intValue, -i);
+	}
+	EXPECT_EQ(sdlangTagFindAttribute(tag, none, SDLANG_CHAR_SLICE("key")), nullptr);
+	EXPECT_EQ(sdlangTagFindAttribute(tag, none, SDLANG_CHAR_SLICE("keyzz")), nullptr);
+	EXPECT_EQ(sdlangTagFindAttribute(tag, SDLANG_CHAR_SLICE("n"), SDLANG_CHAR_SLICE("skeyb")), nullptr);
+	EXPECT_NE(sdlangTagGetAttribute(*tag, "small"), nullptr);
+
+	// Attributes added afterwards are still found, until the tag is indexed again.
+	SdlangAttribute added = {};
+	added.name = SDLANG_CHAR_SLICE("added");
+	arrput(tag->attributes, added);
+	EXPECT_NE(sdlangTagFindAttribute(tag, none, SDLANG_CHAR_SLICE("added")), nullptr);
+	ASSERT_TRUE(sdlangTagIndexAttributes(tag));
+	EXPECT_EQ(tag->_attributeIndex[0], arrlen(tag->attributes));
+	EXPECT_EQ(sdlangTagFindAttribute(tag, none, SDLANG_CHAR_SLICE("added")), &tag->attributes[arrlen(tag->attributes) - 1]);
+
+	sdlangTagFree(root);
+}
+
+TEST(Helpers, AttributeIndexInDocument)
+{
+	std::string code = "outer {\n    inner";
+	for (int i = 0; i < 20; i++)
+		code += " a" + letters(i) + "=" + std::to_string(i);
+	code += "\n}\n";
+
+	SdlangParseOptions options = {};
+	options.indexAttributes = true;
+	options.lazy = true;
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options));
+	SdlangTag* inner = sdlangTagChildren(&doc, &doc.root.children[0]);
+	ASSERT_NE(inner, nullptr);
+	EXPECT_NE(inner->_attributeIndex, nullptr);
+	SdlangAttribute* attrib = sdlangTagGetAttribute(*inner, "an");
+	ASSERT_NE(attrib, nullptr);
+	EXPECT_EQ(attrib->value.intValue, 13);
+	sdlangDocumentFree(&doc);
+}
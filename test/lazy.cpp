@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+// from emit
+std::string emit(SdlangTag root);
+
+static const std::string CODE =
+	"server \"main\" port=8080 {\n"
+	"    listen 80 443\n"
+	"    route \"/{id}\" handler=`{ index\n"
+	"}` {\n"
+	"        cache on \"\\\"}\" \\\n"
+	"            size=10\n"
+	"    }\n"
+	"} after=true\n"
+	"empty {\n"
+	"}\n"
+	"client\n";
+
+// Asks for every tag's children, so the whole tree is there for the emitter.
+static void parseAll(SdlangDocument* doc, SdlangTag* tag)
+{
+	SdlangError error;
+	SdlangTag* children = sdlangTagChildren(doc, tag, &error);
+	ASSERT_EQ(error, SDLANG_ERROR_NONE);
+	for (ptrdiff_t i = 0; children && i < arrlen(children); i++)
+		parseAll(doc, &children[i]);
+}
+
+static bool parseLazily(const std::string& code, SdlangDocument* doc, SdlangError* error, SdlangCharSlice* errorLine,
+                        size_t maxDepth = 0)
+{
+	SdlangParseOptions options = {};
+	options.lazy = true;
+	options.maxDepth = maxDepth;
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangCharSlice errorSlice;
+	return sdlangParseDocument(stream, doc, error, errorLine, &errorSlice, &options);
+}
+
+TEST(Lazy, ChildrenOnlyParsedWhenAskedFor)
+{
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine;
+	ASSERT_TRUE(parseLazily(CODE, &doc, &error, &errorLine));
+
+	// Everything on the top level lines is there straight away, but none of the blocks are.
+	ASSERT_EQ(arrlen(doc.root.children), 3);
+	SdlangTag* server = &doc.root.children[0];
+	EXPECT_EQ(toStr(server->name), "server");
+	EXPECT_EQ(arrlen(server->values), 1);
+	ASSERT_EQ(arrlen(server->attributes), 2);
+	EXPECT_EQ(toStr(server->attributes[1].name), "after");
+	EXPECT_EQ(server->children, nullptr);
+	EXPECT_EQ(doc.root.children[2].children, nullptr);
+
+	SdlangTag* children = sdlangTagChildren(&doc, server, &error);
+	ASSERT_NE(children, nullptr);
+	EXPECT_EQ(sdlangTagChildren(&doc, server), children); // Only parsed the once.
+	ASSERT_EQ(arrlen(children), 2);
+	EXPECT_EQ(arrlen(children[0].values), 2);
+	EXPECT_EQ(toStr(children[1].values[0].stringValue), "/{id}");
+	EXPECT_EQ(children[1].children, nullptr);
+
+	SdlangTag* route = sdlangTagChildren(&doc, &children[1]);
+	ASSERT_EQ(arrlen(route), 1);
+	EXPECT_EQ(toStr(route[0].name), "cache");
+	EXPECT_EQ(arrlen(route[0].values), 2);
+	EXPECT_EQ(arrlen(route[0].attributes), 1);
+
+	// Empty blocks and tags without one simply have no children.
+	EXPECT_EQ(sdlangTagChildren(&doc, &doc.root.children[1], &error), nullptr);
+	EXPECT_EQ(error, SDLANG_ERROR_NONE);
+	EXPECT_EQ(sdlangTagChildren(&doc, &doc.root.children[2], &error), nullptr);
+	EXPECT_EQ(error, SDLANG_ERROR_NONE);
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Lazy, MatchesEager)
+{
+	std::string code;
+	for (int i = 0; i < 200; i++)
+		code += CODE;
+
+	SdlangDocument lazy, eager;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(parseLazily(code, &lazy, &error, &errorLine));
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	ASSERT_TRUE(sdlangParseDocument(stream, &eager, &error, &errorLine, &errorSlice));
+
+	parseAll(&lazy, &lazy.root);
+	EXPECT_EQ(emit(lazy.root), emit(eager.root));
+	sdlangDocumentFree(&lazy);
+	sdlangDocumentFree(&eager);
+}
+
+TEST(Lazy, CompactText)
+{
+	// Blocks closed after a ';' rather than on a line of their own are still skipped.
+	SdlangDocument eager, lazy;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangCharStream stream = { CODE.c_str(), CODE.length() };
+	ASSERT_TRUE(sdlangParseDocument(stream, &eager, &error, &errorLine, &errorSlice));
+	SdlangEmitOptions options = {};
+	options.compact = true;
+	char* output;
+	ASSERT_EQ(sdlangEmitToString(eager.root, &output, NULL, &options), nullptr);
+	const std::string compact = output;
+	free(output);
+
+	ASSERT_TRUE(parseLazily(compact, &lazy, &error, &errorLine));
+	ASSERT_EQ(arrlen(lazy.root.children), 3);
+	SdlangTag* server = &lazy.root.children[0];
+	EXPECT_EQ(server->children, nullptr);
+	EXPECT_NE(server->_unparsedChildren.ptr, nullptr);
+
+	parseAll(&lazy, &lazy.root);
+	EXPECT_EQ(emit(lazy.root), emit(eager.root));
+	sdlangDocumentFree(&lazy);
+	sdlangDocumentFree(&eager);
+}
+
+TEST(Lazy, ErrorsInsideOfBlocksAreDeferred)
+{
+	const std::string code = "a {\n    b {\n        c = 1\n    }\n}\n";
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(parseLazily(code, &doc, &error, &errorLine));
+
+	SdlangTag* a = sdlangTagChildren(&doc, &doc.root.children[0], &error);
+	ASSERT_NE(a, nullptr);
+	EXPECT_EQ(sdlangTagChildren(&doc, &a[0], &error, &errorLine, &errorSlice), nullptr);
+
+	// The same error, at the same place, as parsing it all at once.
+	SdlangTag root = {};
+	SdlangError eagerError;
+	SdlangCharSlice eagerLine, eagerSlice;
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	ASSERT_FALSE(sdlangParseCharStream(stream, &root, &eagerError, &eagerLine, &eagerSlice));
+	EXPECT_STREQ(error, eagerError);
+	EXPECT_EQ(errorLine.ptr, eagerLine.ptr);
+	EXPECT_EQ(toStr(errorLine), toStr(eagerLine));
+	sdlangTagFree(root);
+
+	// Asking again fails the same way.
+	EXPECT_EQ(sdlangTagChildren(&doc, &a[0], &error), nullptr);
+	EXPECT_STREQ(error, eagerError);
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Lazy, BlocksThatCantBeSkippedAreParsed)
+{
+	// Each of these has to fail up front, exactly like an eager parse.
+	const char* cases[] = {
+		"a {\n    b\n",                          // Never closed.
+		"a {\n    b }\n",                        // Closed part way through a line.
+		"a {\n    b \\\n}\n",                    // Closed on a continued line.
+		"a {\n    b {\n        c\n    }\n}\n", // Too deep for a maxDepth of 1.
+	};
+	for (const std::string code : cases)
+	{
+		SdlangDocument doc;
+		SdlangError error, eagerError;
+		SdlangCharSlice errorLine, eagerLine, eagerSlice;
+		EXPECT_FALSE(parseLazily(code, &doc, &error, &errorLine, 1)) << code;
+		sdlangDocumentFree(&doc);
+
+		SdlangParseOptions options = {};
+		options.maxDepth = 1;
+		SdlangTag root = {};
+		SdlangCharStream stream = { code.c_str(), code.length() };
+		ASSERT_FALSE(sdlangParseCharStream(stream, &root, &eagerError, &eagerLine, &eagerSlice, &options));
+		EXPECT_STREQ(error, eagerError) << code;
+		EXPECT_EQ(toStr(errorLine), toStr(eagerLine)) << code;
+		sdlangTagFree(root);
+	}
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <cstdlib>
+#include <string>
+
+// from emit
+std::string emit(SdlangTag root);
+
+// A large document full of the things that make finding split points tricky: nested children, values after a
+// closing brace, line continuations, and strings containing braces and new lines.
+static std::string document(size_t tags)
+{
+	std::string code;
+	for (size_t i = 0; i < tags; i++)
+	{
+		switch (i % 5)
+		{
+		case 0:
+			code += "server \"s" + std::to_string(i) + "\" port=" + std::to_string(i) + " {\n    listen 80\n    route {\n        cache on\n    }\n}\n";
+			break;
+		case 1:
+			code += "raw `spans {\nlines }\n\n` \"and {\\\"}\"\n";
+			break;
+		case 2:
+			code += "continued 1 \\\n    2 \\\n    3\n";
+			break;
+		case 3:
+			code += "block {\n    child\n} 5 after=true\n";
+			break;
+		default:
+			code += "\n    plain 1.5 2021/01/02 null\n";
+			break;
+		}
+	}
+	return code;
+}
+
+struct ParseResult
+{
+	bool parsed;
+	SdlangError error;
+	SdlangCharSlice errorLine;
+	std::string emitted;
+	size_t tags;
+};
+
+static ParseResult parse(const std::string& code, size_t threads, const SdlangParseOptions* options = NULL)
+{
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangCharSlice errorSlice;
+	ParseResult result = {};
+	SdlangTag root = {};
+	result.parsed = threads ? sdlangParseCharStreamParallel(stream, threads, &root, &result.error, &result.errorLine,
+	                                                        &errorSlice, options)
+	                        : sdlangParseCharStream(stream, &root, &result.error, &result.errorLine, &errorSlice,
+	                                                options);
+	result.tags = arrlen(root.children);
+	result.emitted = emit(root);
+	sdlangTagFree(root, options ? options->allocator : NULL);
+	return result;
+}
+
+TEST(Parallel, MatchesSerial)
+{
+	const std::string code = document(40000);
+	const ParseResult serial = parse(code, 0);
+	ASSERT_TRUE(serial.parsed);
+	ASSERT_EQ(serial.tags, 40000);
+
+	for (size_t threads : { 1, 2, 3, 8 })
+	{
+		const ParseResult parallel = parse(code, threads);
+		EXPECT_TRUE(parallel.parsed);
+		EXPECT_EQ(parallel.tags, serial.tags);
+		EXPECT_EQ(parallel.emitted, serial.emitted) << threads << " threads";
+	}
+}
+
+TEST(Parallel, FirstErrorInDocumentOrder)
+{
+	std::string code = document(40000);
+	code.insert(code.size() * 3 / 4, "oops = \n");
+	code.insert(code.size() / 2, "also { oops\n");
+
+	const ParseResult serial = parse(code, 0);
+	ASSERT_FALSE(serial.parsed);
+	const ParseResult parallel = parse(code, 4);
+	EXPECT_FALSE(parallel.parsed);
+	EXPECT_STREQ(parallel.error, serial.error);
+	EXPECT_EQ(parallel.errorLine.ptr, serial.errorLine.ptr);
+	EXPECT_EQ(parallel.errorLine.length, serial.errorLine.length);
+	EXPECT_EQ(parallel.tags, serial.tags);
+	EXPECT_EQ(parallel.emitted, serial.emitted);
+}
+
+TEST(Parallel, UnbalancedBraces)
+{
+	std::string code = document(40000);
+	code.insert(code.size() / 3, "}\n");
+
+	const ParseResult serial = parse(code, 0);
+	const ParseResult parallel = parse(code, 4);
+	EXPECT_EQ(parallel.parsed, serial.parsed);
+	EXPECT_STREQ(parallel.error, serial.error);
+	EXPECT_EQ(parallel.tags, serial.tags);
+}
+
+TEST(Parallel, SmallTextAndExistingChildren)
+{
+	const std::string code = "a 1\nb 2\n";
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag root = {};
+	ASSERT_TRUE(sdlangParseCharStreamParallel(stream, 4, &root, &error, &errorLine, &errorSlice));
+	ASSERT_TRUE(sdlangParseCharStreamParallel(stream, 0, &root, &error, &errorLine, &errorSlice));
+	EXPECT_EQ(arrlen(root.children), 4);
+	sdlangTagFree(root);
+}
+
+static void* plainAlloc(void*, size_t size) { return malloc(size); }
+static void* plainRealloc(void*, void* ptr, size_t size) { return realloc(ptr, size); }
+static void plainFree(void*, void* ptr) { free(ptr); }
+
+TEST(Parallel, CustomAllocator)
+{
+	SdlangAllocator allocator = { plainAlloc, plainRealloc, plainFree, NULL };
+	SdlangParseOptions options = {};
+	options.allocator = &allocator;
+
+	const std::string code = document(20000);
+	const ParseResult serial = parse(code, 0, &options);
+	const ParseResult parallel = parse(code, 4, &options);
+	EXPECT_TRUE(parallel.parsed);
+	EXPECT_EQ(parallel.emitted, serial.emitted);
+}
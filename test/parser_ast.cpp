@@ -47,9 +47,11 @@ TEST(Ast, TagValues)
 
 TEST(Ast, TagAttribs)
 {
-	std::string code = "tag date=1111/22/33 meta:msg=`Henlo`";
+	std::string code = "tag date=1111/22/33 meta:msg=`Henlo` count=420";
 	SdlangTag tag = parse(code);
-	ASSERT_EQ(arrlen(tag.children[0].attributes), 2);
+	ASSERT_EQ(arrlen(tag.children[0].attributes), 3);
+	EXPECT_EQ(tag.children[0].attributes[0].value.dateValue.year, 1111);
+	EXPECT_EQ(tag.children[0].attributes[2].value.intValue, 420);
 	EXPECT_EQ(toStr(tag.children[0].attributes[1].nspace), "meta");
 	EXPECT_EQ(toStr(tag.children[0].attributes[1].name), "msg");
 	EXPECT_EQ(toStr(tag.children[0].attributes[1].value.stringValue), "Henlo");
@@ -72,4 +74,114 @@ TEST(Ast, TagWithLineBrokenValues)
 	SdlangTag tag = parse(code);
 	ASSERT_EQ(arrlen(tag.children[0].values), 2);
 	EXPECT_EQ(tag.children[0].values[1].intValue, 123);
-}
\ No newline at end of file
+}
+
+TEST(Ast, TagManyChildren)
+{
+	std::string code = "\nparent {\n    a 1\n\n    b 2 {\n    }\n    c {\n        d\n    } 3\n}\ne";
+	SdlangTag tag = parse(code);
+	ASSERT_EQ(arrlen(tag.children), 2);
+	ASSERT_EQ(arrlen(tag.children[0].children), 3);
+	EXPECT_EQ(toStr(tag.children[0].children[0].name), "a");
+	EXPECT_EQ(toStr(tag.children[0].children[1].name), "b");
+	EXPECT_EQ(arrlen(tag.children[0].children[1].children), 0);
+	EXPECT_EQ(toStr(tag.children[0].children[2].name), "c");
+	ASSERT_EQ(arrlen(tag.children[0].children[2].children), 1);
+	EXPECT_EQ(toStr(tag.children[0].children[2].children[0].name), "d");
+	ASSERT_EQ(arrlen(tag.children[0].children[2].values), 1);
+	EXPECT_EQ(tag.children[0].children[2].values[0].intValue, 3);
+	EXPECT_EQ(toStr(tag.children[1].name), "e");
+	sdlangTagFree(tag);
+}
+
+TEST(Ast, TagKeywordAttribs)
+{
+	std::string code = "tag online=on offline=false nothing=`null` ";
+	SdlangTag tag = parse(code);
+	ASSERT_EQ(arrlen(tag.children[0].attributes), 3);
+	EXPECT_EQ(toStr(tag.children[0].attributes[0].name), "online");
+	EXPECT_EQ(tag.children[0].attributes[0].value.type, SDLANG_VALUE_TYPE_BOOLEAN);
+	EXPECT_TRUE(tag.children[0].attributes[0].value.boolValue);
+	EXPECT_FALSE(tag.children[0].attributes[1].value.boolValue);
+	EXPECT_EQ(tag.children[0].attributes[2].value.type, SDLANG_VALUE_TYPE_STRING);
+	sdlangTagFree(tag);
+}
+
+TEST(Ast, DeepNesting)
+{
+	const size_t depth = 5000;
+	std::string code;
+	for (size_t i = 0; i < depth; i++)
+		code += "t {\n";
+	for (size_t i = 0; i < depth; i++)
+		code += "}\n";
+
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangParseOptions options = {};
+
+	// The default limit rejects it cleanly...
+	SdlangTag tag = {};
+	EXPECT_FALSE(sdlangParseCharStream(stream, &tag, &error, &errorLine, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_MAX_DEPTH_EXCEEDED);
+	sdlangTagFree(tag);
+
+	// ...and a larger one lets it through.
+	tag = {};
+	options.maxDepth = depth;
+	ASSERT_TRUE(sdlangParseCharStream(stream, &tag, &error, &errorLine, &errorSlice, &options));
+	SdlangTag *node = &tag;
+	size_t levels = 0;
+	while (arrlen(node->children))
+	{
+		node = &node->children[0];
+		levels++;
+	}
+	EXPECT_EQ(levels, depth);
+	sdlangTagFree(tag);
+
+	tag = {};
+	options.maxDepth = depth - 1;
+	EXPECT_FALSE(sdlangParseCharStream(stream, &tag, &error, &errorLine, &errorSlice, &options));
+	sdlangTagFree(tag);
+}
+
+TEST(Ast, LongLineContinuation)
+{
+	std::string code = "tag";
+	for (size_t i = 0; i < 100000; i++)
+		code += " \\\n1";
+	SdlangTag tag = parse(code);
+	ASSERT_EQ(arrlen(tag.children), 1);
+	EXPECT_EQ(arrlen(tag.children[0].values), 100000);
+	sdlangTagFree(tag);
+}
+
+TEST(Ast, UnbalancedBraces)
+{
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	const std::string codes[] = { "a {\nb\n", "a\n}\n", "a {\nb\n} {\nc\n}\n", "a {\nb\n} 1 {\nc\n}\n" };
+	for (const auto &code : codes)
+	{
+		SdlangCharStream stream = { code.c_str(), code.size() };
+		SdlangTag tag = {};
+		EXPECT_FALSE(sdlangParseCharStream(stream, &tag, &error, &errorLine, &errorSlice)) << code;
+		sdlangTagFree(tag);
+	}
+}
+
+TEST(Ast, Semicolons)
+{
+	// A semicolon ends a tag just like a new line, including straight after a brace.
+	std::string code = "a 1;b `x;y` {;c;d\n};e;";
+	SdlangTag tag = parse(code);
+	ASSERT_EQ(arrlen(tag.children), 3);
+	EXPECT_EQ(tag.children[0].values[0].intValue, 1);
+	EXPECT_EQ(toStr(tag.children[1].values[0].stringValue), "x;y");
+	ASSERT_EQ(arrlen(tag.children[1].children), 2);
+	EXPECT_EQ(toStr(tag.children[1].children[1].name), "d");
+	EXPECT_EQ(toStr(tag.children[2].name), "e");
+	sdlangTagFree(tag);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <libsdlang.h>
+#include <clocale>
 #include <vector>
 
 std::vector<SdlangToken> getTokens(const std::string& str)
@@ -229,4 +230,175 @@ TEST(ParserBasic, ValueNull)
 	EXPECT_EQ(tokens[0].type, SDLANG_TOKEN_TYPE_TAG_NAME);
 	EXPECT_EQ(tokens[1].type, SDLANG_TOKEN_TYPE_VALUE_NULL);
 	EXPECT_EQ(tokens[2].type, SDLANG_TOKEN_TYPE_EOF);
-}
\ No newline at end of file
+}
+
+TEST(ParserBasic, LongTokens)
+{
+	// Long enough to go through the vectorised scanners, with the interesting characters at odd offsets.
+	const std::string name = "abcdefghijklmnopqrstuvwxyz_ABCDEFGHIJKLMNOPQRSTUVWXYZ\xC3\xA9t\xC3\xA9";
+	const std::string spaces = " \t                                      \t ";
+	const std::string str = "0123456789 the quick brown fox jumps over the lazy dog \\\"escaped\\\" 0123456789";
+	const std::string raw = "0123456789 the quick brown fox\njumps over the \"lazy\" dog \\ 0123456789";
+	const std::string code = name + spaces + "\"" + str + "\"" + spaces + "`" + raw + "`\n\r\n\n\n\r\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\nb";
+	const auto tokens = getTokens(code);
+	ASSERT_EQ(tokens.size(), 6);
+	EXPECT_EQ(tokens[0].type, SDLANG_TOKEN_TYPE_TAG_NAME);
+	EXPECT_EQ(toStr(tokens[0].name), name);
+	EXPECT_EQ(tokens[1].type, SDLANG_TOKEN_TYPE_VALUE_STRING);
+	EXPECT_EQ(toStr(tokens[1].stringValue), str);
+	EXPECT_EQ(tokens[2].type, SDLANG_TOKEN_TYPE_VALUE_STRING);
+	EXPECT_EQ(toStr(tokens[2].stringValue), raw);
+	EXPECT_EQ(tokens[3].type, SDLANG_TOKEN_TYPE_NEWLINE);
+	EXPECT_EQ(tokens[4].type, SDLANG_TOKEN_TYPE_TAG_NAME);
+	EXPECT_EQ(toStr(tokens[4].name), "b");
+	EXPECT_EQ(tokens[5].type, SDLANG_TOKEN_TYPE_EOF);
+}
+
+TEST(ParserBasic, UnterminatedStrings)
+{
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangError error;
+
+	const std::string codes[] = {
+		"tag \"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz",
+		"tag \"abcdefghijklmnopqrstuvwxyz0123456789\nabcdefghijklmnopqrstuvwxyz\"",
+		"tag `abcdefghijklmnopqrstuvwxyz0123456789\nabcdefghijklmnopqrstuvwxyz\"",
+	};
+	for (const auto &code : codes)
+	{
+		SdlangCharStream stream = { code.c_str(), code.size() };
+		SdlangParser parser = { stream };
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		ASSERT_EQ(parser.front.type, SDLANG_TOKEN_TYPE_TAG_NAME);
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		EXPECT_STREQ(error, SDLANG_ERROR_UNTERMINATED_STRING) << code;
+	}
+}
+
+TEST(ParserBasic, ValueIntegerRadix)
+{
+	const auto tokens = getTokens("tag 0x1F -0X10 0o17 0b101 0xffL");
+	ASSERT_EQ(tokens.size(), 7);
+	for (size_t i = 1; i < 6; i++)
+		EXPECT_EQ(tokens[i].type, SDLANG_TOKEN_TYPE_VALUE_INTEGER);
+	EXPECT_EQ(tokens[1].intValue, 31);
+	EXPECT_EQ(tokens[2].intValue, -16);
+	EXPECT_EQ(tokens[3].intValue, 15);
+	EXPECT_EQ(tokens[4].intValue, 5);
+	EXPECT_EQ(tokens[5].intValue, 255);
+}
+
+TEST(ParserBasic, ValueIntegerLimits)
+{
+	const auto tokens = getTokens("tag 9223372036854775807 -9223372036854775808");
+	ASSERT_EQ(tokens.size(), 4);
+	EXPECT_EQ(tokens[1].intValue, INT64_MAX);
+	EXPECT_EQ(tokens[2].intValue, INT64_MIN);
+
+	const std::string codes[] = { "tag 9223372036854775808", "tag -9223372036854775809", "tag 0x10000000000000000" };
+	for (const auto &code : codes)
+	{
+		SdlangCharStream stream = { code.c_str(), code.size() };
+		SdlangParser parser = { stream };
+		SdlangError error;
+		SdlangCharSlice errorLine, errorSlice;
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		EXPECT_STREQ(error, SDLANG_ERROR_INTEGER_OVERFLOW) << code;
+	}
+}
+
+TEST(ParserBasic, ValueFloatingPrecise)
+{
+	const auto tokens = getTokens("tag 0.1 1e10 -2.5E-3 1.7976931348623157e308 4.9406564584124654e-324 "
+	                              "3.14159265358979323846264338327950288419716939937510 1.0D");
+	ASSERT_EQ(tokens.size(), 9);
+	for (size_t i = 1; i < 8; i++)
+		EXPECT_EQ(tokens[i].type, SDLANG_TOKEN_TYPE_VALUE_FLOATING);
+	EXPECT_EQ((double)tokens[1].floatValue, 0.1);
+	EXPECT_EQ((double)tokens[2].floatValue, 1e10);
+	EXPECT_EQ((double)tokens[3].floatValue, -2.5e-3);
+	EXPECT_EQ((double)tokens[4].floatValue, 1.7976931348623157e308);
+	EXPECT_EQ((double)tokens[5].floatValue, 4.9406564584124654e-324);
+	EXPECT_EQ((double)tokens[6].floatValue, 3.141592653589793);
+	EXPECT_EQ((double)tokens[7].floatValue, 1.0);
+}
+
+TEST(ParserBasic, ValueFloatingIgnoresLocale)
+{
+	const char *locales[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8" };
+	std::string old = setlocale(LC_NUMERIC, NULL);
+	bool changed = false;
+	for (const char *locale : locales)
+		changed = changed || setlocale(LC_NUMERIC, locale);
+	if (!changed)
+		GTEST_SKIP() << "No locale with a ',' decimal point is installed.";
+
+	// Exactly 1 + 2^-52, which has to be read to full precision. (1 + 2^-53 would round to 1.0, being a midpoint.)
+	const auto tokens = getTokens("1.5 1.0000000000000002220446049250313080847263336181640625");
+	setlocale(LC_NUMERIC, old.c_str());
+	ASSERT_EQ(tokens.size(), 4);
+	EXPECT_EQ((double)tokens[1].floatValue, 1.5);
+	EXPECT_EQ((double)tokens[2].floatValue, 1.0000000000000002);
+}
+
+TEST(ParserBasic, ValueTimeSpanMilliseconds)
+{
+	const auto tokens = getTokens("12:34:56.789");
+	ASSERT_EQ(tokens.size(), 3);
+	EXPECT_EQ(tokens[1].type, SDLANG_TOKEN_TYPE_VALUE_TIMESPAN);
+	EXPECT_EQ(tokens[1].timeSpanValue.seconds, 56);
+	EXPECT_EQ(tokens[1].timeSpanValue.milliseconds, 789);
+}
+
+TEST(ParserBasic, ValueDateTimeMilliseconds)
+{
+	const auto tokens = getTokens("tag 2021/08/30   18:00:00.250 -2021/08/30 2021/08/30 at=1");
+	ASSERT_EQ(tokens.size(), 6);
+	EXPECT_EQ(tokens[1].type, SDLANG_TOKEN_TYPE_VALUE_DATETIME);
+	EXPECT_EQ(tokens[1].dateTimeValue.date.year, 2021);
+	EXPECT_EQ(tokens[1].dateTimeValue.time.hours, 18);
+	EXPECT_EQ(tokens[1].dateTimeValue.time.milliseconds, 250);
+	EXPECT_EQ(tokens[2].type, SDLANG_TOKEN_TYPE_VALUE_DATE);
+	EXPECT_EQ(tokens[2].dateValue.year, -2021);
+	EXPECT_EQ(tokens[3].type, SDLANG_TOKEN_TYPE_VALUE_DATE);
+	EXPECT_EQ(tokens[3].dateValue.day, 30);
+	EXPECT_TRUE(tokens[4].isAttrib);
+	EXPECT_EQ(tokens[4].intValue, 1);
+}
+
+TEST(ParserBasic, ValueTimeSpanNegative)
+{
+	const auto tokens = getTokens("tag -01:02:03 -5d:00:00:01.5");
+	ASSERT_EQ(tokens.size(), 4);
+	EXPECT_TRUE(tokens[1].timeSpanValue.isNegative);
+	EXPECT_EQ(tokens[1].timeSpanValue.days, 0);
+	EXPECT_EQ(tokens[1].timeSpanValue.hours, 1);
+	EXPECT_EQ(tokens[1].timeSpanValue.seconds, 3);
+	EXPECT_TRUE(tokens[2].timeSpanValue.isNegative);
+	EXPECT_EQ(tokens[2].timeSpanValue.days, 5);
+	EXPECT_EQ(tokens[2].timeSpanValue.seconds, 1);
+	EXPECT_EQ(tokens[2].timeSpanValue.milliseconds, 5);
+}
+
+TEST(ParserBasic, ValueMalformedDateAndTime)
+{
+	const std::pair<std::string, SdlangError> cases[] = {
+		{ "tag 2021/8/30", SDLANG_ERROR_EXPECTED_TWO_DIGITS },
+		{ "tag 2021/08-30", SDLANG_ERROR_EXPECTED_SLASH },
+		{ "tag 1:02:03", SDLANG_ERROR_EXPECTED_TWO_DIGITS },
+		{ "tag 01:02", SDLANG_ERROR_EXPECTED_COLON },
+		{ "tag 3d01:02:03", SDLANG_ERROR_EXPECTED_COLON },
+		{ "tag 01:02:03.", SDLANG_ERROR_EXPECTED_INTEGER },
+	};
+	for (const auto &c : cases)
+	{
+		SdlangCharStream stream = { c.first.c_str(), c.first.size() };
+		SdlangParser parser = { stream };
+		SdlangError error;
+		SdlangCharSlice errorLine, errorSlice;
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		sdlangParserNext(&parser, &error, &errorLine, &errorSlice);
+		EXPECT_STREQ(error, c.second) << c.first;
+	}
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+#include <vector>
+
+std::vector<SdlangToken> getTokens(const std::string& str);
+std::string toStr(SdlangCharSlice slice);
+
+struct PushedToken
+{
+	SdlangTokenType type;
+	size_t start;
+	size_t end;
+	std::string nspace;
+	std::string name;
+	std::string value;
+	int64_t intValue;
+};
+
+static const char* collect(const SdlangToken* token, void* userData)
+{
+	PushedToken pushed = { token->type, token->start, token->end, toStr(token->nspace), toStr(token->name) };
+	if (token->type == SDLANG_TOKEN_TYPE_VALUE_STRING)
+		pushed.value = toStr(token->stringValue);
+	if (token->type == SDLANG_TOKEN_TYPE_VALUE_INTEGER)
+		pushed.intValue = token->intValue;
+	static_cast<std::vector<PushedToken>*>(userData)->push_back(pushed);
+	return NULL;
+}
+
+static std::vector<PushedToken> pushTokens(const std::string& code, const std::vector<size_t>& splits)
+{
+	std::vector<PushedToken> tokens;
+	SdlangPushParser parser;
+	sdlangPushParserInit(&parser, collect, &tokens);
+
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	size_t last = 0;
+	for (size_t split : splits)
+	{
+		EXPECT_TRUE(sdlangPushParserFeed(&parser, code.c_str() + last, split - last, &error, &errorLine, &errorSlice));
+		last = split;
+	}
+	EXPECT_TRUE(sdlangPushParserFeed(&parser, code.c_str() + last, code.length() - last, &error, &errorLine, &errorSlice));
+	EXPECT_TRUE(sdlangPushParserFinish(&parser, &error, &errorLine, &errorSlice));
+	sdlangPushParserFree(&parser);
+	return tokens;
+}
+
+static void expectSameTokens(const std::string& code, const std::vector<PushedToken>& pushed)
+{
+	const auto expected = getTokens(code);
+	ASSERT_EQ(pushed.size(), expected.size());
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		EXPECT_EQ(pushed[i].type, expected[i].type);
+		EXPECT_EQ(pushed[i].start, expected[i].start);
+		EXPECT_EQ(pushed[i].end, expected[i].end);
+		EXPECT_EQ(pushed[i].nspace, toStr(expected[i].nspace));
+		EXPECT_EQ(pushed[i].name, toStr(expected[i].name));
+		if (expected[i].type == SDLANG_TOKEN_TYPE_VALUE_STRING)
+			EXPECT_EQ(pushed[i].value, toStr(expected[i].stringValue));
+		if (expected[i].type == SDLANG_TOKEN_TYPE_VALUE_INTEGER)
+			EXPECT_EQ(pushed[i].intValue, expected[i].intValue);
+	}
+}
+
+static const std::string SAMPLE =
+	"server:http \"main\" port=8080 tls:mode=on enabled=true {\r\n"
+	"    listen 123456789 0x1F 1.5e3 2024/01/31 2024/01/31 12:30:45.250 \\\n"
+	"        `raw\nstring` \"esc\\\"aped\" off null\n"
+	"    timeout 1d:02:03:04.5 -00:00:05 on\n"
+	"}\n"
+	"last";
+
+TEST(PushParser, SingleChunk)
+{
+	expectSameTokens(SAMPLE, pushTokens(SAMPLE, {}));
+}
+
+TEST(PushParser, ByteAtATime)
+{
+	std::vector<size_t> splits;
+	for (size_t i = 1; i < SAMPLE.length(); i++)
+		splits.push_back(i);
+	expectSameTokens(SAMPLE, pushTokens(SAMPLE, splits));
+}
+
+TEST(PushParser, EveryTwoWaySplit)
+{
+	for (size_t i = 0; i <= SAMPLE.length(); i++)
+		expectSameTokens(SAMPLE, pushTokens(SAMPLE, { i }));
+}
+
+TEST(PushParser, EmptyChunks)
+{
+	expectSameTokens(SAMPLE, pushTokens(SAMPLE, { 0, 0, 10, 10, 10, SAMPLE.length() }));
+}
+
+TEST(PushParser, LongToken)
+{
+	const std::string code = "tag \"" + std::string(100000, 'x') + "\" 1";
+	std::vector<size_t> splits;
+	for (size_t i = 7; i < code.length(); i += 7)
+		splits.push_back(i);
+	expectSameTokens(code, pushTokens(code, splits));
+}
+
+TEST(PushParser, Errors)
+{
+	std::vector<PushedToken> tokens;
+	SdlangPushParser parser;
+	sdlangPushParserInit(&parser, collect, &tokens);
+
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_TRUE(sdlangPushParserFeed(&parser, "tag \"unter", 10, &error, &errorLine, &errorSlice));
+	EXPECT_TRUE(sdlangPushParserFeed(&parser, "minated", 7, &error, &errorLine, &errorSlice));
+	EXPECT_FALSE(sdlangPushParserFinish(&parser, &error, &errorLine, &errorSlice));
+	EXPECT_NE(error, nullptr);
+	EXPECT_EQ(tokens.size(), 1);
+
+	// Errors are sticky.
+	EXPECT_FALSE(sdlangPushParserFeed(&parser, "\"", 1, &error, &errorLine, &errorSlice));
+	sdlangPushParserFree(&parser);
+}
+
+static const char* stopAtValue(const SdlangToken* token, void* userData)
+{
+	(void)userData;
+	return token->type == SDLANG_TOKEN_TYPE_VALUE_INTEGER ? "stop" : NULL;
+}
+
+TEST(PushParser, CallbackStops)
+{
+	SdlangPushParser parser;
+	sdlangPushParserInit(&parser, stopAtValue, NULL);
+
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	EXPECT_FALSE(sdlangPushParserFeed(&parser, "tag 1 2\n", 8, &error, &errorLine, &errorSlice));
+	EXPECT_STREQ(error, "stop");
+	sdlangPushParserFree(&parser);
+}
+
+TEST(PushParser, CompactText)
+{
+	// Compact text ends tags with ';' rather than new lines, which must still let tokens out as soon as they're done.
+	std::string code;
+	for (int i = 0; i < 2000; i++)
+		code += i % 500 ? "flag\n" : "server port=" + std::to_string(i) + " {\n    route `/` 1.5\n}\n";
+	SdlangCharStream stream = { code.c_str(), code.length() };
+	SdlangTag root = {};
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice));
+	SdlangEmitOptions options = {};
+	options.compact = true;
+	char* output;
+	ASSERT_EQ(sdlangEmitToString(root, &output, NULL, &options), nullptr);
+	const std::string compact = output;
+	free(output);
+	sdlangTagFree(root);
+
+	std::vector<PushedToken> tokens;
+	SdlangPushParser parser;
+	sdlangPushParserInit(&parser, collect, &tokens);
+	for (size_t at = 0; at < compact.length(); at += 16)
+		ASSERT_TRUE(sdlangPushParserFeed(&parser, compact.c_str() + at, std::min<size_t>(16, compact.length() - at), &error, &errorLine, &errorSlice));
+	EXPECT_GT(tokens.size(), getTokens(compact).size() - 10);
+	ASSERT_TRUE(sdlangPushParserFinish(&parser, &error, &errorLine, &errorSlice));
+	sdlangPushParserFree(&parser);
+	expectSameTokens(compact, tokens);
+}
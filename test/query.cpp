@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+#include <vector>
+
+// from parser_ast
+SdlangTag parse(const std::string& code);
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static const std::string CODE =
+	"server \"a\" {\n"
+	"    listen port=80\n"
+	"    listen\n"
+	"    route name=\"x\" {\n"
+	"        cache on\n"
+	"    }\n"
+	"    route name=\"y\"\n"
+	"}\n"
+	"server \"b\" {\n"
+	"    listen port=443 secure=true\n"
+	"    xml:route name=\"x\"\n"
+	"}\n"
+	"cache off {\n"
+	"    cache 2 {\n"
+	"        cache 3\n"
+	"    }\n"
+	"}\n";
+
+// Runs `text` over the tree, returning each match as its name followed by its first value.
+static std::vector<std::string> run(SdlangTag& root, const char* text)
+{
+	SdlangQuery query;
+	SdlangError error;
+	SdlangCharSlice errorSlice;
+	EXPECT_TRUE(sdlangQueryCompile(text, &query, &error, &errorSlice)) << error;
+
+	std::vector<std::string> matches;
+	SdlangQueryIterator iterator;
+	sdlangQueryBegin(&iterator, &query, &root);
+	while (SdlangTag* tag = sdlangQueryNext(&iterator))
+	{
+		std::string match = toStr(tag->name);
+		if (arrlen(tag->values))
+		{
+			const SdlangValue value = tag->values[0];
+			match += " " + (value.type == SDLANG_VALUE_TYPE_STRING ? toStr(value.stringValue)
+				: value.type == SDLANG_VALUE_TYPE_BOOLEAN ? std::string(value.boolValue ? "on" : "off")
+				: std::to_string(value.intValue));
+		}
+		matches.push_back(match);
+	}
+	EXPECT_EQ(iterator.error, SDLANG_ERROR_NONE);
+	sdlangQueryFree(&query);
+	return matches;
+}
+
+typedef std::vector<std::string> Matches;
+
+TEST(Query, Steps)
+{
+	SdlangTag root = parse(CODE);
+	EXPECT_EQ(run(root, "server"), Matches({ "server a", "server b" }));
+	EXPECT_EQ(run(root, "/server"), Matches({ "server a", "server b" }));
+	EXPECT_EQ(run(root, "server/listen"), Matches({ "listen", "listen", "listen" }));
+	EXPECT_EQ(run(root, "*/route"), Matches({ "route", "route" }));
+	EXPECT_EQ(run(root, "*/xml:route"), Matches({ "route" }));
+	EXPECT_EQ(run(root, "*/*/cache"), Matches({ "cache on", "cache 3" }));
+	EXPECT_EQ(run(root, "listen"), Matches());
+	EXPECT_EQ(run(root, "serv"), Matches());
+	sdlangTagFree(root);
+}
+
+TEST(Query, Descendants)
+{
+	SdlangTag root = parse(CODE);
+
+	// In document order, each match only once even when a `//` could reach it more than one way.
+	EXPECT_EQ(run(root, "//cache"), Matches({ "cache on", "cache off", "cache 2", "cache 3" }));
+	EXPECT_EQ(run(root, "//cache//cache"), Matches({ "cache 2", "cache 3" }));
+	EXPECT_EQ(run(root, "cache//cache"), Matches({ "cache 2", "cache 3" }));
+	EXPECT_EQ(run(root, "server//cache"), Matches({ "cache on" }));
+	EXPECT_EQ(run(root, "//route/cache"), Matches({ "cache on" }));
+	EXPECT_EQ(run(root, "//*[@port]"), Matches({ "listen", "listen" }));
+	sdlangTagFree(root);
+}
+
+TEST(Query, Predicates)
+{
+	SdlangTag root = parse(CODE);
+	EXPECT_EQ(run(root, "server/listen[@port]"), Matches({ "listen", "listen" }));
+	EXPECT_EQ(run(root, "server/listen[@port=443]"), Matches({ "listen" }));
+	EXPECT_EQ(run(root, "server/listen[port=443][secure=true]"), Matches({ "listen" }));
+	EXPECT_EQ(run(root, "server/listen[port=80][secure=true]"), Matches());
+	EXPECT_EQ(run(root, "server/listen[@port=\"80\"]"), Matches());
+	EXPECT_EQ(run(root, "*/route[name=\"x\"]/cache"), Matches({ "cache on" }));
+	EXPECT_EQ(run(root, "//*[name=`y`]"), Matches({ "route" }));
+	EXPECT_EQ(run(root, "//*[name=\"\"]"), Matches());
+	EXPECT_EQ(run(root, "//*[@nam]"), Matches());
+	sdlangTagFree(root);
+}
+
+TEST(Query, EscapedStrings)
+{
+	const std::string code = "say text=\"\\\"hi\\\"\\n\"\n";
+	const char* const query = "say[text=\"\\\"hi\\\"\\n\"]";
+	SdlangTag root = parse(code);
+	EXPECT_EQ(run(root, query), Matches({ "say" }));
+	EXPECT_EQ(run(root, "say[text=\"\\\"hi\\\"\"]"), Matches());
+	sdlangTagFree(root);
+
+	SdlangDocument document;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangParseOptions options = {};
+	options.unescapeStrings = true;
+	ASSERT_TRUE(sdlangParseDocument({ code.c_str(), code.length() }, &document, &error, &errorLine, &errorSlice,
+		&options));
+	EXPECT_EQ(run(document.root, query), Matches({ "say" }));
+	EXPECT_EQ(run(document.root, "say[text=`\"hi\"\n`]"), Matches({ "say" }));
+	EXPECT_EQ(run(document.root, "say[text=\"\\\"hi\\\"\"]"), Matches());
+	sdlangDocumentFree(&document);
+}
+
+TEST(Query, Errors)
+{
+	const char* const invalid[] = { "", "/", "server/", "server///listen", "a[", "a[@]", "a[port=]", "a[port=1",
+		"a b", "a[port=\"1]", "a[port=1.5.5]" };
+	for (const char* text : invalid)
+	{
+		SdlangQuery query;
+		SdlangError error = SDLANG_ERROR_NONE;
+		SdlangCharSlice errorSlice;
+		EXPECT_FALSE(sdlangQueryCompile(text, &query, &error, &errorSlice)) << text;
+		EXPECT_NE(error, SDLANG_ERROR_NONE) << text;
+		EXPECT_GE(errorSlice.ptr, text) << text;
+		EXPECT_LE(errorSlice.ptr, text + strlen(text)) << text;
+	}
+
+	SdlangQuery query;
+	SdlangError error;
+	SdlangCharSlice errorSlice;
+	EXPECT_FALSE(sdlangQueryCompile("a[port=1", &query, &error, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_QUERY_EXPECTED_BRACKET);
+	EXPECT_FALSE(sdlangQueryCompile("a/[port=1]", &query, &error, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_QUERY_EXPECTED_STEP);
+	EXPECT_EQ(toStr(errorSlice), "[");
+
+	std::string tooLong = "a";
+	for (int i = 0; i < 64; i++)
+		tooLong += "/a";
+	EXPECT_FALSE(sdlangQueryCompile(tooLong.c_str(), &query, &error));
+	EXPECT_STREQ(error, SDLANG_ERROR_QUERY_TOO_MANY_STEPS);
+}
+
+TEST(Query, MaxDepth)
+{
+	std::string code, close;
+	for (int i = 0; i < SDLANG_QUERY_MAX_DEPTH + 2; i++)
+	{
+		code += "a {\n";
+		close += "}\n";
+	}
+	code += "b\n" + close;
+	SdlangTag root = parse(code);
+
+	SdlangQuery query;
+	ASSERT_TRUE(sdlangQueryCompile("//b", &query));
+	SdlangQueryIterator iterator;
+	sdlangQueryBegin(&iterator, &query, &root);
+	EXPECT_EQ(sdlangQueryNext(&iterator), nullptr);
+	EXPECT_STREQ(iterator.error, SDLANG_ERROR_MAX_DEPTH_EXCEEDED);
+
+	// Queries without a `//` never go deeper than they have steps.
+	sdlangQueryFree(&query);
+	ASSERT_TRUE(sdlangQueryCompile("a/a/a", &query));
+	EXPECT_EQ(sdlangQueryFirst(&query, &root), &root.children[0].children[0].children[0]);
+	sdlangQueryFree(&query);
+	sdlangTagFree(root);
+}
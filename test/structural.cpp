@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+// The index, worked out one character at a time in the most obvious way.
+static std::vector<uint32_t> referenceIndex(const std::string& text)
+{
+	std::vector<uint32_t> offsets;
+	bool inString = false, inWysiwyg = false, escaped = false;
+	for (uint32_t i = 0; i < text.size(); i++)
+	{
+		const char ch = text[i];
+		const bool isNewline = ch == '\n' || ch == '\r';
+		if (escaped)
+			escaped = false;
+		else if (inWysiwyg)
+		{
+			if (ch == '`')
+			{
+				offsets.push_back(i);
+				inWysiwyg = false;
+			}
+		}
+		else if (inString)
+		{
+			if (ch == '\\')
+				escaped = true;
+			if (ch == '\\' || ch == '"' || isNewline)
+				offsets.push_back(i);
+			if (ch == '"')
+				inString = false;
+		}
+		else
+		{
+			escaped = ch == '\\';
+			inString = ch == '"';
+			inWysiwyg = ch == '`';
+			if (escaped || inString || inWysiwyg || isNewline || ch == '{' || ch == '}' || ch == '=' || ch == ':')
+				offsets.push_back(i);
+		}
+	}
+	return offsets;
+}
+
+static std::vector<uint32_t> buildIndex(const std::string& text)
+{
+	SdlangCharStream stream = { text.c_str(), text.size() };
+	SdlangStructuralIndex index;
+	SdlangError error;
+	EXPECT_TRUE(sdlangStructuralIndexBuild(stream, &index, &error));
+	std::vector<uint32_t> offsets(index.offsets, index.offsets + index.count);
+	sdlangStructuralIndexFree(&index);
+	return offsets;
+}
+
+TEST(StructuralIndex, Basic)
+{
+	const std::string code = "a:b \"x{\\\"}\" k=`\"{`\n}";
+	const std::vector<uint32_t> expected = { 1, 4, 7, 10, 13, 14, 17, 18, 19 };
+	EXPECT_EQ(buildIndex(code), expected);
+	EXPECT_EQ(referenceIndex(code), expected);
+}
+
+TEST(StructuralIndex, MatchesReferenceAcrossBlocks)
+{
+	// Lots of short runs of the interesting characters, so that strings, escapes and backslash runs of every length
+	// end up straddling the 64 byte blocks in every possible way.
+	const char alphabet[] = "ab \"\"``\\\\\\{}=:\n\r";
+	std::mt19937 random(1234);
+	for (int round = 0; round < 500; round++)
+	{
+		std::string text;
+		const size_t length = random() % 600;
+		for (size_t i = 0; i < length; i++)
+			text += alphabet[random() % (sizeof(alphabet) - 1)];
+		ASSERT_EQ(buildIndex(text), referenceIndex(text)) << text;
+	}
+}
+
+TEST(StructuralIndex, Empty)
+{
+	SdlangCharStream stream = { "", 0 };
+	SdlangStructuralIndex index;
+	SdlangError error;
+	ASSERT_TRUE(sdlangStructuralIndexBuild(stream, &index, &error));
+	EXPECT_EQ(index.count, 0);
+	sdlangStructuralIndexFree(&index);
+}
+
+static std::string parseLog(const std::string& code, bool indexed)
+{
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangStructuralIndex index;
+	SdlangError error;
+	SdlangCharSlice errorLine = {}, errorSlice = {};
+	EXPECT_TRUE(sdlangStructuralIndexBuild(stream, &index, &error));
+
+	SdlangParseOptions options = {};
+	options.index = indexed ? &index : NULL;
+	SdlangTag root = {};
+	const bool parsed = sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options);
+
+	std::string log = parsed ? "ok" : std::string(error) + " @ " + toStr(errorLine);
+	std::vector<const SdlangTag*> stack = { &root };
+	while (!stack.empty())
+	{
+		const SdlangTag* tag = stack.back();
+		stack.pop_back();
+		log += " <" + toStr(tag->name);
+		for (int i = 0; i < arrlen(tag->values); i++)
+		{
+			const SdlangValue value = tag->values[i];
+			log += value.type == SDLANG_VALUE_TYPE_STRING ? " '" + toStr(value.stringValue) + "'" : " v";
+		}
+		for (int i = 0; i < arrlen(tag->attributes); i++)
+			log += " " + toStr(tag->attributes[i].name) + "='" + toStr(tag->attributes[i].value.stringValue) + "'";
+		for (int i = arrlen(tag->children) - 1; i >= 0; i--)
+			stack.push_back(&tag->children[i]);
+	}
+
+	sdlangTagFree(root);
+	sdlangStructuralIndexFree(&index);
+	return log;
+}
+
+TEST(StructuralIndex, ParseMatchesUnindexed)
+{
+	const char* cases[] = {
+		"a \"one\" \"t\\\"wo\" `th\"r\nee` k=\"v\" {\n    b \"\\\\\" `\\`\n}\n",
+		"a \"unterminated\n",
+		"a \"unterminated",
+		"a `unterminated\n\n",
+		"a \\\n    \"continued\" \\\"not a string\n",
+		"a \"x\"\"y\" `z`\"w\"\n",
+	};
+	for (const char* code : cases)
+		EXPECT_EQ(parseLog(code, true), parseLog(code, false)) << code;
+
+	std::string big;
+	for (int i = 0; i < 500; i++)
+		big += "tag \"s" + std::to_string(i) + "\\t\" `raw {" + std::to_string(i) + "}` k=\"v\\\"\" {\n    child \"c\"\n}\n";
+	EXPECT_EQ(parseLog(big, true), parseLog(big, false));
+}
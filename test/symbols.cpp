@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+#include <vector>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static const SdlangCharSlice NONE = {};
+
+TEST(Symbols, Intern)
+{
+	SdlangSymbolTable table = {};
+	EXPECT_EQ(sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("server")), SDLANG_SYMBOL_NONE);
+
+	// Symbols are handed out in order, so names registered up front get known ones.
+	EXPECT_EQ(sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("server")), 1u);
+	EXPECT_EQ(sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("route")), 2u);
+	EXPECT_EQ(sdlangSymbolIntern(&table, SDLANG_CHAR_SLICE("xml"), SDLANG_CHAR_SLICE("route")), 3u);
+	EXPECT_EQ(sdlangSymbolIntern(&table, SDLANG_CHAR_SLICE("xm"), SDLANG_CHAR_SLICE("lroute")), 4u);
+	EXPECT_EQ(sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("server")), 1u);
+	EXPECT_EQ(sdlangSymbolFind(&table, SDLANG_CHAR_SLICE("xml"), SDLANG_CHAR_SLICE("route")), 3u);
+	EXPECT_EQ(sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("serve")), SDLANG_SYMBOL_NONE);
+
+	// Enough to make the table grow a few times.
+	std::vector<std::string> names;
+	for (int i = 0; i < 1000; i++)
+		names.push_back("name" + std::to_string(i));
+	for (int i = 0; i < 1000; i++)
+	{
+		const SdlangCharSlice name = { names[i].c_str(), names[i].size() };
+		EXPECT_EQ(sdlangSymbolIntern(&table, NONE, name), (SdlangSymbol)(i + 5));
+	}
+
+	// The table has its own copy of every name.
+	SdlangCharSlice nspace, name;
+	names[10] = "overwritten";
+	ASSERT_TRUE(sdlangSymbolName(&table, 15, &nspace, &name));
+	EXPECT_EQ(nspace.length, 0u);
+	EXPECT_STREQ(name.ptr, "name10");
+	ASSERT_TRUE(sdlangSymbolName(&table, 3, &nspace, &name));
+	EXPECT_STREQ(nspace.ptr, "xml");
+	EXPECT_STREQ(name.ptr, "route");
+	EXPECT_FALSE(sdlangSymbolName(&table, SDLANG_SYMBOL_NONE, &nspace, &name));
+	EXPECT_FALSE(sdlangSymbolName(&table, 1005, &nspace, &name));
+
+	sdlangSymbolTableFree(&table);
+	EXPECT_EQ(sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("server")), SDLANG_SYMBOL_NONE);
+}
+
+enum Names
+{
+	SERVER = 1,
+	PORT,
+	ROUTE,
+};
+
+static const std::string CODE =
+	"server port=80 {\n"
+	"    route \"/\" xml:port=1\n"
+	"    cache port=2\n"
+	"}\n"
+	"server port=81\n";
+
+TEST(Symbols, Parse)
+{
+	SdlangSymbolTable table = {};
+	sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("server"));
+	sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("port"));
+	sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("route"));
+
+	SdlangParseOptions options = {};
+	options.symbols = &table;
+	SdlangCharStream stream = { CODE.c_str(), CODE.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag root = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &root, &error, &errorLine, &errorSlice, &options));
+
+	ASSERT_EQ(arrlen(root.children), 2);
+	const SdlangTag server = root.children[0];
+	EXPECT_EQ(server.symbol, (SdlangSymbol)SERVER);
+	EXPECT_EQ(server.attributes[0].symbol, (SdlangSymbol)PORT);
+	EXPECT_EQ(root.children[1].symbol, (SdlangSymbol)SERVER);
+	EXPECT_EQ(server.children[0].symbol, (SdlangSymbol)ROUTE);
+	EXPECT_EQ(server.children[1].attributes[0].symbol, (SdlangSymbol)PORT);
+
+	// Names that weren't registered get new symbols as they're found.
+	const SdlangSymbol xmlPort = server.children[0].attributes[0].symbol;
+	EXPECT_EQ(xmlPort, sdlangSymbolFind(&table, SDLANG_CHAR_SLICE("xml"), SDLANG_CHAR_SLICE("port")));
+	EXPECT_EQ(server.children[1].symbol, sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("cache")));
+	EXPECT_EQ(xmlPort, 4u);
+	EXPECT_EQ(server.children[1].symbol, 5u);
+
+	// Interning a tree afterwards gives the same result.
+	SdlangTag plain = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &plain, &error, &errorLine, &errorSlice));
+	EXPECT_EQ(plain.children[0].symbol, SDLANG_SYMBOL_NONE);
+	ASSERT_TRUE(sdlangTagInternNames(&plain, &table));
+	EXPECT_EQ(plain.symbol, SDLANG_SYMBOL_NONE);
+	EXPECT_EQ(plain.children[0].symbol, (SdlangSymbol)SERVER);
+	EXPECT_EQ(plain.children[0].children[0].attributes[0].symbol, xmlPort);
+
+	sdlangTagFree(plain);
+	sdlangTagFree(root);
+	sdlangSymbolTableFree(&table);
+}
+
+TEST(Symbols, SharedBetweenDocuments)
+{
+	SdlangSymbolTable table = {};
+	SdlangParseOptions options = {};
+	options.symbols = &table;
+	options.lazy = true;
+	SdlangCharStream stream = { CODE.c_str(), CODE.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	SdlangDocument first, second;
+	ASSERT_TRUE(sdlangParseDocument(stream, &first, &error, &errorLine, &errorSlice, &options));
+	ASSERT_TRUE(sdlangParseDocument(stream, &second, &error, &errorLine, &errorSlice, &options));
+	EXPECT_EQ(first.root.children[0].symbol, second.root.children[0].symbol);
+
+	// The table outlives the text the names came from.
+	sdlangDocumentFree(&first);
+	SdlangTag* children = sdlangTagChildren(&second, &second.root.children[0]);
+	ASSERT_NE(children, nullptr);
+	EXPECT_EQ(children[0].symbol, sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("route")));
+	EXPECT_NE(children[0].symbol, SDLANG_SYMBOL_NONE);
+	sdlangDocumentFree(&second);
+
+	SdlangCharSlice nspace, name;
+	ASSERT_TRUE(sdlangSymbolName(&table, 1, &nspace, &name));
+	EXPECT_EQ(toStr(name), "server");
+	sdlangSymbolTableFree(&table);
+}
+
+TEST(Symbols, ParallelMatchesSerial)
+{
+	std::string code;
+	for (int i = 0; i < 20000; i++)
+		code += i % 3 ? "alpha a=1 b=2 {\n    beta c=3\n}\n" : "gamma ns:d=4\n";
+	SdlangCharStream stream = { code.c_str(), code.size() };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+
+	SdlangSymbolTable serialTable = {}, parallelTable = {};
+	SdlangParseOptions options = {};
+	options.symbols = &serialTable;
+	SdlangTag serial = {}, parallel = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &serial, &error, &errorLine, &errorSlice, &options));
+	options.symbols = &parallelTable;
+	ASSERT_TRUE(sdlangParseCharStreamParallel(stream, 4, &parallel, &error, &errorLine, &errorSlice, &options));
+
+	ASSERT_EQ(arrlen(serial.children), arrlen(parallel.children));
+	for (ptrdiff_t i = 0; i < arrlen(serial.children); i += 997)
+	{
+		EXPECT_EQ(serial.children[i].symbol, parallel.children[i].symbol);
+		EXPECT_EQ(serial.children[i].attributes[0].symbol, parallel.children[i].attributes[0].symbol);
+	}
+	for (SdlangSymbol symbol = 1; symbol <= 7; symbol++)
+	{
+		SdlangCharSlice serialNspace, serialName, parallelNspace, parallelName;
+		ASSERT_TRUE(sdlangSymbolName(&serialTable, symbol, &serialNspace, &serialName));
+		ASSERT_TRUE(sdlangSymbolName(&parallelTable, symbol, &parallelNspace, &parallelName));
+		EXPECT_EQ(toStr(serialNspace), toStr(parallelNspace));
+		EXPECT_EQ(toStr(serialName), toStr(parallelName));
+	}
+
+	sdlangTagFree(serial);
+	sdlangTagFree(parallel);
+	sdlangSymbolTableFree(&serialTable);
+	sdlangSymbolTableFree(&parallelTable);
+}
+
+TEST(Symbols, Batch)
+{
+	SdlangSymbolTable table = {};
+	sdlangSymbolIntern(&table, NONE, SDLANG_CHAR_SLICE("server"));
+	SdlangParseOptions options = {};
+	options.symbols = &table;
+
+	SdlangBatchItem items[3] = {};
+	for (SdlangBatchItem& item : items)
+		item.stream = { CODE.c_str(), CODE.size() };
+	ASSERT_TRUE(sdlangParseBatch(items, 3, 2, &options));
+	for (SdlangBatchItem& item : items)
+	{
+		EXPECT_EQ(item.document.root.children[1].symbol, (SdlangSymbol)SERVER);
+		EXPECT_EQ(item.document.root.children[0].children[0].symbol,
+				  sdlangSymbolFind(&table, NONE, SDLANG_CHAR_SLICE("route")));
+		sdlangDocumentFree(&item.document);
+	}
+	sdlangSymbolTableFree(&table);
+}
+
+TEST(Symbols, TagStillInitialisesPositionally)
+{
+	// The symbol comes after the fields tags always had, so code written before it still compiles and means the same.
+	SdlangValue value = {};
+	SdlangValue* values = NULL;
+	arrput(values, value);
+	SdlangTag tag = { SDLANG_CHAR_SLICE("ns"), SDLANG_CHAR_SLICE("name"), NULL, values, NULL };
+	EXPECT_EQ(toStr(tag.name), "name");
+	EXPECT_EQ(arrlen(tag.values), 1);
+	EXPECT_EQ(tag.symbol, SDLANG_SYMBOL_NONE);
+	arrfree(values);
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <libsdlang.h>
+#include <string>
+
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static void expectSameTree(const SdlangTag& a, const SdlangTag& b)
+{
+	EXPECT_EQ(toStr(a.nspace), toStr(b.nspace));
+	EXPECT_EQ(toStr(a.name), toStr(b.name));
+	ASSERT_EQ(arrlen(a.values), arrlen(b.values));
+	for (int i = 0; i < arrlen(a.values); i++)
+	{
+		EXPECT_EQ(a.values[i].type, b.values[i].type);
+		EXPECT_EQ(a.values[i].intValue, b.values[i].intValue);
+	}
+	ASSERT_EQ(arrlen(a.attributes), arrlen(b.attributes));
+	for (int i = 0; i < arrlen(a.attributes); i++)
+	{
+		EXPECT_EQ(toStr(a.attributes[i].name), toStr(b.attributes[i].name));
+		EXPECT_EQ(a.attributes[i].value.intValue, b.attributes[i].value.intValue);
+	}
+	ASSERT_EQ(arrlen(a.children), arrlen(b.children));
+	for (int i = 0; i < arrlen(a.children); i++)
+		expectSameTree(a.children[i], b.children[i]);
+}
+
+static const char* CODE = "a 1 x=2 {\n    b 3 {\n        c\n    }\n    ns:d y=4\n} 5 z=6\ne 7\n";
+
+TEST(Tape, Layout)
+{
+	SdlangCharStream stream = { CODE, strlen(CODE) };
+	SdlangTape tape;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice));
+
+	// root, a, b, c, ns:d, e
+	ASSERT_EQ(tape.nodeCount, 6);
+	EXPECT_EQ(tape.valueCount, 4);
+	EXPECT_EQ(tape.attributeCount, 3);
+
+	const SdlangTapeIndex a = sdlangTapeFirstChild(&tape, SDLANG_TAPE_ROOT);
+	EXPECT_EQ(toStr(tape.nodes[a].name), "a");
+	EXPECT_EQ(tape.nodes[a].subtreeEnd, 5);
+
+	// Values after the closing brace stay together with the ones before it.
+	size_t count;
+	const SdlangValue* values = sdlangTapeValues(&tape, a, &count);
+	ASSERT_EQ(count, 2);
+	EXPECT_EQ(values[0].intValue, 1);
+	EXPECT_EQ(values[1].intValue, 5);
+	const SdlangAttribute* attribs = sdlangTapeAttributes(&tape, a, &count);
+	ASSERT_EQ(count, 2);
+	EXPECT_EQ(toStr(attribs[0].name), "x");
+	EXPECT_EQ(toStr(attribs[1].name), "z");
+
+	const SdlangTapeIndex b = sdlangTapeFirstChild(&tape, a);
+	EXPECT_EQ(toStr(tape.nodes[b].name), "b");
+	EXPECT_EQ(toStr(tape.nodes[sdlangTapeFirstChild(&tape, b)].name), "c");
+	EXPECT_EQ(sdlangTapeFirstChild(&tape, sdlangTapeFirstChild(&tape, b)), SDLANG_TAPE_NONE);
+
+	const SdlangTapeIndex d = sdlangTapeNextSibling(&tape, b);
+	EXPECT_EQ(toStr(tape.nodes[d].nspace), "ns");
+	EXPECT_EQ(sdlangTapeNextSibling(&tape, d), SDLANG_TAPE_NONE);
+
+	const SdlangTapeIndex e = sdlangTapeNextSibling(&tape, a);
+	EXPECT_EQ(toStr(tape.nodes[e].name), "e");
+	EXPECT_EQ(sdlangTapeNextSibling(&tape, e), SDLANG_TAPE_NONE);
+	EXPECT_EQ(tape.nodes[SDLANG_TAPE_ROOT].subtreeEnd, 6);
+
+	sdlangTapeFree(&tape);
+	EXPECT_EQ(tape.nodes, nullptr);
+}
+
+TEST(Tape, RoundTrip)
+{
+	SdlangCharStream stream = { CODE, strlen(CODE) };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag tree = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &tree, &error, &errorLine, &errorSlice));
+
+	SdlangTape parsed, converted;
+	ASSERT_TRUE(sdlangParseTape(stream, &parsed, &error, &errorLine, &errorSlice));
+	ASSERT_TRUE(sdlangTapeFromTag(tree, &converted));
+	ASSERT_EQ(parsed.nodeCount, converted.nodeCount);
+	for (size_t i = 0; i < parsed.nodeCount; i++)
+	{
+		EXPECT_EQ(parsed.nodes[i].firstChild, converted.nodes[i].firstChild);
+		EXPECT_EQ(parsed.nodes[i].nextSibling, converted.nodes[i].nextSibling);
+		EXPECT_EQ(parsed.nodes[i].subtreeEnd, converted.nodes[i].subtreeEnd);
+	}
+
+	SdlangTag back;
+	ASSERT_TRUE(sdlangTapeToTag(&parsed, SDLANG_TAPE_ROOT, &back));
+	expectSameTree(tree, back);
+
+	SdlangTag subtree;
+	ASSERT_TRUE(sdlangTapeToTag(&converted, sdlangTapeFirstChild(&converted, SDLANG_TAPE_ROOT), &subtree));
+	expectSameTree(tree.children[0], subtree);
+
+	sdlangTagFree(subtree);
+	sdlangTagFree(back);
+	sdlangTagFree(tree);
+	sdlangTapeFree(&converted);
+	sdlangTapeFree(&parsed);
+}
+
+TEST(Tape, ItemsAfterClosingBraces)
+{
+	// Each closing brace moves the tag's items past its children's, which must leave the children's items alone.
+	const char* code = "a 1 {\n b 2 {\n  c 3\n } 4\n d 5\n} 6\n";
+	SdlangCharStream stream = { code, strlen(code) };
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	SdlangTag tree = {};
+	ASSERT_TRUE(sdlangParseCharStream(stream, &tree, &error, &errorLine, &errorSlice));
+
+	SdlangTape tape;
+	ASSERT_TRUE(sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice));
+	for (size_t i = 0; i < tape.nodeCount; i++)
+	{
+		EXPECT_LE(tape.nodes[i].firstValue + tape.nodes[i].valueCount, tape.valueCount);
+		EXPECT_LE(tape.nodes[i].firstAttribute + tape.nodes[i].attributeCount, tape.attributeCount);
+	}
+
+	SdlangTag back;
+	ASSERT_TRUE(sdlangTapeToTag(&tape, SDLANG_TAPE_ROOT, &back));
+	expectSameTree(tree, back);
+
+	sdlangTagFree(back);
+	sdlangTagFree(tree);
+	sdlangTapeFree(&tape);
+
+	// Only one block of children per tag, whichever way it's parsed.
+	code = "a 1 {\n b 2\n} 3 {\n c 4\n} 5\n";
+	stream = { code, strlen(code) };
+	tree = {};
+	EXPECT_FALSE(sdlangParseCharStream(stream, &tree, &error, &errorLine, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_SECOND_CHILDREN);
+	sdlangTagFree(tree);
+	EXPECT_FALSE(sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice));
+	EXPECT_STREQ(error, SDLANG_ERROR_SECOND_CHILDREN);
+	sdlangTapeFree(&tape);
+}
+
+TEST(Tape, Empty)
+{
+	SdlangCharStream stream = { "", 0 };
+	SdlangTape tape;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice));
+	ASSERT_EQ(tape.nodeCount, 1);
+	EXPECT_EQ(sdlangTapeFirstChild(&tape, SDLANG_TAPE_ROOT), SDLANG_TAPE_NONE);
+	EXPECT_EQ(tape.values, nullptr);
+
+	SdlangTag tag;
+	ASSERT_TRUE(sdlangTapeToTag(&tape, SDLANG_TAPE_ROOT, &tag));
+	EXPECT_EQ(tag.children, nullptr);
+	sdlangTapeFree(&tape);
+}
+
+TEST(Tape, ErrorKeepsTapeWellFormed)
+{
+	const char* code = "a {\n    b 1\n    c =\n}\n";
+	SdlangCharStream stream = { code, strlen(code) };
+	SdlangTape tape;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_FALSE(sdlangParseTape(stream, &tape, &error, &errorLine, &errorSlice));
+	ASSERT_GE(tape.nodeCount, 3);
+	for (size_t i = 0; i < tape.nodeCount; i++)
+		EXPECT_LE(tape.nodes[i].subtreeEnd, tape.nodeCount);
+
+	SdlangTag tag;
+	ASSERT_TRUE(sdlangTapeToTag(&tape, SDLANG_TAPE_ROOT, &tag));
+	sdlangTagFree(tag);
+	sdlangTapeFree(&tape);
+}
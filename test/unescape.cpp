@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <stb_ds.h>
+#include <libsdlang.h>
+#include <cstdlib>
+#include <string>
+
+// from parser_ast
+SdlangTag parse(const std::string& code);
+// from parser_basic
+std::string toStr(SdlangCharSlice slice);
+
+static std::string unescape(const std::string& text)
+{
+	SdlangCharSlice slice = { text.c_str(), text.length() };
+	std::string out(sdlangUnescapedLength(slice), '\0');
+	EXPECT_EQ(sdlangUnescape(slice, &out[0]), out.length());
+	return out;
+}
+
+TEST(Unescape, Escapes)
+{
+	EXPECT_EQ(unescape(""), "");
+	EXPECT_EQ(unescape("plain"), "plain");
+	EXPECT_EQ(unescape("a\\tb\\nc\\rd"), "a\tb\nc\rd");
+	EXPECT_EQ(unescape("say \\\"hi\\\""), "say \"hi\"");
+	EXPECT_EQ(unescape("C:\\\\dir\\\\file"), "C:\\dir\\file");
+	EXPECT_EQ(unescape("line\\\n    next"), "linenext");
+	EXPECT_EQ(unescape("line\\\r\n\tnext"), "linenext");
+	EXPECT_EQ(unescape("\\\\\\\\"), "\\\\");
+	EXPECT_EQ(unescape("trailing\\"), "trailing");
+
+	// Long enough to go through the vectorised search more than once.
+	const std::string run(100, 'x');
+	EXPECT_EQ(unescape(run + "\\t" + run + "\\\"" + run), run + "\t" + run + "\"" + run);
+}
+
+TEST(Unescape, RequiresEscape)
+{
+	const std::string code = "tag \"plain\" \"tab\\there\" `raw\\t` \"quote\\\"\" key=\"a\\\\b\" other=`x` number=1";
+	SdlangTag root = parse(code);
+	const SdlangTag tag = root.children[0];
+	ASSERT_EQ(arrlen(tag.values), 4);
+	EXPECT_FALSE(tag.values[0].requiresEscape);
+	EXPECT_TRUE(tag.values[1].requiresEscape);
+	EXPECT_FALSE(tag.values[2].requiresEscape);
+	EXPECT_TRUE(tag.values[3].requiresEscape);
+	EXPECT_TRUE(tag.attributes[0].value.requiresEscape);
+	EXPECT_FALSE(tag.attributes[1].value.requiresEscape);
+	EXPECT_FALSE(tag.attributes[2].value.requiresEscape);
+	EXPECT_EQ(tag.attributes[2].value.intValue, 1);
+	sdlangTagFree(root);
+}
+
+TEST(Unescape, EscapeNext)
+{
+	const std::string text = "a\\\"b\\\\c\\rd";
+	SdlangCharStream stream = { text.c_str(), text.length() };
+	std::string joined;
+	SdlangCharSlice slice;
+	while (sdlangCharStreamEscapeNext(&stream, &slice))
+		joined += toStr(slice);
+	EXPECT_EQ(joined, "a\"b\\c\rd");
+
+	SdlangCharStream full = { text.c_str(), text.length() };
+	SdlangCharSlice escaped = sdlangCharStreamEscapeFull(full);
+	EXPECT_EQ(toStr(escaped), joined);
+	EXPECT_EQ(escaped.ptr[escaped.length], '\0');
+	free((void*)escaped.ptr);
+}
+
+static const std::string DOCUMENT =
+	"first \"a\\tb\" `c\\td` key=\"e\\\"f\" {\n"
+	"    second \"g\\\\h\" \"plain\"\n"
+	"}\n";
+
+static void expectUnescaped(const SdlangTag& root)
+{
+	const SdlangTag first = root.children[0];
+	EXPECT_EQ(toStr(first.values[0].stringValue), "a\tb");
+	EXPECT_EQ(toStr(first.values[1].stringValue), "c\\td");
+	EXPECT_EQ(toStr(first.attributes[0].value.stringValue), "e\"f");
+	EXPECT_FALSE(first.values[0].requiresEscape);
+	EXPECT_FALSE(first.attributes[0].value.requiresEscape);
+}
+
+TEST(Unescape, DocumentOption)
+{
+	SdlangParseOptions options = {};
+	options.unescapeStrings = true;
+
+	SdlangCharStream stream = { DOCUMENT.c_str(), DOCUMENT.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options));
+	expectUnescaped(doc.root);
+
+	const SdlangTag second = doc.root.children[0].children[0];
+	EXPECT_EQ(toStr(second.values[0].stringValue), "g\\h");
+	EXPECT_FALSE(second.values[0].requiresEscape);
+	EXPECT_EQ(toStr(second.values[1].stringValue), "plain");
+	EXPECT_EQ(second.values[1].stringValue.ptr, DOCUMENT.c_str() + DOCUMENT.find("plain")); // Untouched.
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Unescape, DocumentAfterwards)
+{
+	SdlangCharStream stream = { DOCUMENT.c_str(), DOCUMENT.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice));
+	EXPECT_TRUE(doc.root.children[0].values[0].requiresEscape);
+	ASSERT_TRUE(sdlangDocumentUnescapeStrings(&doc));
+	expectUnescaped(doc.root);
+	ASSERT_TRUE(sdlangDocumentUnescapeStrings(&doc)); // Nothing left to do.
+	expectUnescaped(doc.root);
+	sdlangDocumentFree(&doc);
+}
+
+TEST(Unescape, LazyDocument)
+{
+	SdlangParseOptions options = {};
+	options.lazy = true;
+	options.unescapeStrings = true;
+
+	SdlangCharStream stream = { DOCUMENT.c_str(), DOCUMENT.length() };
+	SdlangDocument doc;
+	SdlangError error;
+	SdlangCharSlice errorLine, errorSlice;
+	ASSERT_TRUE(sdlangParseDocument(stream, &doc, &error, &errorLine, &errorSlice, &options));
+	expectUnescaped(doc.root);
+
+	SdlangTag* children = sdlangTagChildren(&doc, &doc.root.children[0], &error);
+	ASSERT_NE(children, nullptr);
+	EXPECT_EQ(toStr(children[0].values[0].stringValue), "g\\h");
+	EXPECT_FALSE(children[0].values[0].requiresEscape);
+	sdlangDocumentFree(&doc);
+}